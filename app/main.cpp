@@ -1,40 +1,246 @@
 #include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <sstream>
+#include <thread>
+
+#include <signal.h>
+#include <unistd.h>
 
 #include <bw64/bw64.hpp>
 
+#include "adm_engine/batch_renderer.hpp"
+#include "adm_engine/realtime_renderer.hpp"
 #include "adm_engine/renderer.hpp"
 #include "adm_engine/parser.hpp"
 
 using namespace admengine;
 
 int dumpBw64AdmFile(const std::string& path) {
+  if(Bw64StreamReader::isStream(path)) {
+    // only the header chunks of a stream are read
+    Bw64StreamReader inputStream(path);
+    const std::shared_ptr<adm::Document> admDocument = getAdmDocument(inputStream.axmlChunk());
+    displayAdmDocument(admDocument);
+    displayAdmTimeline(admDocument, inputStream.sampleRate());
+    displayChnaChunk(inputStream.chnaChunk());
+    return 0;
+  }
   auto bw64File = bw64::readFile(path);
   displayBw64FileInfos(bw64File);
-  displayAdmDocument(getAdmDocument(parseAdmXmlChunk(bw64File)));
+  const std::shared_ptr<adm::Document> admDocument = getAdmDocument(parseAdmXmlChunk(bw64File));
+  displayAdmDocument(admDocument);
+  displayAdmTimeline(admDocument, bw64File->sampleRate());
   displayChnaChunk(parseAdmChnaChunk(bw64File));
   return 0;
 }
 
+int dumpAdmMetadataAsJson(const std::string& path) {
+  try {
+    auto bw64File = bw64::readFile(path);
+    std::cout << getAdmMetadataAsJson(bw64File) << '\n';
+  } catch(const std::exception& e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
 int renderAdmContent(const std::string& input,
                      const std::string& destination,
                      const std::map<std::string, float>& elementGains,
-                     const std::string& elementIdToRender = "") {
-  auto bw64File = bw64::readFile(input);
+                     const std::vector<std::string>& outputLayouts,
+                     const std::string& elementIdToRender = "",
+                     const size_t nbThreads = 1,
+                     const bool timeSharding = false,
+                     const size_t blockSize = BLOCK_SIZE,
+                     const size_t queueDepth = DEFAULT_QUEUE_DEPTH,
+                     const bool memoryMapped = false,
+                     const std::string& renderPlanCacheDirectory = "",
+                     const OutputFormat outputFormat = OutputFormat::Bw64) {
+  const auto start = std::chrono::steady_clock::now();
   const std::string outputDirectory(destination);
-  const std::string outputLayout("0+2+0"); // TODO: get it from args
-  Renderer renderer(bw64File, outputLayout, outputDirectory, elementGains, elementIdToRender);
-  renderer.process();
+  std::unique_ptr<bw64::Bw64Reader> bw64File;
+  std::unique_ptr<Bw64StreamReader> inputStream;
+  std::unique_ptr<Renderer> renderer;
+  if(Bw64StreamReader::isStream(input)) {
+    // pipes are read once, forward only
+    inputStream.reset(new Bw64StreamReader(input));
+    renderer.reset(new Renderer(*inputStream, outputLayouts, outputDirectory, elementGains, elementIdToRender));
+  } else {
+    bw64File = bw64::readFile(input);
+    renderer.reset(new Renderer(bw64File, outputLayouts, outputDirectory, elementGains, elementIdToRender));
+    renderer->setInputFilePath(input, memoryMapped);
+  }
+  renderer->setNbThreads(nbThreads);
+  renderer->setBlockSize(blockSize);
+  renderer->setQueueDepth(queueDepth);
+  if(timeSharding) {
+    renderer->enableTimeSharding();
+  }
+  if(!renderPlanCacheDirectory.empty()) {
+    renderer->setRenderPlanCache(std::make_shared<RenderPlanCache>(renderPlanCacheDirectory));
+  }
+  if(destination == "-") {
+    // a closed pipe makes the writes fail, instead of terminating the process
+    signal(SIGPIPE, SIG_IGN);
+    renderer->setOutputStream(STDOUT_FILENO, outputFormat);
+    // latency of the stream, as seen by the next stage of the pipeline (logs go to the standard error)
+    bool firstBlockWritten = false;
+    renderer->setProgressCallback([start, firstBlockWritten](const uint64_t nbRenderedFrames, const uint64_t) mutable {
+        if(!firstBlockWritten && nbRenderedFrames) {
+          firstBlockWritten = true;
+          typedef std::chrono::duration<double, std::milli> Milliseconds;
+          std::cout << " >> First output block written after " << Milliseconds(std::chrono::steady_clock::now() - start).count() << " ms" << std::endl;
+        }
+      });
+  }
+  renderer->process();
+  return 0;
+}
+
+int renderBatch(const std::string& manifestPath,
+                const std::string& reportPath,
+                const std::vector<std::string>& outputLayouts,
+                const size_t nbConcurrentJobs,
+                const uint64_t memoryBudget,
+                const size_t nbThreads,
+                const size_t blockSize,
+                const size_t queueDepth,
+                const bool memoryMapped,
+                const std::string& renderPlanCacheDirectory) {
+  const std::vector<BatchJob> jobs = parseBatchManifest(manifestPath);
+  BatchRenderer batchRenderer(nbConcurrentJobs, memoryBudget);
+  batchRenderer.setDefaultOutputLayouts(outputLayouts);
+  batchRenderer.setNbThreads(nbThreads);
+  batchRenderer.setBlockSize(blockSize);
+  batchRenderer.setQueueDepth(queueDepth);
+  batchRenderer.setMemoryMapped(memoryMapped);
+  if(!renderPlanCacheDirectory.empty()) {
+    batchRenderer.setRenderPlanCache(std::make_shared<RenderPlanCache>(renderPlanCacheDirectory));
+  }
+  const std::vector<BatchJobReport> reports = batchRenderer.process(jobs);
+  if(!reportPath.empty()) {
+    writeBatchReport(reports, reportPath);
+  }
+  for(const BatchJobReport& report : reports) {
+    if(!report.succeeded) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+int benchmarkRealtimeRendering(const std::string& input,
+                               const std::map<std::string, float>& elementGains,
+                               const std::vector<std::string>& outputLayouts,
+                               const std::string& elementIdToRender,
+                               const size_t blockSize) {
+  typedef std::chrono::duration<double, std::micro> Microseconds;
+  auto bw64File = bw64::readFile(input);
+  const std::shared_ptr<bw64::AxmlChunk> axmlChunk = parseAdmXmlChunk(bw64File);
+  if(!axmlChunk) {
+    std::cerr << "Error: could not find any axml chunk" << std::endl;
+    return 1;
+  }
+  std::stringstream chnaData;
+  if(const std::shared_ptr<bw64::ChnaChunk> chnaChunk = parseAdmChnaChunk(bw64File)) {
+    chnaChunk->write(chnaData);
+  }
+  const std::string chna = chnaData.str();
+  RealtimeRenderer renderer(axmlChunk->data().data(), axmlChunk->data().size(), chna.data(), chna.size(),
+                            bw64File->channels(), bw64File->sampleRate(), outputLayouts, elementGains, elementIdToRender, blockSize);
+
+  std::vector<float> inputBuffer(blockSize * bw64File->channels());
+  std::vector<std::vector<float>> outputBuffers;
+  std::vector<float*> outputs;
+  for (size_t layoutIndex = 0; layoutIndex < outputLayouts.size(); ++layoutIndex) {
+    outputBuffers.emplace_back(blockSize * renderer.getBufferRenderer().getNbOutputChannels(layoutIndex));
+    outputs.push_back(outputBuffers.back().data());
+  }
+  std::vector<double> blockDurations;
+  blockDurations.reserve(bw64File->numberOfFrames() / blockSize + 1);
+
+  // the rendered element gain keeps changing from a control thread, as from a live mixing desk
+  std::atomic<bool> rendering(true);
+  size_t nbGainChanges = 0;
+  std::thread controlThread([&renderer, &rendering, &nbGainChanges]() {
+    const std::string elementId = renderer.getBufferRenderer().getElementId();
+    while(rendering) {
+      if(renderer.setElementGain(elementId, nbGainChanges % 2 ? 1.0 : 0.5)) {
+        nbGainChanges++;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+  });
+
+  // only the rendering is timed, input blocks being read beforehand
+  while(const size_t nbFrames = bw64File->read(inputBuffer.data(), blockSize)) {
+    const auto start = std::chrono::steady_clock::now();
+    renderer.process(inputBuffer.data(), outputs.data(), nbFrames);
+    blockDurations.push_back(Microseconds(std::chrono::steady_clock::now() - start).count());
+  }
+  rendering = false;
+  controlThread.join();
+  if(blockDurations.empty()) {
+    std::cerr << "Error: no audio frame to render" << std::endl;
+    return 1;
+  }
+
+  const double blockPeriod = 1e6 * blockSize / bw64File->sampleRate();
+  double mean = 0.0;
+  size_t nbOverruns = 0;
+  for(const double duration : blockDurations) {
+    mean += duration / blockDurations.size();
+    if(duration > blockPeriod) {
+      nbOverruns++;
+    }
+  }
+  double variance = 0.0;
+  for(const double duration : blockDurations) {
+    variance += (duration - mean) * (duration - mean) / blockDurations.size();
+  }
+  std::sort(blockDurations.begin(), blockDurations.end());
+  auto percentile = [&blockDurations](const double p) {
+    return blockDurations[std::min(blockDurations.size() - 1, (size_t)(p * blockDurations.size()))];
+  };
+  std::cout << " >> Realtime rendering of " << blockDurations.size() << " blocks of " << blockSize << " frames ("
+            << blockPeriod << " us each), with " << nbGainChanges << " gain changes" << std::endl;
+  std::cout << " >> Block rendering time (us): min: " << blockDurations.front()
+            << ", median: " << percentile(0.5)
+            << ", p99: " << percentile(0.99)
+            << ", p99.9: " << percentile(0.999)
+            << ", max: " << blockDurations.back() << std::endl;
+  std::cout << " >> Jitter (standard deviation): " << std::sqrt(variance) << " us, mean load: " << 100.0 * mean / blockPeriod
+            << " %, overruns: " << nbOverruns << std::endl;
   return 0;
 }
 
 void displayUsage(const char* application) {
   std::cout << "Usage: " << application << " INPUT [OPTIONS]" << std::endl;
+  std::cout << "       " << application << " -B MANIFEST [OPTIONS]" << std::endl;
   std::cout << std::endl;
-  std::cout << "  INPUT                  BW64/ADM audio file path" << std::endl;
+  std::cout << "  INPUT                  BW64/ADM audio file path, or pipe ('-' for the standard input, read once without seeking)" << std::endl;
+  std::cout << "  MANIFEST               Batch of renderings, one per line: INPUT -o OUTPUT [-e ELEMENT_ID] [-g ELEMENT_ID=GAIN]... [-l LAYOUT]..." << std::endl;
   std::cout << "  OPTIONS:" << std::endl;
-  std::cout << "    -o OUTPUT            Destination directory" << std::endl;
+  std::cout << "    -o OUTPUT            Destination directory ('-' to stream a single rendered element and layout to the standard output)" << std::endl;
+  std::cout << "    -f FORMAT            Format of the output stream: 'bw64' (default, with unknown sizes in its header) or 'pcm' (raw interleaved PCM)" << std::endl;
   std::cout << "    -e ELEMENT_ID        Select the AudioProgramme or AudioObject to be renderer by ELEMENT_ID" << std::endl;
   std::cout << "    -g ELEMENT_ID=GAIN   GAIN value (in dB) to apply to ADM element defined by its ELEMENT_ID" << std::endl;
+  std::cout << "    -l LAYOUT            Output layout, as an ITU-R BS.2051 system name (default: 0+2+0, repeat to render several layouts in one pass)" << std::endl;
+  std::cout << "    -j THREADS           Number of rendering threads (default: 1)" << std::endl;
+  std::cout << "    -s                   Split the rendering timeline into one shard per thread (needs several threads, see -j)" << std::endl;
+  std::cout << "    -b BLOCK_SIZE        Number of frames rendered per block (default: " << BLOCK_SIZE << ")" << std::endl;
+  std::cout << "    -q QUEUE_DEPTH       Number of blocks buffered between read, render and write threads (default: " << DEFAULT_QUEUE_DEPTH << ", 0 to disable)" << std::endl;
+  std::cout << "    -m                   Read the input file through a memory mapping" << std::endl;
+  std::cout << "    -c CACHE_DIRECTORY   Directory of render plans, reused by the next renderings of the same ADM content" << std::endl;
+  std::cout << "    -p JOBS              Number of batch jobs rendered concurrently (default: " << DEFAULT_NB_CONCURRENT_JOBS << ")" << std::endl;
+  std::cout << "    -M MEMORY_BUDGET     Memory (in MB) that concurrent batch jobs are estimated to use at most (default: unlimited)" << std::endl;
+  std::cout << "    -r REPORT            Path of the batch report, with the status and duration of each job" << std::endl;
+  std::cout << "    -R                   Benchmark the realtime rendering of the input, by blocks of BLOCK_SIZE frames (default: " << DEFAULT_REALTIME_BLOCK_SIZE << "), with gain changes" << std::endl;
+  std::cout << "    -d                   Dump the input file metadata as a single-line JSON summary, without reading any audio (other options are ignored)" << std::endl;
   std::cout << std::endl;
   std::cout << "  If no OUTPUT argument is specified, this program dumps the input BW64/ADM file information." << std::endl;
   std::cout << "  Otherwise, it enables ADM rendering to BW64/ADM file into destination directory." << std::endl;
@@ -42,12 +248,32 @@ void displayUsage(const char* application) {
   std::cout << "  Examples:" << std::endl;
   std::cout << "    - Dumping BW64/ADM file info:" << std::endl;
   std::cout << "          " << application << " /path/to/input/file.wav" << std::endl;
+  std::cout << "    - Dumping BW64/ADM file metadata as JSON:" << std::endl;
+  std::cout << "          " << application << " /path/to/input/file.wav -d" << std::endl;
   std::cout << "    - Rendering ADM:" << std::endl;
   std::cout << "          " << application << " /path/to/input/file.wav -o /path/to/output/directory" << std::endl;
   std::cout << "    - Rendering specified ADM element:" << std::endl;
   std::cout << "          " << application << " /path/to/input/file.wav -e APR_1002 -o /path/to/output/directory" << std::endl;
   std::cout << "    - Rendering ADM, applying gains to elements:" << std::endl;
   std::cout << "          " << application << " /path/to/input/file.wav -o /path/to/output/directory -g AO_1001=-4.0 -g ACO_1002=5.0" << std::endl;
+  std::cout << "    - Rendering ADM to 5.1 and 7.1.4 in one pass:" << std::endl;
+  std::cout << "          " << application << " /path/to/input/file.wav -o /path/to/output/directory -l 0+5+0 -l 4+7+0" << std::endl;
+  std::cout << "    - Rendering ADM on 8 threads:" << std::endl;
+  std::cout << "          " << application << " /path/to/input/file.wav -o /path/to/output/directory -j 8" << std::endl;
+  std::cout << "    - Rendering a long ADM programme in 8 time shards:" << std::endl;
+  std::cout << "          " << application << " /path/to/input/file.wav -e APR_1001 -o /path/to/output/directory -j 8 -s" << std::endl;
+  std::cout << "    - Rendering ADM from a memory-mapped input file:" << std::endl;
+  std::cout << "          " << application << " /path/to/input/file.wav -o /path/to/output/directory -m" << std::endl;
+  std::cout << "    - Rendering ADM again with other gains, from cached render plans:" << std::endl;
+  std::cout << "          " << application << " /path/to/input/file.wav -o /path/to/output/directory -c /path/to/cache/directory -g AO_1001=-4.0" << std::endl;
+  std::cout << "    - Rendering ADM from a decoder pipe:" << std::endl;
+  std::cout << "          decoder | " << application << " - -o /path/to/output/directory" << std::endl;
+  std::cout << "    - Rendering ADM from a decoder pipe to an encoder pipe:" << std::endl;
+  std::cout << "          decoder | " << application << " - -e APR_1001 -l 0+5+0 -o - | encoder" << std::endl;
+  std::cout << "    - Rendering a batch of files, 4 at a time within 8 GB, with a report:" << std::endl;
+  std::cout << "          " << application << " -B /path/to/manifest.txt -p 4 -M 8192 -r /path/to/report.tsv" << std::endl;
+  std::cout << "    - Measuring the realtime rendering latency and jitter, by blocks of 64 frames:" << std::endl;
+  std::cout << "          " << application << " /path/to/input/file.wav -R -b 64" << std::endl;
   std::cout << std::endl;
 }
 
@@ -58,16 +284,64 @@ int main(int argc, char **argv) {
   }
 
   std::string inputFilePath = argv[1];
+  // in batch mode, the inputs are read from the manifest
+  std::string batchManifestPath;
+  int firstOption = 2;
+  if(inputFilePath == "-B") {
+    if(argc < 3) {
+      displayUsage(argv[0]);
+      return 1;
+    }
+    batchManifestPath = argv[2];
+    firstOption = 3;
+  }
+  for (int i = firstOption; i < argc; ++i) {
+    if(std::string(argv[i]) == "-d") {
+      // nothing else than the JSON is written to the standard output
+      return dumpAdmMetadataAsJson(inputFilePath);
+    }
+    if(std::string(argv[i]) == "-o" && i + 1 < argc && std::string(argv[i + 1]) == "-") {
+      // the standard output only carries the rendered stream, logs go to the standard error
+      std::cout.rdbuf(std::cerr.rdbuf());
+    }
+  }
+
   std::string outputDirectoryPath;
   std::string elementIdToRender;
   std::map<std::string, float> elementGains;
+  std::vector<std::string> outputLayouts;
+  size_t nbThreads = 1;
+  bool timeSharding = false;
+  size_t blockSize = 0;
+  size_t queueDepth = DEFAULT_QUEUE_DEPTH;
+  bool memoryMapped = false;
+  std::string renderPlanCacheDirectory;
+  size_t nbConcurrentJobs = DEFAULT_NB_CONCURRENT_JOBS;
+  uint64_t memoryBudget = 0;
+  std::string batchReportPath;
+  bool realtimeBenchmark = false;
+  OutputFormat outputFormat = OutputFormat::Bw64;
 
-  std::cout << "Input file:            " << inputFilePath << std::endl;
-  for (int i = 2; i < argc; ++i) {
+  if(batchManifestPath.empty()) {
+    std::cout << "Input file:            " << inputFilePath << std::endl;
+  } else {
+    std::cout << "Batch manifest:        " << batchManifestPath << std::endl;
+  }
+  for (int i = firstOption; i < argc; ++i) {
     std::string arg = argv[i];
     if(arg == "-o") {
       outputDirectoryPath = argv[++i];
       std::cout << "Output directory:      " << outputDirectoryPath << std::endl;
+    } else if(arg == "-f") {
+      const std::string format = argv[++i];
+      if(format == "pcm") {
+        outputFormat = OutputFormat::RawPcm;
+      } else if(format != "bw64") {
+        std::cerr << "Unexpected output format: " << format << std::endl << std::endl;
+        displayUsage(argv[0]);
+        return 1;
+      }
+      std::cout << "Output stream format:  " << format << std::endl;
     } else if(arg == "-e") {
       elementIdToRender = argv[++i];
       std::cout << "ADM element to render: " << elementIdToRender << std::endl;
@@ -78,6 +352,39 @@ int main(int argc, char **argv) {
       std::string gainDbStr = gainPair.substr(splitPos + 1, gainPair.size());
       elementGains[elemId] = pow(10.0, std::atof(gainDbStr.c_str()) / 20.0);
       std::cout << "Gain:                  " << elementGains[elemId] << " (" << gainDbStr << " dB) applied to " << elemId << std::endl;
+    } else if(arg == "-l") {
+      outputLayouts.push_back(argv[++i]);
+      std::cout << "Output layout:         " << outputLayouts.back() << std::endl;
+    } else if(arg == "-j") {
+      nbThreads = std::max(std::atoi(argv[++i]), 1);
+      std::cout << "Rendering threads:     " << nbThreads << std::endl;
+    } else if(arg == "-s") {
+      timeSharding = true;
+      std::cout << "Time sharding:         enabled" << std::endl;
+    } else if(arg == "-b") {
+      blockSize = std::max(std::atoi(argv[++i]), 1);
+      std::cout << "Block size:            " << blockSize << std::endl;
+    } else if(arg == "-q") {
+      queueDepth = std::max(std::atoi(argv[++i]), 0);
+      std::cout << "Queue depth:           " << queueDepth << std::endl;
+    } else if(arg == "-m") {
+      memoryMapped = true;
+      std::cout << "Memory mapping:        enabled" << std::endl;
+    } else if(arg == "-c") {
+      renderPlanCacheDirectory = argv[++i];
+      std::cout << "Render plan cache:     " << renderPlanCacheDirectory << std::endl;
+    } else if(arg == "-p") {
+      nbConcurrentJobs = std::max(std::atoi(argv[++i]), 1);
+      std::cout << "Concurrent jobs:       " << nbConcurrentJobs << std::endl;
+    } else if(arg == "-M") {
+      memoryBudget = (uint64_t)std::max(std::atoll(argv[++i]), 0LL) * 1024 * 1024;
+      std::cout << "Memory budget:         " << memoryBudget / (1024 * 1024) << " MB" << std::endl;
+    } else if(arg == "-R") {
+      realtimeBenchmark = true;
+      std::cout << "Realtime benchmark:    enabled" << std::endl;
+    } else if(arg == "-r") {
+      batchReportPath = argv[++i];
+      std::cout << "Batch report:          " << batchReportPath << std::endl;
     } else {
       std::cerr << "Unexpected argument: " << argv[i] << std::endl << std::endl;
       displayUsage(argv[0]);
@@ -86,9 +393,39 @@ int main(int argc, char **argv) {
   }
 
 
-  if(outputDirectoryPath.empty()) {
-    return dumpBw64AdmFile(inputFilePath);
-  } else {
-    return renderAdmContent(inputFilePath, outputDirectoryPath, elementGains, elementIdToRender);
+  if(outputLayouts.empty()) {
+    outputLayouts.push_back(DEFAULT_OUTPUT_LAYOUT);
+  }
+
+  if(realtimeBenchmark) {
+    try {
+      return benchmarkRealtimeRendering(inputFilePath, elementGains, outputLayouts, elementIdToRender, blockSize ? blockSize : DEFAULT_REALTIME_BLOCK_SIZE);
+    } catch(const std::exception& e) {
+      std::cerr << "Error: " << e.what() << std::endl;
+      return 1;
+    }
+  }
+  if(!blockSize) {
+    blockSize = BLOCK_SIZE;
+  }
+
+  if(!batchManifestPath.empty()) {
+    try {
+      return renderBatch(batchManifestPath, batchReportPath, outputLayouts, nbConcurrentJobs, memoryBudget, nbThreads, blockSize, queueDepth, memoryMapped, renderPlanCacheDirectory);
+    } catch(const std::exception& e) {
+      std::cerr << "Error: " << e.what() << std::endl;
+      return 1;
+    }
+  }
+
+  try {
+    if(outputDirectoryPath.empty()) {
+      return dumpBw64AdmFile(inputFilePath);
+    } else {
+      return renderAdmContent(inputFilePath, outputDirectoryPath, elementGains, outputLayouts, elementIdToRender, nbThreads, timeSharding, blockSize, queueDepth, memoryMapped, renderPlanCacheDirectory, outputFormat);
+    }
+  } catch(const std::exception& e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    return 1;
   }
 }
@@ -0,0 +1,19 @@
+set -e # Exit immediately if a command exits with a non-zero status
+
+# Usage: benchmark_dump.sh DIRECTORY [ADM_ENGINE]
+# Dump the metadata of every BW64/ADM file of DIRECTORY as JSON, and report the number of files dumped per second.
+
+DIRECTORY=$1
+ADM_ENGINE=${2:-adm-engine}
+
+echo "=== Benchmark adm-engine JSON dump on ${DIRECTORY} ==="
+
+START=$(date +%s.%N)
+NB_FILES=0
+while IFS= read -r -d '' FILE; do
+  ${ADM_ENGINE} "${FILE}" -d > /dev/null
+  NB_FILES=$((NB_FILES + 1))
+done < <(find "${DIRECTORY}" -type f -iname "*.wav" -print0)
+END=$(date +%s.%N)
+
+awk -v files=${NB_FILES} -v start=${START} -v end=${END} 'BEGIN { printf "%d files dumped in %.3f s (%.1f files/s)\n", files, end - start, files / (end - start) }'
@@ -0,0 +1,26 @@
+set -e # Exit immediately if a command exits with a non-zero status
+
+# Usage: benchmark_hoa.sh INPUT [ADM_ENGINE] [NB_RUNS]
+# Render all the programmes of INPUT (e.g. HOA scenes) to the 4+7+0 and 9+10+3 layouts, and report the best time of each layout.
+
+INPUT=$1
+ADM_ENGINE=${2:-adm-engine}
+NB_RUNS=${3:-5}
+
+OUTPUT_DIRECTORY=$(mktemp -d)
+trap 'rm -rf "${OUTPUT_DIRECTORY}"' EXIT
+
+echo "=== Benchmark adm-engine HOA rendering of ${INPUT}, best of ${NB_RUNS} runs ==="
+
+for LAYOUT in 4+7+0 9+10+3; do
+  mkdir "${OUTPUT_DIRECTORY}/${LAYOUT}"
+  BEST_DURATION=""
+  for RUN in $(seq ${NB_RUNS}); do
+    START=$(date +%s.%N)
+    ${ADM_ENGINE} "${INPUT}" -o "${OUTPUT_DIRECTORY}/${LAYOUT}" -l ${LAYOUT} > /dev/null
+    END=$(date +%s.%N)
+    BEST_DURATION=$(awk -v start=${START} -v end=${END} -v best=${BEST_DURATION:-0} \
+      'BEGIN { duration = end - start; print (best == 0 || duration < best) ? duration : best }')
+  done
+  awk -v layout=${LAYOUT} -v duration=${BEST_DURATION} 'BEGIN { printf "%s: %.3f s\n", layout, duration }'
+done
@@ -0,0 +1,41 @@
+set -e # Exit immediately if a command exits with a non-zero status
+
+# Usage: benchmark_memory_mapping.sh INPUT [ADM_ENGINE] [LAYOUT] [NB_RUNS]
+# Render all the programmes of INPUT with positional reads and through a memory mapping, report the best time of each
+# reader, and check that outputs are bit-identical.
+
+INPUT=$1
+ADM_ENGINE=${2:-adm-engine}
+LAYOUT=${3:-0+2+0}
+NB_RUNS=${4:-5}
+
+OUTPUT_DIRECTORY=$(mktemp -d)
+trap 'rm -rf "${OUTPUT_DIRECTORY}"' EXIT
+
+echo "=== Benchmark adm-engine input reading of ${INPUT} to ${LAYOUT}, best of ${NB_RUNS} runs ==="
+
+for READER in pread mmap; do
+  OPTIONS=""
+  if [ ${READER} = mmap ]; then
+    OPTIONS="-m"
+  fi
+  mkdir "${OUTPUT_DIRECTORY}/${READER}"
+  BEST_DURATION=""
+  for RUN in $(seq ${NB_RUNS}); do
+    START=$(date +%s.%N)
+    ${ADM_ENGINE} "${INPUT}" -o "${OUTPUT_DIRECTORY}/${READER}" -l ${LAYOUT} ${OPTIONS} > /dev/null
+    END=$(date +%s.%N)
+    BEST_DURATION=$(awk -v start=${START} -v end=${END} -v best=${BEST_DURATION:-0} \
+      'BEGIN { duration = end - start; print (best == 0 || duration < best) ? duration : best }')
+  done
+  if [ ${READER} = pread ]; then
+    REFERENCE_DURATION=${BEST_DURATION}
+  fi
+  # outputs are compared to the positional reader ones
+  IDENTICAL=yes
+  for OUTPUT in "${OUTPUT_DIRECTORY}/pread"/*.wav; do
+    cmp -s "${OUTPUT}" "${OUTPUT_DIRECTORY}/${READER}/$(basename "${OUTPUT}")" || IDENTICAL=no
+  done
+  awk -v reader=${READER} -v duration=${BEST_DURATION} -v reference=${REFERENCE_DURATION} -v identical=${IDENTICAL} \
+    'BEGIN { printf "%s: %.3f s (%.2fx), bit-identical: %s\n", reader, duration, reference / duration, identical }'
+done
@@ -0,0 +1,24 @@
+set -e # Exit immediately if a command exits with a non-zero status
+
+# Usage: benchmark_objects.sh INPUT [ADM_ENGINE]
+# Render all the programmes of INPUT (e.g. moving Objects) to layouts of increasing size, and report the realtime factor of each rendering.
+
+INPUT=$1
+ADM_ENGINE=${2:-adm-engine}
+
+OUTPUT_DIRECTORY=$(mktemp -d)
+trap 'rm -rf "${OUTPUT_DIRECTORY}"' EXIT
+
+# the first duration of the dump is the input one, in seconds
+INPUT_DURATION=$(${ADM_ENGINE} "${INPUT}" -d | grep -o '"duration":[0-9.e+-]*' | head -n 1 | cut -d ':' -f 2)
+
+echo "=== Benchmark adm-engine rendering of ${INPUT} (${INPUT_DURATION} s) ==="
+
+for LAYOUT in 0+2+0 4+7+0 9+10+3; do
+  mkdir "${OUTPUT_DIRECTORY}/${LAYOUT}"
+  START=$(date +%s.%N)
+  ${ADM_ENGINE} "${INPUT}" -o "${OUTPUT_DIRECTORY}/${LAYOUT}" -l ${LAYOUT} > /dev/null
+  END=$(date +%s.%N)
+  awk -v layout=${LAYOUT} -v start=${START} -v end=${END} -v duration=${INPUT_DURATION} \
+    'BEGIN { printf "%s: %.3f s (%.1fx realtime)\n", layout, end - start, duration / (end - start) }'
+done
@@ -0,0 +1,22 @@
+set -e # Exit immediately if a command exits with a non-zero status
+
+# Usage: benchmark_parse.sh DIRECTORY [ADM_ENGINE]
+# Dump the metadata of every BW64/ADM file of DIRECTORY as JSON, and report the size of its axml chunk, the parsing time
+# and the peak memory of each dump (needs GNU time).
+
+DIRECTORY=$1
+ADM_ENGINE=${2:-adm-engine}
+
+echo "=== Benchmark adm-engine ADM parsing on ${DIRECTORY} ==="
+
+while IFS= read -r -d '' FILE; do
+  # the axml chunk size follows its identifier
+  AXML_OFFSET=$(grep -obUa axml "${FILE}" | head -n 1 | cut -d ':' -f 1)
+  AXML_SIZE=0
+  if [ -n "${AXML_OFFSET}" ]; then
+    AXML_SIZE=$(od -An -tu4 -j $((AXML_OFFSET + 4)) -N 4 "${FILE}" | tr -d ' ')
+  fi
+  read -r DURATION MAX_RSS < <(/usr/bin/time -f "%e %M" ${ADM_ENGINE} "${FILE}" -d 2>&1 > /dev/null | tail -n 1)
+  awk -v file="$(basename "${FILE}")" -v size=${AXML_SIZE} -v duration=${DURATION} -v rss=${MAX_RSS} \
+    'BEGIN { printf "%s: axml %.1f kB, parsed in %.2f s, peak memory %.1f MB\n", file, size / 1000, duration, rss / 1000 }'
+done < <(find "${DIRECTORY}" -type f -iname "*.wav" -print0 | sort -z)
@@ -0,0 +1,23 @@
+set -e # Exit immediately if a command exits with a non-zero status
+
+# Usage: benchmark_realtime.sh INPUT [ADM_ENGINE] [LAYOUT] [ELEMENT_ID]
+# Render INPUT as from a realtime audio thread, by blocks of 64, 128 and 256 frames, and report the block rendering latency and jitter.
+# If ELEMENT_ID is given, also stream it to a pipe, and report the time until its first output block is written.
+
+INPUT=$1
+ADM_ENGINE=${2:-adm-engine}
+LAYOUT=${3:-0+2+0}
+ELEMENT_ID=$4
+
+echo "=== Benchmark adm-engine realtime rendering of ${INPUT} to ${LAYOUT} ==="
+
+for BLOCK_SIZE in 64 128 256; do
+  echo "--- ${BLOCK_SIZE} frames per block"
+  ${ADM_ENGINE} "${INPUT}" -R -b ${BLOCK_SIZE} -l ${LAYOUT} | grep " >> Realtime\| >> Block\| >> Jitter"
+done
+
+if [ -n "${ELEMENT_ID}" ]; then
+  echo "--- ${ELEMENT_ID} streamed to a pipe"
+  # logs go to the standard error, the stream itself is dropped
+  ${ADM_ENGINE} "${INPUT}" -e ${ELEMENT_ID} -l ${LAYOUT} -o - 2>&1 >/dev/null | grep " >> First output block"
+fi
@@ -0,0 +1,27 @@
+set -e # Exit immediately if a command exits with a non-zero status
+
+# Usage: benchmark_render_plan_cache.sh INPUT [ADM_ENGINE] [LAYOUT]
+# Render all the programmes of INPUT without cache, then with a cold and a warm render plan cache, and report the
+# render plans initialisation time and the whole rendering time of each run.
+
+INPUT=$1
+ADM_ENGINE=${2:-adm-engine}
+LAYOUT=${3:-0+2+0}
+
+OUTPUT_DIRECTORY=$(mktemp -d)
+CACHE_DIRECTORY=$(mktemp -d)
+trap 'rm -rf "${OUTPUT_DIRECTORY}" "${CACHE_DIRECTORY}"' EXIT
+
+echo "=== Benchmark adm-engine render plan cache on ${INPUT} to ${LAYOUT} ==="
+
+for RUN in uncached cold warm; do
+  OPTIONS=""
+  if [ ${RUN} != uncached ]; then
+    OPTIONS="-c ${CACHE_DIRECTORY}"
+  fi
+  START=$(date +%s.%N)
+  RENDER_PLANS=$(${ADM_ENGINE} "${INPUT}" -o "${OUTPUT_DIRECTORY}" -l ${LAYOUT} ${OPTIONS} | grep " >> Render plans:" | sed 's/ >> Render plans: //' | paste -s -d ';' -)
+  END=$(date +%s.%N)
+  awk -v run=${RUN} -v start=${START} -v end=${END} -v plans="${RENDER_PLANS}" \
+    'BEGIN { printf "%-8s: %.3f s, render plans: %s\n", run, end - start, plans }'
+done
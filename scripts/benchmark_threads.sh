@@ -0,0 +1,30 @@
+set -e # Exit immediately if a command exits with a non-zero status
+
+# Usage: benchmark_threads.sh INPUT [ADM_ENGINE] [LAYOUT]
+# Render all the programmes of INPUT on 1 to 32 threads, report the speedup over 1 thread, and check that outputs are bit-identical.
+
+INPUT=$1
+ADM_ENGINE=${2:-adm-engine}
+LAYOUT=${3:-0+2+0}
+
+OUTPUT_DIRECTORY=$(mktemp -d)
+trap 'rm -rf "${OUTPUT_DIRECTORY}"' EXIT
+
+echo "=== Benchmark adm-engine rendering of ${INPUT} to ${LAYOUT} on 1 to 32 threads ==="
+
+for NB_THREADS in 1 2 4 8 16 32; do
+  mkdir "${OUTPUT_DIRECTORY}/${NB_THREADS}"
+  START=$(date +%s.%N)
+  ${ADM_ENGINE} "${INPUT}" -o "${OUTPUT_DIRECTORY}/${NB_THREADS}" -l ${LAYOUT} -j ${NB_THREADS} > /dev/null
+  END=$(date +%s.%N)
+  if [ ${NB_THREADS} -eq 1 ]; then
+    REFERENCE_DURATION=$(awk -v start=${START} -v end=${END} 'BEGIN { print end - start }')
+  fi
+  # outputs are compared to the single-threaded ones
+  IDENTICAL=yes
+  for OUTPUT in "${OUTPUT_DIRECTORY}/1"/*.wav; do
+    cmp -s "${OUTPUT}" "${OUTPUT_DIRECTORY}/${NB_THREADS}/$(basename "${OUTPUT}")" || IDENTICAL=no
+  done
+  awk -v threads=${NB_THREADS} -v start=${START} -v end=${END} -v reference=${REFERENCE_DURATION} -v identical=${IDENTICAL} \
+    'BEGIN { printf "%2d threads: %.3f s (%.2fx), bit-identical: %s\n", threads, end - start, reference / (end - start), identical }'
+done
@@ -1,6 +1,7 @@
 
 #include "adm_helper.hpp"
 
+#include "common_definitions_index.hpp"
 #include "parser.hpp"
 
 namespace admengine {
@@ -8,7 +9,8 @@ namespace admengine {
 std::shared_ptr<adm::AudioObject> createAdmAudioObject(const adm::AudioObjectName& audioObjectName, const ear::Layout& outputLayout) {
   auto mixObject = adm::AudioObject::create(audioObjectName);
   auto mixPackFormat = adm::AudioPackFormat::create(adm::AudioPackFormatName(""), adm::TypeDefinition::DIRECT_SPEAKERS);
-  adm::AudioPackFormatId mixPackFormatId = adm::audioPackFormatLookupTable().at(outputLayout.name());
+  const CommonDefinitionsIndex& commonDefinitions = CommonDefinitionsIndex::getInstance();
+  adm::AudioPackFormatId mixPackFormatId = commonDefinitions.getAudioPackFormatId(outputLayout.name());
   mixPackFormat->set(mixPackFormatId);
 
   mixObject->addReference(mixPackFormat);
@@ -17,7 +19,7 @@ std::shared_ptr<adm::AudioObject> createAdmAudioObject(const adm::AudioObjectNam
     auto audioTrackUid = adm::AudioTrackUid::create();
     audioTrackUid->setReference(mixPackFormat);
 
-    adm::AudioTrackFormatId audioTrackFormatId = adm::audioTrackFormatLookupTable().at(channel.name());
+    adm::AudioTrackFormatId audioTrackFormatId = commonDefinitions.getAudioTrackFormatId(channel.name());
     auto audioTrackFormat = adm::AudioTrackFormat::create(adm::AudioTrackFormatName(""), adm::FormatDefinition::PCM);
     audioTrackFormat->set(audioTrackFormatId);
     audioTrackUid->setReference(audioTrackFormat);
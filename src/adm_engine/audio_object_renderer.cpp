@@ -1,60 +1,102 @@
 
 #include "audio_object_renderer.hpp"
 
+#include "common_definitions_index.hpp"
 #include "parser.hpp"
 
-#include <adm/common_definitions.hpp>
+#include <algorithm>
+#include <cmath>
 
 namespace admengine {
 
+namespace {
+
+/// Objects rendering metadata of an ADM block (see Rec. ITU-R BS.2127-0, 7.3)
+ear::ObjectsTypeMetadata toObjectsTypeMetadata(const adm::AudioBlockFormatObjects& audioBlockFormat) {
+  ear::ObjectsTypeMetadata metadata;
+  if(audioBlockFormat.has<adm::CartesianPosition>()) {
+    const adm::CartesianPosition position = audioBlockFormat.get<adm::CartesianPosition>();
+    metadata.position = ear::CartesianPosition(position.get<adm::X>().get(),
+                                               position.get<adm::Y>().get(),
+                                               position.has<adm::Z>() ? position.get<adm::Z>().get() : 0.0);
+  } else {
+    const adm::SphericalPosition position = audioBlockFormat.get<adm::SphericalPosition>();
+    metadata.position = ear::PolarPosition(position.get<adm::Azimuth>().get(),
+                                           position.get<adm::Elevation>().get(),
+                                           position.has<adm::Distance>() ? position.get<adm::Distance>().get() : 1.0);
+  }
+  metadata.cartesian = audioBlockFormat.get<adm::Cartesian>().get();
+  metadata.width = audioBlockFormat.get<adm::Width>().get();
+  metadata.height = audioBlockFormat.get<adm::Height>().get();
+  metadata.depth = audioBlockFormat.get<adm::Depth>().get();
+  metadata.diffuse = audioBlockFormat.get<adm::Diffuse>().get();
+  metadata.gain = audioBlockFormat.get<adm::Gain>().get();
+  return metadata;
+}
+
+}
+
 AudioObjectRenderer::AudioObjectRenderer(const ear::Layout& outputLayout,
                       const std::shared_ptr<adm::AudioObject>& audioObject,
-                      const std::shared_ptr<bw64::ChnaChunk>& chnaChunk)
+                      const std::shared_ptr<bw64::ChnaChunk>& chnaChunk,
+                      const TimelineIndex& timelineIndex)
   : _outputLayout(outputLayout)
   , _audioObject(audioObject)
   , _chnaChunk(chnaChunk)
+  , _timelineIndex(timelineIndex)
+  , _renderPlan(outputLayout.channels().size())
 {
   init();
 }
 
+AudioObjectRenderer::AudioObjectRenderer(const ear::Layout& outputLayout,
+                      const std::shared_ptr<adm::AudioObject>& audioObject,
+                      const std::shared_ptr<bw64::ChnaChunk>& chnaChunk,
+                      const TimelineIndex& timelineIndex,
+                      const RenderPlan& renderPlan)
+  : _outputLayout(outputLayout)
+  , _audioObject(audioObject)
+  , _chnaChunk(chnaChunk)
+  , _timelineIndex(timelineIndex)
+  , _renderPlan(renderPlan)
+{
+  if(_renderPlan.getNbOutputChannels() != getNbOutputTracks()) {
+    throw std::runtime_error("Render plan does not fit the output layout: " + outputLayout.name());
+  }
+}
+
 float AudioObjectRenderer::getTrackGain(const size_t& inputTrackId, const size_t& outputTrackId) const {
-  return _inputTrackGains.at(inputTrackId).at(outputTrackId);
+  return _renderPlan.getGain(inputTrackId, outputTrackId);
 }
 
 void AudioObjectRenderer::applyUserGain(const float& gain) {
-  for(auto& kv : _inputTrackGains) {
-    for (int i = 0; i < kv.second.size(); ++i) {
-      _inputTrackGains[kv.first][i] *= gain;
-    }
-  }
+  _renderPlan.applyGain(gain);
 }
 
 void AudioObjectRenderer::applyGain(const size_t& inputTrackId, const size_t& outputTrackId, const float& gain) {
-  _inputTrackGains[inputTrackId][outputTrackId] *= gain;
+  _renderPlan.applyGain(inputTrackId, outputTrackId, gain);
 }
 
 size_t AudioObjectRenderer::getNbOutputTracks() const {
   return _outputLayout.channels().size();
 }
 
-void AudioObjectRenderer::renderAudioFrame(const float* inputFrame, float* outputFrame) {
-  for (int oc = 0; oc < getNbOutputTracks(); ++oc) {
-  // for each output channel, apply computed gain to input channels...
-    for(const size_t ic : _inputTrackIds) { // getTrackMapping(oc)
-      outputFrame[oc] += inputFrame[ic] * getTrackGain(ic, oc);
-    }
-  }
+void AudioObjectRenderer::renderAudioFrame(const uint64_t framePosition, const float* inputFrame, float* outputFrame) const {
+  // the input stride does not matter for a single frame
+  processBlock(framePosition, 1, inputFrame, 0, outputFrame);
+}
+
+void AudioObjectRenderer::processBlock(const uint64_t framePosition, const size_t nbFrames, const float* input, const size_t inputNbChannels, float* output) const {
+  // accumulates into the interleaved output block, without any allocation
+  _renderPlan.process(framePosition, nbFrames, input, inputNbChannels, output);
 }
 
 std::string AudioObjectRenderer::getSpeakerLabelFromCommonDefinitions(const adm::AudioTrackFormatId& audioTrackFormatId) {
-  std::map<std::string, adm::AudioTrackFormatId> audioTrackFormatBySpeakerLabelMap = adm::audioTrackFormatLookupTable();
-  for(auto& entry : audioTrackFormatBySpeakerLabelMap) {
-    if(entry.second == audioTrackFormatId) {
-      std::cout << "Found AudioTrackFormatId " << adm::formatId(audioTrackFormatId) << " speaker label: " << entry.first << std::endl;
-      return entry.first;
-    }
+  const std::string speakerLabel = CommonDefinitionsIndex::getInstance().getSpeakerLabel(audioTrackFormatId);
+  if(!speakerLabel.empty()) {
+    std::cout << "Found AudioTrackFormatId " << adm::formatId(audioTrackFormatId) << " speaker label: " << speakerLabel << std::endl;
   }
-  return "";
+  return speakerLabel;
 }
 
 std::string AudioObjectRenderer::getAudioTrackFormatSpeakerLabel(const std::shared_ptr<adm::AudioTrackFormat> audioTrackFormat) {
@@ -112,11 +154,6 @@ void AudioObjectRenderer::setDirectSpeakerTrackGains(const adm::AudioPackFormatI
 
   // Add input track id and init gains
   const size_t inputTrackId = audioTrackUid->get<adm::AudioTrackUidId>().get<adm::AudioTrackUidIdValue>().get() - 1;
-  _inputTrackIds.push_back(inputTrackId);
-  _inputTrackGains[inputTrackId] = std::vector<float>(getNbOutputTracks());
-  for (int i = 0; i < getNbOutputTracks(); ++i) {
-    _inputTrackGains[inputTrackId][i] = 1.0;
-  }
 
   // Get speaker label
   const std::string audioPackFormatIdValue = adm::formatId(audioPackFormatId);
@@ -131,34 +168,205 @@ void AudioObjectRenderer::setDirectSpeakerTrackGains(const adm::AudioPackFormatI
 
   std::vector<float> gains(getNbOutputTracks());
   speakerGainCalculator.calculate(speakersTypeMetadata, gains);
-  for (int i = 0; i < gains.size(); ++i) {
-    applyGain(inputTrackId, i, gains[i]);
+  _renderPlan.setInputTrackGains(inputTrackId, gains);
+}
+
+std::shared_ptr<adm::AudioChannelFormat> AudioObjectRenderer::getAudioTrackChannelFormat(const std::shared_ptr<adm::AudioTrackUid>& audioTrackUid) {
+  std::shared_ptr<adm::AudioTrackFormat> audioTrackFormat = audioTrackUid->getReference<adm::AudioTrackFormat>();
+  if(audioTrackFormat) {
+    std::shared_ptr<adm::AudioStreamFormat> audioStreamFormat = audioTrackFormat->getReference<adm::AudioStreamFormat>();
+    if(audioStreamFormat && audioStreamFormat->getReference<adm::AudioChannelFormat>()) {
+      return audioStreamFormat->getReference<adm::AudioChannelFormat>();
+    }
+  }
+  throw std::runtime_error("No AudioChannelFormat found for AudioTrackUid: " + adm::formatId(audioTrackUid->get<adm::AudioTrackUidId>()));
+}
+
+std::vector<GainPoint> getObjectGainPoints(const std::vector<BlockGains>& blockGains,
+                                           const uint64_t objectStart,
+                                           const uint64_t objectEnd,
+                                           const size_t nbOutputChannels) {
+  const std::vector<float> silence(nbOutputChannels, 0.0);
+  std::vector<GainPoint> gainPoints;
+  uint64_t previousBlockEnd = 0;
+  // the gains of a block are held until its end, then the track is silent until the next block
+  const auto closeBlock = [&]() {
+    if(gainPoints.back().frame < previousBlockEnd) {
+      gainPoints.push_back(GainPoint{ previousBlockEnd, gainPoints.back().gains });
+    }
+    gainPoints.push_back(GainPoint{ previousBlockEnd, silence });
+  };
+
+  for(const BlockGains& block : blockGains) {
+    // blocks are clipped to the object extent
+    const uint64_t blockStart = std::max(objectStart + block.span.start, gainPoints.empty() ? 0 : gainPoints.back().frame);
+    const uint64_t blockEnd = block.span.end == UNBOUNDED_FRAME ? objectEnd : std::min(objectStart + block.span.end, objectEnd);
+    if(blockStart >= blockEnd) {
+      continue;
+    }
+
+    if(gainPoints.empty() || blockStart > previousBlockEnd) {
+      // there are no previous gains to ramp from, the gains jump from silence
+      if(!gainPoints.empty()) {
+        closeBlock();
+      }
+      if(blockStart > 0) {
+        gainPoints.push_back(GainPoint{ blockStart, silence });
+      }
+      gainPoints.push_back(GainPoint{ blockStart, block.gains });
+    } else {
+      const std::vector<float> previousGains = gainPoints.back().gains;
+      gainPoints.push_back(GainPoint{ blockStart, previousGains });
+      if(block.interpolationLength <= blockEnd - blockStart) {
+        gainPoints.push_back(GainPoint{ blockStart + block.interpolationLength, block.gains });
+      } else {
+        // the ramp is cut by the object end
+        const float rampRatio = (float)(blockEnd - blockStart) / block.interpolationLength;
+        std::vector<float> gains(nbOutputChannels);
+        for (size_t oc = 0; oc < nbOutputChannels; ++oc) {
+          gains[oc] = previousGains[oc] + (block.gains[oc] - previousGains[oc]) * rampRatio;
+        }
+        gainPoints.push_back(GainPoint{ blockEnd, gains });
+      }
+    }
+    previousBlockEnd = blockEnd;
+  }
+
+  if(gainPoints.empty()) {
+    // no block is active within the object extent
+    gainPoints.push_back(GainPoint{ 0, silence });
+  } else if(previousBlockEnd != UNBOUNDED_FRAME) {
+    closeBlock();
+  }
+  return gainPoints;
+}
+
+void AudioObjectRenderer::setObjectTrackGains(ear::GainCalculatorObjects& objectGainCalculator, const std::shared_ptr<adm::AudioTrackUid>& audioTrackUid) {
+  const size_t inputTrackId = audioTrackUid->get<adm::AudioTrackUidId>().get<adm::AudioTrackUidIdValue>().get() - 1;
+  const std::shared_ptr<adm::AudioChannelFormat> audioChannelFormat = getAudioTrackChannelFormat(audioTrackUid);
+  const std::vector<adm::AudioBlockFormatObjects> audioBlockFormats = audioChannelFormat->getElements<adm::AudioBlockFormatObjects>();
+  if(audioBlockFormats.empty()) {
+    throw std::runtime_error("No AudioBlockFormat found for AudioChannelFormat: " + adm::formatId(audioChannelFormat->get<adm::AudioChannelFormatId>()));
+  }
+
+  // gains are only calculated once per block, then ramp from the previous block gains
+  std::vector<BlockGains> blockGains;
+  std::vector<float> directGains(getNbOutputTracks());
+  std::vector<float> diffuseGains(getNbOutputTracks());
+  bool isDiffuse = false;
+  for(const BlockSpan& blockSpan : _timelineIndex.getBlockSpans(audioChannelFormat->get<adm::AudioChannelFormatId>())) {
+    const adm::AudioBlockFormatObjects& audioBlockFormat = audioBlockFormats[blockSpan.blockIndex];
+    const ear::ObjectsTypeMetadata metadata = toObjectsTypeMetadata(audioBlockFormat);
+    objectGainCalculator.calculate(metadata, directGains, diffuseGains);
+    isDiffuse = isDiffuse || metadata.diffuse > 0.0;
+    std::vector<float> gains(getNbOutputTracks());
+    for (size_t oc = 0; oc < gains.size(); ++oc) {
+      gains[oc] = std::sqrt(directGains[oc] * directGains[oc] + diffuseGains[oc] * diffuseGains[oc]);
+    }
+
+    // a block without duration does not ramp
+    uint64_t interpolationLength = blockSpan.end == UNBOUNDED_FRAME ? 0 : blockSpan.end - blockSpan.start;
+    const adm::JumpPosition jumpPosition = audioBlockFormat.get<adm::JumpPosition>();
+    if(jumpPosition.get<adm::JumpPositionFlag>().get()) {
+      const uint64_t jumpLength = jumpPosition.has<adm::InterpolationLength>() ? _timelineIndex.toFrames(jumpPosition.get<adm::InterpolationLength>().get()) : 0;
+      interpolationLength = std::min(interpolationLength, jumpLength);
+    }
+    blockGains.push_back(BlockGains{ blockSpan, interpolationLength, gains });
+  }
+
+  const std::vector<GainPoint> gainPoints = getObjectGainPoints(blockGains,
+                                                                _timelineIndex.getObjectStart(_audioObject),
+                                                                _timelineIndex.getObjectEnd(_audioObject),
+                                                                getNbOutputTracks());
+  const bool isStatic = std::all_of(gainPoints.begin(), gainPoints.end(), [&](const GainPoint& gainPoint) { return gainPoint.gains == gainPoints.front().gains; });
+
+  if(isDiffuse) {
+    std::cout << "[WARNING] Diffuse gains of AudioChannelFormat " << adm::formatId(audioChannelFormat->get<adm::AudioChannelFormatId>())
+              << " are mixed in power with direct gains, without decorrelation filters." << std::endl;
+  }
+  if(isStatic) {
+    _renderPlan.setInputTrackGains(inputTrackId, gainPoints.front().gains);
+  } else {
+    _renderPlan.setInputTrackGains(inputTrackId, gainPoints);
+  }
+}
+
+void AudioObjectRenderer::setHoaTrackGains(const std::vector<std::shared_ptr<adm::AudioTrackUid>>& audioTrackUids) {
+  // the decode matrix applies to all the HOA channels of the pack at once
+  ear::HOATypeMetadata hoaTypeMetadata;
+  for(auto audioTrackUid : audioTrackUids) {
+    const std::shared_ptr<adm::AudioChannelFormat> audioChannelFormat = getAudioTrackChannelFormat(audioTrackUid);
+    const std::vector<adm::AudioBlockFormatHoa> audioBlockFormats = audioChannelFormat->getElements<adm::AudioBlockFormatHoa>();
+    if(audioBlockFormats.empty()) {
+      throw std::runtime_error("No AudioBlockFormat found for AudioChannelFormat: " + adm::formatId(audioChannelFormat->get<adm::AudioChannelFormatId>()));
+    }
+    if(audioBlockFormats.size() > 1) {
+      std::cout << "[WARNING] Only the first AudioBlockFormat of AudioChannelFormat " << adm::formatId(audioChannelFormat->get<adm::AudioChannelFormatId>())
+                << " is rendered (HOA parameters are not expected to change over time)." << std::endl;
+    }
+    const adm::AudioBlockFormatHoa& audioBlockFormat = audioBlockFormats.front();
+    hoaTypeMetadata.orders.push_back(audioBlockFormat.get<adm::Order>().get());
+    hoaTypeMetadata.degrees.push_back(audioBlockFormat.get<adm::Degree>().get());
+    // normalization and near-field reference distance are pack-wide parameters
+    const std::string normalization = audioBlockFormat.get<adm::Normalization>().get();
+    const double nfcRefDist = audioBlockFormat.get<adm::NfcRefDist>().get();
+    if(hoaTypeMetadata.orders.size() > 1 && (normalization != hoaTypeMetadata.normalization || nfcRefDist != hoaTypeMetadata.nfcRefDist)) {
+      throw std::runtime_error("HOA normalization and near-field reference distance of AudioChannelFormat " + adm::formatId(audioChannelFormat->get<adm::AudioChannelFormatId>())
+                               + " differ from the other channels of the pack.");
+    }
+    hoaTypeMetadata.normalization = normalization;
+    hoaTypeMetadata.nfcRefDist = nfcRefDist;
+    hoaTypeMetadata.screenRef = audioBlockFormat.get<adm::ScreenRef>().get();
+  }
+
+  // decode matrix by output channel (rows) and HOA channel (columns)
+  ear::GainCalculatorHOA hoaGainCalculator(_outputLayout);
+  std::vector<std::vector<float>> decodeMatrix(getNbOutputTracks(), std::vector<float>(audioTrackUids.size()));
+  hoaGainCalculator.calculate(hoaTypeMetadata, decodeMatrix);
+
+  for (size_t channel = 0; channel < audioTrackUids.size(); ++channel) {
+    const size_t inputTrackId = audioTrackUids[channel]->get<adm::AudioTrackUidId>().get<adm::AudioTrackUidIdValue>().get() - 1;
+    std::vector<float> gains(getNbOutputTracks());
+    for (size_t oc = 0; oc < gains.size(); ++oc) {
+      gains[oc] = decodeMatrix[oc][channel];
+    }
+    _renderPlan.setInputTrackGains(inputTrackId, gains);
   }
 }
 
 void AudioObjectRenderer::init() {
   for(auto audioPackFormat : getAudioPackFormats(_audioObject)) {
     const adm::TypeDescriptor typeDescriptor = audioPackFormat->get<adm::TypeDescriptor>();
+    std::vector<std::shared_ptr<adm::AudioTrackUid>> audioTrackUids = getAudioTrackUids(_audioObject);
     switch(typeDescriptor.get()) {
-      case 1: // TypeDefinition::DIRECT_SPEAKERS
+      case 1: { // TypeDefinition::DIRECT_SPEAKERS
+        // Render to direct speaker:
+        const adm::AudioPackFormatId audioPackFormatId = audioPackFormat->get<adm::AudioPackFormatId>();
+        for(auto audioTrackUid : audioTrackUids) {
+          setDirectSpeakerTrackGains(audioPackFormatId, audioTrackUid);
+        }
+        checkAudioPackFormatId(audioPackFormatId, audioTrackUids.size());
         break;
+      }
+      case 3: { // TypeDefinition::OBJECTS
+        // Render each object channel along its block timeline:
+        ear::GainCalculatorObjects objectGainCalculator(_outputLayout);
+        for(auto audioTrackUid : audioTrackUids) {
+          setObjectTrackGains(objectGainCalculator, audioTrackUid);
+        }
+        break;
+      }
+      case 4: { // TypeDefinition::HOA
+        // Decode the whole pack with a single matrix, applied as constant gains:
+        setHoaTrackGains(audioTrackUids);
+        break;
+      }
       case 0: // TypeDefinition::UNDEFINED
       case 2: // TypeDefinition::MATRIX
-      case 3: // TypeDefinition::OBJECTS
-      case 4: // TypeDefinition::HOA
       case 5: // TypeDefinition::BINAURAL
       default:
-        std::cerr << "Unsupported type descriptor: " << adm::formatTypeDefinition(typeDescriptor) << std::endl;
-        exit(1);
-    }
-
-    // Render to direct speaker:
-    std::vector<std::shared_ptr<adm::AudioTrackUid>> audioTrackUids = getAudioTrackUids(_audioObject);
-    const adm::AudioPackFormatId audioPackFormatId = audioPackFormat->get<adm::AudioPackFormatId>();
-    for(auto audioTrackUid : audioTrackUids) {
-      setDirectSpeakerTrackGains(audioPackFormatId, audioTrackUid);
+        throw std::runtime_error("Unsupported type descriptor: " + adm::formatTypeDefinition(typeDescriptor));
     }
-    checkAudioPackFormatId(audioPackFormatId, audioTrackUids.size());
   }
 }
 
@@ -173,25 +381,21 @@ void AudioObjectRenderer::checkAudioPackFormatId(const adm::AudioPackFormatId& a
     // case 0x03: expectedNbTracks = 6; break;
     default:
       // See ITU-R BS.2094-1: Common definitions for the Audio Definition Model
-      std::cerr << "AudioPackFormat not supported yet: " << adm::formatId(audioPackFormatId) << std::endl;
-      exit(1);
-      break;
+      throw std::runtime_error("AudioPackFormat not supported yet: " + adm::formatId(audioPackFormatId));
   }
 
   if(expectedNbTracks != nbAudioTracks) {
-    std::cerr << "AudioPackFormat does not fit the number of tracks tracks: " << nbAudioTracks << std::endl;
-    exit(1);
+    throw std::runtime_error("AudioPackFormat " + adm::formatId(audioPackFormatId) + " does not fit the number of tracks: " + std::to_string(nbAudioTracks));
   }
 }
 
 
 std::ostream& operator<<(std::ostream& os, const AudioObjectRenderer& renderer) {
   os << "Gains: ";
-  for (const size_t inputTrackId : renderer._inputTrackIds) {
+  for (const size_t inputTrackId : renderer._renderPlan.getInputTrackIds()) {
     os << "{ input track " << inputTrackId << ": " ;
-    std::vector<float> gains = renderer._inputTrackGains.at(inputTrackId);
-    for (int oc = 0; oc < gains.size(); ++oc) {
-      os << "{ oc: " << oc << " => gain: " << gains.at(oc) << " } ";
+    for (size_t oc = 0; oc < renderer.getNbOutputTracks(); ++oc) {
+      os << "{ oc: " << oc << " => gain: " << renderer.getTrackGain(inputTrackId, oc) << " } ";
     }
     os << "} ";
   }
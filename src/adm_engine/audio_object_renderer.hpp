@@ -4,28 +4,58 @@
 #include <adm/adm.hpp>
 #include <bw64/bw64.hpp>
 
+#include "render_plan.hpp"
+#include "timeline_index.hpp"
+
 namespace admengine {
 
+/// Gains of an Objects block, over its span relative to the object start
+struct BlockGains {
+  BlockSpan span;
+  /// Number of frames the gains ramp over from the previous block gains
+  uint64_t interpolationLength;
+  std::vector<float> gains;
+};
+
+/// Gain points of an Objects track, ramping from block to block, and null outside the blocks
+/// and the object extent (see Rec. ITU-R BS.2127-0, 7.2)
+std::vector<GainPoint> getObjectGainPoints(const std::vector<BlockGains>& blockGains,
+                                           const uint64_t objectStart,
+                                           const uint64_t objectEnd,
+                                           const size_t nbOutputChannels);
+
 class AudioObjectRenderer {
 
 public:
   AudioObjectRenderer(const ear::Layout& outputLayout,
                       const std::shared_ptr<adm::AudioObject>& audioObject,
-                      const std::shared_ptr<bw64::ChnaChunk>& chnaChunk);
+                      const std::shared_ptr<bw64::ChnaChunk>& chnaChunk,
+                      const TimelineIndex& timelineIndex);
+  /// Renderer of a previously computed render plan (see RenderPlanCache), that does not compute any gain
+  AudioObjectRenderer(const ear::Layout& outputLayout,
+                      const std::shared_ptr<adm::AudioObject>& audioObject,
+                      const std::shared_ptr<bw64::ChnaChunk>& chnaChunk,
+                      const TimelineIndex& timelineIndex,
+                      const RenderPlan& renderPlan);
 
   float getTrackGain(const size_t& inputTrackId, const size_t& outputTrackId) const;
   void applyUserGain(const float& gain);
   void applyGain(const size_t& inputTrackId, const size_t& outputTrackId, const float& gain);
 
   size_t getNbOutputTracks() const;
+  const RenderPlan& getRenderPlan() const { return _renderPlan; }
 
-  void renderAudioFrame(const float* in, float* out);
+  void renderAudioFrame(const uint64_t framePosition, const float* in, float* out) const;
+  void processBlock(const uint64_t framePosition, const size_t nbFrames, const float* in, const size_t inputNbChannels, float* out) const;
 
 private:
   std::string getSpeakerLabelFromCommonDefinitions(const adm::AudioTrackFormatId& audioTrackFormatId);
   std::string getAudioTrackFormatSpeakerLabel(const std::shared_ptr<adm::AudioTrackFormat> audioTrackFormat);
   std::string getAudioTrackSpeakerLabel(const std::shared_ptr<adm::AudioTrackUid>& audioTrackUid);
   void setDirectSpeakerTrackGains(const adm::AudioPackFormatId& audioPackFormatId, const std::shared_ptr<adm::AudioTrackUid>& audioTrackUid);
+  std::shared_ptr<adm::AudioChannelFormat> getAudioTrackChannelFormat(const std::shared_ptr<adm::AudioTrackUid>& audioTrackUid);
+  void setObjectTrackGains(ear::GainCalculatorObjects& objectGainCalculator, const std::shared_ptr<adm::AudioTrackUid>& audioTrackUid);
+  void setHoaTrackGains(const std::vector<std::shared_ptr<adm::AudioTrackUid>>& audioTrackUids);
   void init();
 
   void checkAudioPackFormatId(const adm::AudioPackFormatId& audioPackFormatId, const size_t nbAudioTracks);
@@ -36,11 +66,11 @@ private:
   const ear::Layout _outputLayout;
   const std::shared_ptr<adm::AudioObject> _audioObject;
   const std::shared_ptr<bw64::ChnaChunk> _chnaChunk;
+  /// Block timings of the document channels, in frames of the input tracks
+  const TimelineIndex& _timelineIndex;
 
-  /// Index of input channels
-  std::vector<size_t> _inputTrackIds;
-  /// Output channel gains (values) by input channel indexes (keys)
-  std::map<size_t, std::vector<float>> _inputTrackGains;
+  /// Output channel gains by input channel indexes (and over time, for Objects)
+  RenderPlan _renderPlan;
 };
 
 std::ostream& operator<<(std::ostream& os, const AudioObjectRenderer& renderer);
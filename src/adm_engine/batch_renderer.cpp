@@ -0,0 +1,278 @@
+#include "batch_renderer.hpp"
+
+#include "block_queue.hpp"
+#include "parser.hpp"
+#include "renderer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+namespace admengine {
+
+namespace {
+
+/// Memory taken by the ADM document, by byte of axml (elements, references and parsing buffers)
+const uint64_t ADM_DOCUMENT_MEMORY_FACTOR = 8;
+
+std::vector<std::string> splitManifestLine(const std::string& line) {
+  std::vector<std::string> arguments;
+  std::string argument;
+  bool quoted = false;
+  bool inArgument = false;
+  for(const char c : line) {
+    if(c == '"') {
+      quoted = !quoted;
+      inArgument = true;
+    } else if(!quoted && (c == ' ' || c == '\t' || c == '\r')) {
+      if(inArgument) {
+        arguments.push_back(argument);
+        argument.clear();
+        inArgument = false;
+      }
+    } else {
+      argument += c;
+      inArgument = true;
+    }
+  }
+  if(quoted) {
+    throw std::runtime_error("missing closing quote");
+  }
+  if(inArgument) {
+    arguments.push_back(argument);
+  }
+  return arguments;
+}
+
+BatchJob parseBatchJob(const std::vector<std::string>& arguments) {
+  BatchJob job;
+  job.inputFilePath = arguments[0];
+  for (size_t i = 1; i < arguments.size(); ++i) {
+    const std::string& arg = arguments[i];
+    if(i + 1 == arguments.size()) {
+      throw std::runtime_error("missing value of argument '" + arg + "'");
+    }
+    const std::string& value = arguments[++i];
+    if(arg == "-o") {
+      job.outputDirectory = value;
+    } else if(arg == "-e") {
+      job.elementIdToRender = value;
+    } else if(arg == "-g") {
+      const size_t splitPos = value.find("=");
+      if(splitPos == std::string::npos) {
+        throw std::runtime_error("invalid gain '" + value + "', expecting ELEMENT_ID=GAIN");
+      }
+      job.elementGains[value.substr(0, splitPos)] = pow(10.0, std::atof(value.substr(splitPos + 1).c_str()) / 20.0);
+    } else if(arg == "-l") {
+      job.outputLayouts.push_back(value);
+    } else if(arg == "-j") {
+      job.nbThreads = std::max(std::atoi(value.c_str()), 1);
+    } else if(arg == "-b") {
+      job.blockSize = std::max(std::atoi(value.c_str()), 1);
+    } else if(arg == "-q") {
+      job.queueDepth = std::max(std::atoi(value.c_str()), 0);
+    } else {
+      throw std::runtime_error("unexpected argument '" + arg + "'");
+    }
+  }
+  if(job.outputDirectory.empty()) {
+    throw std::runtime_error("missing output directory");
+  }
+  return job;
+}
+
+uint64_t getMemoryEstimate(const std::unique_ptr<bw64::Bw64Reader>& inputFile,
+                           const std::vector<std::string>& outputLayouts,
+                           const size_t blockSize,
+                           const size_t queueDepth) {
+  uint64_t memoryEstimate = 0;
+  if(const std::shared_ptr<bw64::AxmlChunk> axmlChunk = parseAdmXmlChunk(inputFile)) {
+    memoryEstimate += axmlChunk->data().size() * ADM_DOCUMENT_MEMORY_FACTOR;
+  }
+  // one input and one output block per layout, for each block in flight
+  uint64_t nbChannels = inputFile->channels();
+  for(const std::string& outputLayout : outputLayouts) {
+    nbChannels += getOutputLayout(outputLayout).channels().size();
+  }
+  memoryEstimate += (queueDepth + 2) * blockSize * nbChannels * sizeof(float);
+  return memoryEstimate;
+}
+
+}
+
+std::vector<BatchJob> parseBatchManifest(const std::string& manifestPath) {
+  std::ifstream manifest(manifestPath);
+  if(!manifest) {
+    throw std::runtime_error("Could not open batch manifest: " + manifestPath);
+  }
+  std::vector<BatchJob> jobs;
+  std::string line;
+  size_t lineNumber = 0;
+  while(std::getline(manifest, line)) {
+    ++lineNumber;
+    const size_t firstChar = line.find_first_not_of(" \t\r");
+    if(firstChar == std::string::npos || line[firstChar] == '#') {
+      continue;
+    }
+    try {
+      jobs.push_back(parseBatchJob(splitManifestLine(line)));
+    } catch(const std::exception& e) {
+      std::stringstream message;
+      message << "Invalid batch manifest line " << lineNumber << ": " << e.what();
+      throw std::runtime_error(message.str());
+    }
+  }
+  return jobs;
+}
+
+void writeBatchReport(const std::vector<BatchJobReport>& reports, const std::string& reportPath) {
+  std::ofstream report(reportPath);
+  if(!report) {
+    throw std::runtime_error("Could not create batch report: " + reportPath);
+  }
+  report << "# input\toutput\telement\tstatus\tduration (s)\tthreads\tmemory estimate (bytes)\tmessage\n";
+  for(const BatchJobReport& jobReport : reports) {
+    report << jobReport.job.inputFilePath << "\t"
+           << jobReport.job.outputDirectory << "\t"
+           << jobReport.job.elementIdToRender << "\t"
+           << (jobReport.succeeded ? "succeeded" : "failed") << "\t"
+           << jobReport.duration << "\t"
+           << jobReport.nbThreads << "\t"
+           << jobReport.memoryEstimate << "\t"
+           << jobReport.message << "\n";
+  }
+}
+
+BatchRenderer::BatchRenderer(const size_t nbConcurrentJobs, const uint64_t memoryBudget, const size_t threadBudget)
+  : _nbConcurrentJobs(nbConcurrentJobs ? nbConcurrentJobs : 1)
+  , _memoryBudget(memoryBudget)
+  , _threadBudget(threadBudget)
+  , _defaultOutputLayouts({ DEFAULT_OUTPUT_LAYOUT })
+  , _nbThreads(1)
+  , _blockSize(BLOCK_SIZE)
+  , _queueDepth(DEFAULT_QUEUE_DEPTH)
+  , _memoryMapped(false)
+  , _renderPlanCache(std::make_shared<RenderPlanCache>())
+  , _reservedMemory(0)
+  , _reservedThreads(0)
+{
+}
+
+void BatchRenderer::setDefaultOutputLayouts(const std::vector<std::string>& outputLayouts) {
+  _defaultOutputLayouts = outputLayouts;
+}
+
+void BatchRenderer::setNbThreads(const size_t nbThreads) {
+  _nbThreads = nbThreads;
+}
+
+void BatchRenderer::setBlockSize(const size_t blockSize) {
+  _blockSize = blockSize;
+}
+
+void BatchRenderer::setQueueDepth(const size_t queueDepth) {
+  _queueDepth = queueDepth;
+}
+
+void BatchRenderer::setMemoryMapped(const bool memoryMapped) {
+  _memoryMapped = memoryMapped;
+}
+
+void BatchRenderer::setRenderPlanCache(const std::shared_ptr<RenderPlanCache>& renderPlanCache) {
+  _renderPlanCache = renderPlanCache;
+}
+
+std::vector<BatchJobReport> BatchRenderer::process(const std::vector<BatchJob>& jobs) {
+  std::vector<BatchJobReport> reports(jobs.size());
+  // jobs are queued as they are taken, so that no more than one job per thread is pending
+  BlockQueue<size_t> jobQueue(_nbConcurrentJobs);
+  std::vector<std::thread> jobThreads;
+  for (size_t i = 0; i < _nbConcurrentJobs; ++i) {
+    jobThreads.emplace_back([this, &jobs, &reports, &jobQueue]() {
+      std::chrono::nanoseconds stallTime(0);
+      size_t jobIndex;
+      while(jobQueue.pop(jobIndex, stallTime)) {
+        std::cout << " >> Batch job " << (jobIndex + 1) << "/" << jobs.size() << ": " << jobs[jobIndex].inputFilePath << std::endl;
+        reports[jobIndex] = render(jobs[jobIndex]);
+      }
+    });
+  }
+  std::chrono::nanoseconds stallTime(0);
+  for (size_t jobIndex = 0; jobIndex < jobs.size(); ++jobIndex) {
+    jobQueue.push(jobIndex, stallTime);
+  }
+  jobQueue.close();
+  for(std::thread& jobThread : jobThreads) {
+    jobThread.join();
+  }
+
+  size_t nbFailedJobs = 0;
+  for(const BatchJobReport& report : reports) {
+    if(!report.succeeded) {
+      std::cout << "[WARNING] Batch job failed: " << report.job.inputFilePath << ": " << report.message << std::endl;
+      nbFailedJobs++;
+    }
+  }
+  std::cout << " >> Batch rendered: " << (jobs.size() - nbFailedJobs) << "/" << jobs.size() << " jobs succeeded" << std::endl;
+  return reports;
+}
+
+BatchJobReport BatchRenderer::render(const BatchJob& job, const ProgressCallback& progressCallback) {
+  const auto start = std::chrono::steady_clock::now();
+  BatchJobReport report{ job, false, "", 0.0, 0, job.nbThreads ? job.nbThreads : _nbThreads };
+  if(report.job.outputLayouts.empty()) {
+    report.job.outputLayouts = _defaultOutputLayouts;
+  }
+  bool resourcesReserved = false;
+  try {
+    const size_t blockSize = job.blockSize ? job.blockSize : _blockSize;
+    const size_t queueDepth = job.queueDepth >= 0 ? job.queueDepth : _queueDepth;
+    auto bw64File = bw64::readFile(job.inputFilePath);
+    report.memoryEstimate = getMemoryEstimate(bw64File, report.job.outputLayouts, blockSize, queueDepth);
+    reserveResources(report.memoryEstimate, report.nbThreads);
+    resourcesReserved = true;
+
+    Renderer renderer(bw64File, report.job.outputLayouts, job.outputDirectory, job.elementGains, job.elementIdToRender);
+    renderer.setNbThreads(report.nbThreads);
+    renderer.setBlockSize(blockSize);
+    renderer.setQueueDepth(queueDepth);
+    renderer.setInputFilePath(job.inputFilePath, job.memoryMapped || _memoryMapped);
+    renderer.setRenderPlanCache(job.renderPlanCache ? job.renderPlanCache : _renderPlanCache);
+    renderer.setProgressCallback(progressCallback);
+    renderer.process();
+    report.succeeded = true;
+  } catch(const std::exception& e) {
+    report.message = e.what();
+  }
+  if(resourcesReserved) {
+    releaseResources(report.memoryEstimate, report.nbThreads);
+  }
+  report.duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return report;
+}
+
+void BatchRenderer::reserveResources(const uint64_t memoryEstimate, const size_t nbThreads) {
+  std::unique_lock<std::mutex> lock(_resourcesMutex);
+  // a job exceeding a whole budget waits for all others to complete
+  _resourcesReleased.wait(lock, [this, memoryEstimate, nbThreads]{
+    const bool memoryAvailable = _memoryBudget == 0 || _reservedMemory + memoryEstimate <= _memoryBudget;
+    const bool threadsAvailable = _threadBudget == 0 || _reservedThreads + nbThreads <= _threadBudget;
+    return (_reservedMemory == 0 && _reservedThreads == 0) || (memoryAvailable && threadsAvailable);
+  });
+  _reservedMemory += memoryEstimate;
+  _reservedThreads += nbThreads;
+}
+
+void BatchRenderer::releaseResources(const uint64_t memoryEstimate, const size_t nbThreads) {
+  std::lock_guard<std::mutex> lock(_resourcesMutex);
+  _reservedMemory -= memoryEstimate;
+  _reservedThreads -= nbThreads;
+  _resourcesReleased.notify_all();
+}
+
+}
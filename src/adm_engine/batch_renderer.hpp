@@ -0,0 +1,111 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "render_plan_cache.hpp"
+#include "renderer.hpp"
+
+namespace admengine {
+
+const size_t DEFAULT_NB_CONCURRENT_JOBS = 1;
+
+/// Rendering of one BW64/ADM file, as described by a line of a batch manifest
+struct BatchJob {
+  std::string inputFilePath;
+  std::string outputDirectory;
+  std::string elementIdToRender;
+  std::map<std::string, float> elementGains;
+  /// Output layouts (the batch default ones if empty)
+  std::vector<std::string> outputLayouts;
+  /// Rendering threads (the batch default number if null)
+  size_t nbThreads = 0;
+  /// Frames rendered per block (the batch default size if null)
+  size_t blockSize = 0;
+  /// Blocks buffered between the pipeline stages, 0 disabling the pipeline (the batch default depth if negative)
+  int queueDepth = -1;
+  /// Read the input file through a memory mapping (also if the batch option is set)
+  bool memoryMapped = false;
+  /// Render plan cache (the batch one if null)
+  std::shared_ptr<RenderPlanCache> renderPlanCache;
+};
+
+struct BatchJobReport {
+  BatchJob job;
+  bool succeeded;
+  /// Error message of a failed job
+  std::string message;
+  double duration; // in seconds
+  /// Memory reserved for the job, against the batch memory budget
+  uint64_t memoryEstimate; // in bytes
+  size_t nbThreads;
+};
+
+/**
+ * Parse a batch manifest: one job per line, with the arguments of a single rendering:
+ *   INPUT -o OUTPUT [-e ELEMENT_ID] [-g ELEMENT_ID=GAIN]... [-l LAYOUT]... [-j THREADS] [-b BLOCK_SIZE] [-q QUEUE_DEPTH]
+ * Arguments are separated by spaces (double-quoted if they contain some), gains are in dB.
+ * Empty lines and lines starting with '#' are ignored.
+ */
+std::vector<BatchJob> parseBatchManifest(const std::string& manifestPath);
+
+/// Write the job reports as tab-separated values, one job per line
+void writeBatchReport(const std::vector<BatchJobReport>& reports, const std::string& reportPath);
+
+/**
+ * Renderer of many BW64/ADM files in a single process.
+ *
+ * Jobs go through a bounded queue to a fixed number of job threads, or are submitted one by one
+ * from the caller threads. Output layouts, common definitions and render plans are shared by all
+ * jobs. Each job reserves its rendering threads and an estimate of its memory (ADM document and
+ * rendering buffers) before rendering, and waits until the other jobs release enough of the thread
+ * and memory budgets. A job exceeding a whole budget runs alone.
+ */
+class BatchRenderer {
+
+public:
+  /// Null budgets do not limit the concurrent jobs
+  BatchRenderer(const size_t nbConcurrentJobs = DEFAULT_NB_CONCURRENT_JOBS, const uint64_t memoryBudget = 0, const size_t threadBudget = 0);
+  BatchRenderer(const BatchRenderer&) = delete;
+  BatchRenderer& operator=(const BatchRenderer&) = delete;
+
+  /// Options applied to every job
+  void setDefaultOutputLayouts(const std::vector<std::string>& outputLayouts);
+  void setNbThreads(const size_t nbThreads);
+  void setBlockSize(const size_t blockSize);
+  void setQueueDepth(const size_t queueDepth);
+  void setMemoryMapped(const bool memoryMapped);
+  void setRenderPlanCache(const std::shared_ptr<RenderPlanCache>& renderPlanCache);
+
+  /// Render all jobs, a failing job not stopping the others, and return their reports in the jobs order
+  std::vector<BatchJobReport> process(const std::vector<BatchJob>& jobs);
+  /// Render a single job, once the budgets allow it (thread-safe: jobs can be submitted concurrently)
+  BatchJobReport render(const BatchJob& job, const ProgressCallback& progressCallback = ProgressCallback());
+
+private:
+  void reserveResources(const uint64_t memoryEstimate, const size_t nbThreads);
+  void releaseResources(const uint64_t memoryEstimate, const size_t nbThreads);
+
+private:
+  const size_t _nbConcurrentJobs;
+  const uint64_t _memoryBudget;
+  const size_t _threadBudget;
+  std::vector<std::string> _defaultOutputLayouts;
+  size_t _nbThreads;
+  size_t _blockSize;
+  size_t _queueDepth;
+  bool _memoryMapped;
+  std::shared_ptr<RenderPlanCache> _renderPlanCache;
+
+  std::mutex _resourcesMutex;
+  std::condition_variable _resourcesReleased;
+  uint64_t _reservedMemory;
+  size_t _reservedThreads;
+};
+
+}
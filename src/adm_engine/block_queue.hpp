@@ -0,0 +1,78 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+namespace admengine {
+
+/**
+ * Bounded FIFO ring buffer, passing items between two pipeline stages.
+ *
+ * Both push and pop block while the queue is full (respectively empty), and add the time they
+ * waited to the given stall time. Once closed, push fails and pop only drains remaining items.
+ */
+template <class T>
+class BlockQueue {
+
+public:
+  BlockQueue(const size_t capacity)
+    : _items(capacity ? capacity : 1)
+    , _head(0)
+    , _size(0)
+    , _closed(false)
+  {
+  }
+
+  bool push(const T& item, std::chrono::nanoseconds& stallTime) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    if(_size == _items.size() && !_closed) {
+      const auto start = std::chrono::steady_clock::now();
+      _notFull.wait(lock, [this]{ return _size < _items.size() || _closed; });
+      stallTime += std::chrono::steady_clock::now() - start;
+    }
+    if(_closed) {
+      return false;
+    }
+    _items[(_head + _size) % _items.size()] = item;
+    _size++;
+    _notEmpty.notify_one();
+    return true;
+  }
+
+  bool pop(T& item, std::chrono::nanoseconds& stallTime) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    if(_size == 0 && !_closed) {
+      const auto start = std::chrono::steady_clock::now();
+      _notEmpty.wait(lock, [this]{ return _size > 0 || _closed; });
+      stallTime += std::chrono::steady_clock::now() - start;
+    }
+    if(_size == 0) {
+      return false;
+    }
+    item = _items[_head];
+    _head = (_head + 1) % _items.size();
+    _size--;
+    _notFull.notify_one();
+    return true;
+  }
+
+  void close() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _closed = true;
+    _notEmpty.notify_all();
+    _notFull.notify_all();
+  }
+
+private:
+  std::vector<T> _items;
+  size_t _head;
+  size_t _size;
+  bool _closed;
+  std::mutex _mutex;
+  std::condition_variable _notEmpty;
+  std::condition_variable _notFull;
+};
+
+}
@@ -0,0 +1,38 @@
+
+#include "buffer_pool.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+namespace admengine {
+
+BufferPool::AlignedBuffer::AlignedBuffer(const size_t size)
+  : storage(nullptr)
+  , data(nullptr)
+  , nbSamples(size)
+{
+  storage = std::calloc(nbSamples * sizeof(float) + BUFFER_ALIGNMENT, 1);
+  if(!storage) {
+    throw std::bad_alloc();
+  }
+  const uintptr_t address = reinterpret_cast<uintptr_t>(storage);
+  data = reinterpret_cast<float*>((address + BUFFER_ALIGNMENT - 1) / BUFFER_ALIGNMENT * BUFFER_ALIGNMENT);
+}
+
+BufferPool::AlignedBuffer::~AlignedBuffer() {
+  std::free(storage);
+}
+
+float* BufferPool::getBuffer(const size_t bufferIndex, const size_t nbSamples) {
+  if(bufferIndex >= _buffers.size()) {
+    _buffers.resize(bufferIndex + 1);
+  }
+  std::unique_ptr<AlignedBuffer>& buffer = _buffers[bufferIndex];
+  if(!buffer || buffer->nbSamples < nbSamples) {
+    buffer.reset(new AlignedBuffer(nbSamples));
+  }
+  return buffer->data;
+}
+
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace admengine {
+
+const size_t BUFFER_ALIGNMENT = 64; // in bytes
+
+/**
+ * Pool of 64-byte aligned sample buffers, reused from one rendering to the next.
+ *
+ * Buffers are identified by index, and only grow: once they have been sized for a rendering,
+ * getting them again does not allocate. Buffers are heap-allocated, hence usable from threads
+ * with small stacks. Getting buffers is not thread-safe, but the returned buffers stay valid
+ * (and at the same address) until they are grown again.
+ */
+class BufferPool {
+
+public:
+  BufferPool() = default;
+  BufferPool(const BufferPool&) = delete;
+  BufferPool& operator=(const BufferPool&) = delete;
+
+  /// Get the buffer of the given index, holding at least nbSamples floats (content is not preserved on growth)
+  float* getBuffer(const size_t bufferIndex, const size_t nbSamples);
+
+private:
+  struct AlignedBuffer {
+    AlignedBuffer(const size_t size);
+    ~AlignedBuffer();
+
+    void* storage;
+    float* data;
+    size_t nbSamples;
+  };
+
+  std::vector<std::unique_ptr<AlignedBuffer>> _buffers;
+};
+
+}
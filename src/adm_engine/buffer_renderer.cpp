@@ -0,0 +1,111 @@
+#include "buffer_renderer.hpp"
+
+#include "adm_helper.hpp"
+#include "parser.hpp"
+
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace admengine {
+
+BufferRenderer::BufferRenderer(const char* axmlData,
+                               const size_t axmlSize,
+                               const char* chnaData,
+                               const size_t chnaSize,
+                               const uint16_t nbInputChannels,
+                               const uint32_t sampleRate,
+                               const std::vector<std::string>& outputLayouts,
+                               const std::map<std::string, float> elementGains,
+                               const std::string& elementIdToRender,
+                               const std::shared_ptr<RenderPlanCache>& renderPlanCache)
+  : _renderer(std::make_shared<bw64::AxmlChunk>(std::string(axmlData, axmlSize)),
+              chnaData && chnaSize ? parseAdmChnaChunk(chnaData, chnaSize) : std::shared_ptr<bw64::ChnaChunk>(),
+              nbInputChannels,
+              sampleRate,
+              outputLayouts,
+              elementGains,
+              elementIdToRender)
+  , _blockSize(BLOCK_SIZE)
+  , _framePosition(0)
+{
+  _renderer.setRenderPlanCache(renderPlanCache);
+  for(auto audioProgramme : _renderer.getDocumentAudioProgrammes()) {
+    if(elementIdToRender.empty() || elementIdToRender == formatId(audioProgramme->get<adm::AudioProgrammeId>())) {
+      std::cout << "### Render audio programme: " << toString(audioProgramme) << std::endl;
+      _elementId = formatId(audioProgramme->get<adm::AudioProgrammeId>());
+      _renderer.initAudioProgrammeRendering(audioProgramme);
+      initOutputs(audioProgramme);
+      return;
+    }
+  }
+  for(auto audioObject : _renderer.getDocumentAudioObjects()) {
+    if(elementIdToRender.empty() || elementIdToRender == formatId(audioObject->get<adm::AudioObjectId>())) {
+      std::cout << "### Render audio object: " << toString(audioObject) << std::endl;
+      _elementId = formatId(audioObject->get<adm::AudioObjectId>());
+      _renderer.initAudioObjectRendering(audioObject);
+      initOutputs(audioObject);
+      return;
+    }
+  }
+  std::stringstream message;
+  if(elementIdToRender.empty()) {
+    message << "Could not find any audio programme or audio object to render.";
+  } else {
+    message << "Could not find any audio element from ID: '" << elementIdToRender << "'. ";
+  }
+  throw std::runtime_error(message.str());
+}
+
+void BufferRenderer::setBlockSize(const size_t blockSize) {
+  if(blockSize == 0) {
+    throw std::runtime_error("Rendering block size must not be null.");
+  }
+  _blockSize = blockSize;
+}
+
+void BufferRenderer::initOutputs(const std::shared_ptr<adm::AudioProgramme>& audioProgramme) {
+  for (size_t layoutIndex = 0; layoutIndex < _renderer.getNbOutputLayouts(); ++layoutIndex) {
+    addOutputChunks(createAdmDocument(audioProgramme, _renderer.getLayout(layoutIndex)));
+  }
+}
+
+void BufferRenderer::initOutputs(const std::shared_ptr<adm::AudioObject>& audioObject) {
+  for (size_t layoutIndex = 0; layoutIndex < _renderer.getNbOutputLayouts(); ++layoutIndex) {
+    addOutputChunks(createAdmDocument(audioObject, _renderer.getLayout(layoutIndex)));
+  }
+}
+
+void BufferRenderer::addOutputChunks(const std::shared_ptr<adm::Document>& document) {
+  _outputAxmlData.push_back(createAxmlChunk(document)->data());
+  // the 'chna' chunk data, as written in a file, after its header
+  std::stringstream chnaData;
+  createChnaChunk(document)->write(chnaData);
+  _outputChnaData.push_back(chnaData.str());
+}
+
+void BufferRenderer::process(const float* input, const size_t nbFrames, float* const* outputs) {
+  for (size_t layoutIndex = 0; layoutIndex < _renderer.getNbOutputLayouts(); ++layoutIndex) {
+    // caller buffers may hold anything, they are overwritten
+    _renderer.processBlock(_framePosition, nbFrames, input, outputs[layoutIndex], layoutIndex, false);
+  }
+  _framePosition += nbFrames;
+}
+
+void BufferRenderer::render(const BufferReadCallback& readCallback, const BufferWriteCallback& writeCallback) {
+  std::vector<float> input(_blockSize * getNbInputChannels());
+  std::vector<std::vector<float>> outputBuffers;
+  std::vector<float*> outputs;
+  for (size_t layoutIndex = 0; layoutIndex < getNbOutputLayouts(); ++layoutIndex) {
+    outputBuffers.emplace_back(_blockSize * getNbOutputChannels(layoutIndex));
+    outputs.push_back(outputBuffers.back().data());
+  }
+  while(const size_t nbFrames = readCallback(input.data(), _blockSize)) {
+    process(input.data(), nbFrames, outputs.data());
+    for (size_t layoutIndex = 0; layoutIndex < outputs.size(); ++layoutIndex) {
+      writeCallback(layoutIndex, outputs[layoutIndex], nbFrames);
+    }
+  }
+}
+
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "renderer.hpp"
+
+namespace admengine {
+
+/// Fill the buffer with up to nbFrames interleaved input frames, and return the number of frames read (0 at the end of the input)
+typedef std::function<size_t(float* buffer, const size_t nbFrames)> BufferReadCallback;
+/// Take a block of interleaved output frames of a layout (the buffer is only valid during the call)
+typedef std::function<void(const size_t layoutIndex, const float* buffer, const size_t nbFrames)> BufferWriteCallback;
+
+/**
+ * Renderer of an ADM element from in-memory content, without any file.
+ *
+ * The caller gives the 'axml' and 'chna' chunk data and the audio format, then either pushes
+ * interleaved input blocks rendered into its own output buffers, or lets the renderer pull the
+ * input blocks and hand over the output ones. The ADM metadata of each output is available as
+ * 'axml' and 'chna' chunk data, to be written along with the rendered audio.
+ */
+class BufferRenderer {
+
+public:
+  /// Render the given element, or the first audio programme (or audio object) if no element ID is given,
+  /// loading its render plans from the cache if any (the plans being computed at construction)
+  BufferRenderer(const char* axmlData,
+                 const size_t axmlSize,
+                 const char* chnaData,
+                 const size_t chnaSize,
+                 const uint16_t nbInputChannels,
+                 const uint32_t sampleRate,
+                 const std::vector<std::string>& outputLayouts,
+                 const std::map<std::string, float> elementGains = {},
+                 const std::string& elementIdToRender = "",
+                 const std::shared_ptr<RenderPlanCache>& renderPlanCache = nullptr);
+  BufferRenderer(const BufferRenderer&) = delete;
+  BufferRenderer& operator=(const BufferRenderer&) = delete;
+
+  void setBlockSize(const size_t blockSize);
+
+  std::shared_ptr<adm::Document> getDocument() const { return _renderer.getDocument(); }
+  /// ID of the rendered audio programme or audio object
+  const std::string& getElementId() const { return _elementId; }
+  uint32_t getSampleRate() const { return _renderer.getSampleRate(); }
+  size_t getNbInputChannels() const { return _renderer.getNbInputChannels(); }
+  size_t getNbOutputLayouts() const { return _renderer.getNbOutputLayouts(); }
+  size_t getNbOutputChannels(const size_t layoutIndex = 0) const { return _renderer.getNbOutputChannels(layoutIndex); }
+  /// Output 'axml' and 'chna' chunk data (without the chunk headers)
+  const std::string& getOutputAxmlData(const size_t layoutIndex = 0) const { return _outputAxmlData.at(layoutIndex); }
+  const std::string& getOutputChnaData(const size_t layoutIndex = 0) const { return _outputChnaData.at(layoutIndex); }
+  /// Number of input frames rendered so far
+  uint64_t getFramePosition() const { return _framePosition; }
+
+  /**
+   * Render the next block of interleaved input frames into an output buffer per layout, each one
+   * holding nbFrames interleaved frames of its output channels (without any heap allocation).
+   */
+  void process(const float* input, const size_t nbFrames, float* const* outputs);
+  /// Render the whole input, block by block, from the read callback to the write callback
+  void render(const BufferReadCallback& readCallback, const BufferWriteCallback& writeCallback);
+
+private:
+  void initOutputs(const std::shared_ptr<adm::AudioProgramme>& audioProgramme);
+  void initOutputs(const std::shared_ptr<adm::AudioObject>& audioObject);
+  void addOutputChunks(const std::shared_ptr<adm::Document>& document);
+
+private:
+  Renderer _renderer;
+  std::string _elementId;
+  size_t _blockSize;
+  uint64_t _framePosition;
+  std::vector<std::string> _outputAxmlData;
+  std::vector<std::string> _outputChnaData;
+};
+
+}
@@ -0,0 +1,177 @@
+
+#include "bw64_file_reader.hpp"
+
+#include "bw64_header.hpp"
+#include "pcm.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+namespace admengine {
+
+Bw64FileReader::Bw64FileReader(const std::string& filePath, const bool memoryMapped)
+  : _filePath(filePath)
+  , _channels(0)
+  , _sampleRate(0)
+  , _bitDepth(0)
+  , _isFloat(false)
+  , _dataOffset(0)
+  , _nbFrames(0)
+  , _mapping(nullptr)
+  , _mappingSize(0)
+  , _mappedData(nullptr)
+{
+  _fileDescriptor = ::open(filePath.c_str(), O_RDONLY);
+  if(_fileDescriptor < 0) {
+    throw std::runtime_error("Could not open input file '" + filePath + "': " + std::strerror(errno));
+  }
+  try {
+    readHeader();
+    if(memoryMapped) {
+      mapData();
+    }
+  } catch(...) {
+    ::close(_fileDescriptor);
+    throw;
+  }
+}
+
+Bw64FileReader::~Bw64FileReader() {
+  if(_mapping) {
+    ::munmap(_mapping, _mappingSize);
+  }
+  ::close(_fileDescriptor);
+}
+
+void Bw64FileReader::readHeader() {
+  char riffHeader[RIFF_HEADER_SIZE];
+  readBytes(0, riffHeader, sizeof(riffHeader));
+  if(!isWaveHeader(riffHeader)) {
+    throw std::runtime_error("Input file '" + _filePath + "' is not a BW64 file.");
+  }
+  const bool isRf64 = isRf64Header(riffHeader);
+
+  // walk through the chunks up to the 'data' one, whose size may be set by the 'ds64' chunk
+  uint64_t ds64DataSize = 0;
+  bool hasFormat = false;
+  uint64_t position = sizeof(riffHeader);
+  while(true) {
+    char chunkHeader[CHUNK_HEADER_SIZE];
+    readBytes(position, chunkHeader, sizeof(chunkHeader));
+    const uint64_t chunkSize = getUint32(chunkHeader + 4);
+    const uint64_t chunkDataPosition = position + sizeof(chunkHeader);
+
+    if(isFourCC(chunkHeader, "ds64") || isFourCC(chunkHeader, "fmt ")) {
+      // only the leading fields of these chunks are used
+      char chunkData[FMT_EXTENSIBLE_CHUNK_SIZE];
+      const size_t chunkDataSize = std::min<uint64_t>(chunkSize, sizeof(chunkData));
+      readBytes(chunkDataPosition, chunkData, chunkDataSize);
+      if(isFourCC(chunkHeader, "ds64")) {
+        ds64DataSize = parseDs64DataSize(chunkData, chunkDataSize);
+      } else {
+        const Bw64Format format = parseFormatChunk(chunkData, chunkDataSize);
+        _channels = format.channels;
+        _sampleRate = format.sampleRate;
+        _bitDepth = format.bitDepth;
+        _isFloat = format.isFloat;
+        hasFormat = true;
+      }
+    } else if(isFourCC(chunkHeader, "data")) {
+      if(!hasFormat) {
+        throw std::runtime_error("Input file '" + _filePath + "' has no 'fmt ' chunk before its 'data' chunk.");
+      }
+      // a truncated file only holds the frames up to its end
+      struct stat fileStatus;
+      if(::fstat(_fileDescriptor, &fileStatus) < 0) {
+        throw std::runtime_error("Could not get input file '" + _filePath + "' size: " + std::strerror(errno));
+      }
+      const uint64_t fileDataSize = (uint64_t)fileStatus.st_size > chunkDataPosition ? fileStatus.st_size - chunkDataPosition : 0;
+      const uint64_t dataSize = std::min(getDataSize(isRf64, chunkSize, ds64DataSize), fileDataSize);
+      _dataOffset = chunkDataPosition;
+      _nbFrames = dataSize / (_channels * (_bitDepth / 8));
+      return;
+    }
+    position = chunkDataPosition + chunkSize + chunkSize % 2;
+  }
+}
+
+void Bw64FileReader::mapData() {
+  // mappings start on a page boundary
+  const uint64_t pageSize = ::sysconf(_SC_PAGESIZE);
+  const uint64_t mappingOffset = _dataOffset / pageSize * pageSize;
+  const uint64_t mappingSize = _dataOffset - mappingOffset + _nbFrames * _channels * (_bitDepth / 8);
+  if(mappingSize != (size_t)mappingSize) {
+    throw std::runtime_error("Input file '" + _filePath + "' is too large to be memory-mapped.");
+  }
+  if(_nbFrames == 0) {
+    return;
+  }
+  void* mapping = ::mmap(nullptr, mappingSize, PROT_READ, MAP_PRIVATE, _fileDescriptor, mappingOffset);
+  if(mapping == MAP_FAILED) {
+    throw std::runtime_error("Could not memory-map input file '" + _filePath + "': " + std::strerror(errno));
+  }
+  // only a hint: reading ahead still works without it
+  ::madvise(mapping, mappingSize, MADV_SEQUENTIAL);
+  _mapping = mapping;
+  _mappingSize = mappingSize;
+  _mappedData = static_cast<const char*>(mapping) + (_dataOffset - mappingOffset);
+}
+
+uint64_t Bw64FileReader::read(const uint64_t framePosition, float* buffer, const uint64_t nbFrames, const std::vector<size_t>& trackIds) const {
+  if(framePosition >= _nbFrames) {
+    return 0;
+  }
+  const uint64_t nbReadFrames = std::min(nbFrames, _nbFrames - framePosition);
+  const size_t blockAlignment = _channels * (_bitDepth / 8);
+  for (const size_t trackId : trackIds) {
+    if(trackId >= _channels) {
+      throw std::out_of_range("Input track " + std::to_string(trackId) + " is out of the input file channels.");
+    }
+  }
+
+  const char* data = nullptr;
+  if(_mappedData) {
+    data = _mappedData + framePosition * blockAlignment;
+  } else {
+    // raw frames are read into a per-thread buffer, that only grows
+    thread_local std::vector<char> readBuffer;
+    if(readBuffer.size() < nbReadFrames * blockAlignment) {
+      readBuffer.resize(nbReadFrames * blockAlignment);
+    }
+    readBytes(_dataOffset + framePosition * blockAlignment, readBuffer.data(), nbReadFrames * blockAlignment);
+    data = readBuffer.data();
+  }
+
+  if(_isFloat) {
+    decodeFloatSamples(data, _channels, trackIds.data(), trackIds.size(), buffer, nbReadFrames);
+  } else {
+    decodePcmSamples(data, _channels, trackIds.data(), trackIds.size(), buffer, nbReadFrames, _bitDepth);
+  }
+  return nbReadFrames;
+}
+
+void Bw64FileReader::readBytes(const uint64_t position, char* data, const size_t size) const {
+  size_t read = 0;
+  while(read < size) {
+    const ssize_t result = ::pread(_fileDescriptor, data + read, size - read, position + read);
+    if(result < 0) {
+      if(errno == EINTR) {
+        continue;
+      }
+      throw std::runtime_error(std::string("Could not read input file: ") + std::strerror(errno));
+    }
+    if(result == 0) {
+      throw std::runtime_error("Unexpected end of input file '" + _filePath + "'.");
+    }
+    read += result;
+  }
+}
+
+}
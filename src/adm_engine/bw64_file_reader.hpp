@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace admengine {
+
+/**
+ * BW64 file reader, decoding a subset of the audio tracks from any frame position.
+ *
+ * Only the tracks a rendering uses are converted to float, straight from the PCM data, into
+ * compact interleaved frames. Reads go through positional file reads, hence several threads
+ * can read different frame ranges concurrently. RIFF, RF64 and BW64 files are supported, with
+ * 16, 24 or 32-bit integer PCM samples, or 32-bit float samples.
+ *
+ * If memory-mapped, the 'data' chunk is mapped once (hinted as sequentially accessed), and
+ * samples are decoded straight from the mapped pages, without any intermediate copy.
+ */
+class Bw64FileReader {
+
+public:
+  Bw64FileReader(const std::string& filePath, const bool memoryMapped = false);
+  ~Bw64FileReader();
+
+  Bw64FileReader(const Bw64FileReader&) = delete;
+  Bw64FileReader& operator=(const Bw64FileReader&) = delete;
+
+  uint16_t channels() const { return _channels; }
+  uint32_t sampleRate() const { return _sampleRate; }
+  uint16_t bitDepth() const { return _bitDepth; }
+  uint64_t numberOfFrames() const { return _nbFrames; }
+  bool isMemoryMapped() const { return _mapping != nullptr; }
+
+  /**
+   * Read frames from the given frame position, decoding only the given tracks (thread-safe).
+   * The buffer receives interleaved frames of trackIds.size() channels, in the trackIds order.
+   * Returns the number of frames read, which is lower than requested at the end of the file.
+   */
+  uint64_t read(const uint64_t framePosition, float* buffer, const uint64_t nbFrames, const std::vector<size_t>& trackIds) const;
+
+private:
+  void readHeader();
+  void mapData();
+  void readBytes(const uint64_t position, char* data, const size_t size) const;
+
+private:
+  const std::string _filePath;
+  int _fileDescriptor;
+  uint16_t _channels;
+  uint32_t _sampleRate;
+  uint16_t _bitDepth;
+  bool _isFloat;
+  uint64_t _dataOffset;
+  uint64_t _nbFrames;
+  /// Pages mapping the 'data' chunk (null if not memory-mapped), and the data start in them
+  void* _mapping;
+  size_t _mappingSize;
+  const char* _mappedData;
+};
+
+}
@@ -0,0 +1,247 @@
+
+#include "bw64_file_writer.hpp"
+
+#include "bw64_header.hpp"
+#include "pcm.hpp"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace admengine {
+
+namespace {
+
+const uint32_t DS64_CHUNK_SIZE = 28;
+
+void appendUint16(std::vector<char>& data, const uint16_t value) {
+  for (int b = 0; b < 2; ++b) {
+    data.push_back((char)((value >> (8 * b)) & 0xFF));
+  }
+}
+
+void appendUint32(std::vector<char>& data, const uint32_t value) {
+  for (int b = 0; b < 4; ++b) {
+    data.push_back((char)((value >> (8 * b)) & 0xFF));
+  }
+}
+
+void appendUint64(std::vector<char>& data, const uint64_t value) {
+  for (int b = 0; b < 8; ++b) {
+    data.push_back((char)((value >> (8 * b)) & 0xFF));
+  }
+}
+
+void appendFourCC(std::vector<char>& data, const char* fourCC) {
+  data.insert(data.end(), fourCC, fourCC + 4);
+}
+
+void appendChunk(std::vector<char>& data, const char* fourCC, const std::string& chunkData) {
+  appendFourCC(data, fourCC);
+  appendUint32(data, chunkData.size());
+  data.insert(data.end(), chunkData.begin(), chunkData.end());
+  if(chunkData.size() % 2) {
+    data.push_back(0);
+  }
+}
+
+std::string getChunkData(const std::shared_ptr<bw64::Chunk>& chunk) {
+  std::stringstream chunkData;
+  if(chunk) {
+    chunk->write(chunkData);
+  }
+  return chunkData.str();
+}
+
+}
+
+Bw64FileWriter::Bw64FileWriter(const std::string& filePath,
+                               const uint16_t channels,
+                               const uint32_t sampleRate,
+                               const uint16_t bitDepth,
+                               const std::shared_ptr<bw64::ChnaChunk>& chnaChunk,
+                               const std::shared_ptr<bw64::AxmlChunk>& axmlChunk)
+  : _channels(channels)
+  , _sampleRate(sampleRate)
+  , _bitDepth(bitDepth)
+  , _chnaData(getChunkData(chnaChunk))
+  , _axmlData(getChunkData(axmlChunk))
+  , _streamed(false)
+  , _format(OutputFormat::Bw64)
+  , _nbFrames(0)
+{
+  _fileDescriptor = ::open(filePath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if(_fileDescriptor < 0) {
+    throw std::runtime_error("Could not open output file '" + filePath + "': " + std::strerror(errno));
+  }
+  const std::vector<char> header = getHeader(0);
+  _dataOffset = header.size();
+  writeBytes(0, header.data(), header.size());
+}
+
+Bw64FileWriter::Bw64FileWriter(const int fileDescriptor,
+                               const uint16_t channels,
+                               const uint32_t sampleRate,
+                               const uint16_t bitDepth,
+                               const std::shared_ptr<bw64::ChnaChunk>& chnaChunk,
+                               const std::shared_ptr<bw64::AxmlChunk>& axmlChunk,
+                               const OutputFormat format)
+  : _channels(channels)
+  , _sampleRate(sampleRate)
+  , _bitDepth(bitDepth)
+  , _chnaData(getChunkData(chnaChunk))
+  , _axmlData(getChunkData(axmlChunk))
+  , _dataOffset(0)
+  , _fileDescriptor(fileDescriptor)
+  , _streamed(true)
+  , _format(format)
+  , _nbFrames(0)
+{
+  if(_format == OutputFormat::RawPcm) {
+    return;
+  }
+  // the header goes out first, so that the next stage can start reading before the end of the rendering
+  const std::vector<char> header = getHeader(0, true);
+  _dataOffset = header.size();
+  writeBytes(0, header.data(), header.size());
+}
+
+Bw64FileWriter::~Bw64FileWriter() {
+  try {
+    close();
+  } catch(const std::exception& e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+  }
+}
+
+void Bw64FileWriter::write(const uint64_t framePosition, const float* buffer, const uint64_t nbFrames) {
+  if(_streamed && framePosition != _nbFrames.load()) {
+    throw std::runtime_error("Streamed output frames must be written in order.");
+  }
+  const size_t blockAlignment = _channels * (_bitDepth / 8);
+  // frames are encoded into a per-thread buffer, that only grows (writes may come from several threads)
+  thread_local std::vector<char> encodeBuffer;
+  const size_t dataSize = nbFrames * blockAlignment;
+  if(encodeBuffer.size() < dataSize) {
+    encodeBuffer.resize(dataSize);
+  }
+  encodePcmSamples(buffer, encodeBuffer.data(), nbFrames * _channels, _bitDepth);
+  writeBytes(_dataOffset + framePosition * blockAlignment, encodeBuffer.data(), dataSize);
+
+  // keep track of the furthest written frame
+  uint64_t nbWrittenFrames = _nbFrames.load();
+  while(framePosition + nbFrames > nbWrittenFrames &&
+        !_nbFrames.compare_exchange_weak(nbWrittenFrames, framePosition + nbFrames)) {
+  }
+}
+
+void Bw64FileWriter::close() {
+  if(_fileDescriptor < 0) {
+    return;
+  }
+  const uint64_t dataSize = _nbFrames.load() * _channels * (_bitDepth / 8);
+  if(_streamed) {
+    if(_format == OutputFormat::Bw64) {
+      if(dataSize % 2) {
+        const char padding = 0;
+        writeBytes(_dataOffset + dataSize, &padding, 1);
+      }
+      // a redirection to a regular file can still get the final sizes
+      // (positional writes of an appending file descriptor would go to its end)
+      struct stat fileStatus;
+      if(::fstat(_fileDescriptor, &fileStatus) == 0 && S_ISREG(fileStatus.st_mode) && !(::fcntl(_fileDescriptor, F_GETFL) & O_APPEND)) {
+        const std::vector<char> header = getHeader(dataSize);
+        const off_t headerPosition = ::lseek(_fileDescriptor, 0, SEEK_CUR) - (off_t)(_dataOffset + dataSize + dataSize % 2);
+        if(headerPosition >= 0 && ::pwrite(_fileDescriptor, header.data(), header.size(), headerPosition) != (ssize_t)header.size()) {
+          std::cout << "[WARNING] Could not set the sizes of the streamed output header: " << std::strerror(errno) << std::endl;
+        }
+      }
+    }
+    // the file descriptor belongs to the caller
+    _fileDescriptor = -1;
+    return;
+  }
+  if(dataSize % 2) {
+    const char padding = 0;
+    writeBytes(_dataOffset + dataSize, &padding, 1);
+  }
+  const std::vector<char> header = getHeader(dataSize);
+  writeBytes(0, header.data(), header.size());
+  ::close(_fileDescriptor);
+  _fileDescriptor = -1;
+}
+
+void Bw64FileWriter::writeBytes(const uint64_t position, const char* data, const size_t size) {
+  size_t written = 0;
+  while(written < size) {
+    // streamed frames come in order, hence the position is the one of the stream
+    const ssize_t result = _streamed ? ::write(_fileDescriptor, data + written, size - written)
+                                     : ::pwrite(_fileDescriptor, data + written, size - written, position + written);
+    if(result < 0) {
+      if(errno == EINTR) {
+        continue;
+      }
+      if(errno == EPIPE) {
+        // SIGPIPE being ignored, the reader of a streamed output may stop at any time
+        throw std::runtime_error("Could not write output stream: closed by its reader.");
+      }
+      throw std::runtime_error(std::string("Could not write output file: ") + std::strerror(errno));
+    }
+    written += result;
+  }
+}
+
+std::vector<char> Bw64FileWriter::getHeader(const uint64_t dataSize, const bool unknownSize) const {
+  std::vector<char> header;
+
+  // chunks are laid out as: RIFF/RF64, JUNK/ds64, fmt, chna, axml, data
+  const uint64_t headerSize = 12
+                            + 8 + DS64_CHUNK_SIZE
+                            + 8 + FMT_CHUNK_SIZE
+                            + (_chnaData.empty() ? 0 : 8 + _chnaData.size() + _chnaData.size() % 2)
+                            + (_axmlData.empty() ? 0 : 8 + _axmlData.size() + _axmlData.size() % 2)
+                            + 8;
+  const uint64_t riffSize = headerSize - 8 + dataSize + dataSize % 2;
+  const bool isRf64 = unknownSize || riffSize > MAX_RIFF_SIZE;
+
+  appendFourCC(header, isRf64 ? "RF64" : "RIFF");
+  appendUint32(header, isRf64 ? MAX_RIFF_SIZE : riffSize);
+  appendFourCC(header, "WAVE");
+
+  // the 'JUNK' chunk reserves the room of the 'ds64' one
+  appendFourCC(header, isRf64 ? "ds64" : "JUNK");
+  appendUint32(header, DS64_CHUNK_SIZE);
+  appendUint64(header, isRf64 ? (unknownSize ? UNKNOWN_RF64_SIZE : riffSize) : 0);
+  appendUint64(header, isRf64 ? (unknownSize ? UNKNOWN_RF64_SIZE : dataSize) : 0);
+  appendUint64(header, isRf64 ? (unknownSize ? UNKNOWN_RF64_SIZE : _nbFrames.load()) : 0);
+  appendUint32(header, 0); // table length
+
+  const uint16_t blockAlignment = _channels * (_bitDepth / 8);
+  appendFourCC(header, "fmt ");
+  appendUint32(header, FMT_CHUNK_SIZE);
+  appendUint16(header, WAVE_FORMAT_PCM);
+  appendUint16(header, _channels);
+  appendUint32(header, _sampleRate);
+  appendUint32(header, _sampleRate * blockAlignment);
+  appendUint16(header, blockAlignment);
+  appendUint16(header, _bitDepth);
+
+  if(!_chnaData.empty()) {
+    appendChunk(header, "chna", _chnaData);
+  }
+  if(!_axmlData.empty()) {
+    appendChunk(header, "axml", _axmlData);
+  }
+
+  appendFourCC(header, "data");
+  appendUint32(header, isRf64 ? MAX_RIFF_SIZE : dataSize);
+  return header;
+}
+
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <bw64/bw64.hpp>
+
+namespace admengine {
+
+/// Format of a streamed output
+enum class OutputFormat {
+  /// BW64 file, whose header does not give the data size (RF64 with unknown sizes)
+  Bw64,
+  /// Interleaved little-endian integer PCM frames, without any header
+  RawPcm
+};
+
+/**
+ * BW64 file writer, whose audio frames can be written at any frame position.
+ *
+ * The 'chna' and 'axml' chunks are written before the 'data' chunk, so that the data offset is
+ * known from the start. Writes go through positional file writes, hence several threads can
+ * write different frame ranges concurrently. Sizes are set when closing the file, switching
+ * the header to RF64 (with its 'ds64' chunk) for files larger than 4 GB.
+ *
+ * A writer can also stream its output to a file descriptor (e.g. a pipe), frames being written in
+ * order as they come. The header is then written first, as RF64 with unknown sizes (all bits set),
+ * so that readers take the data up to the end of the stream. If the file descriptor turns out to be
+ * seekable, sizes are set when closing, as for a file.
+ */
+class Bw64FileWriter {
+
+public:
+  Bw64FileWriter(const std::string& filePath,
+                 const uint16_t channels,
+                 const uint32_t sampleRate,
+                 const uint16_t bitDepth,
+                 const std::shared_ptr<bw64::ChnaChunk>& chnaChunk,
+                 const std::shared_ptr<bw64::AxmlChunk>& axmlChunk);
+  /// Stream to a file descriptor, that is not closed
+  Bw64FileWriter(const int fileDescriptor,
+                 const uint16_t channels,
+                 const uint32_t sampleRate,
+                 const uint16_t bitDepth,
+                 const std::shared_ptr<bw64::ChnaChunk>& chnaChunk,
+                 const std::shared_ptr<bw64::AxmlChunk>& axmlChunk,
+                 const OutputFormat format = OutputFormat::Bw64);
+  ~Bw64FileWriter();
+
+  Bw64FileWriter(const Bw64FileWriter&) = delete;
+  Bw64FileWriter& operator=(const Bw64FileWriter&) = delete;
+
+  uint16_t channels() const { return _channels; }
+  uint16_t bitDepth() const { return _bitDepth; }
+
+  /// Write interleaved frames from the given frame position (thread-safe, and in order if streamed)
+  void write(const uint64_t framePosition, const float* buffer, const uint64_t nbFrames);
+  void close();
+
+private:
+  void writeBytes(const uint64_t position, const char* data, const size_t size);
+  /// Header of the given data size, or of unknown sizes if streamed
+  std::vector<char> getHeader(const uint64_t dataSize, const bool unknownSize = false) const;
+
+private:
+  const uint16_t _channels;
+  const uint32_t _sampleRate;
+  const uint16_t _bitDepth;
+  std::string _chnaData;
+  std::string _axmlData;
+  uint64_t _dataOffset;
+  int _fileDescriptor;
+  /// Whether frames are written in order to a file descriptor (not closed), rather than to a file
+  const bool _streamed;
+  const OutputFormat _format;
+  /// Number of frames from the data start to the last written frame
+  std::atomic<uint64_t> _nbFrames;
+};
+
+}
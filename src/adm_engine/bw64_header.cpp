@@ -0,0 +1,94 @@
+#include "bw64_header.hpp"
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace admengine {
+
+namespace {
+
+/// 'ds64' chunks start with the RIFF size, then the 'data' chunk size
+const size_t DS64_CHUNK_MIN_SIZE = 16;
+const size_t DS64_DATA_SIZE_OFFSET = 8;
+const size_t FMT_SUB_FORMAT_OFFSET = 24;
+/// KSDATAFORMAT_SUBTYPE_* GUIDs end like this, after their leading format tag (as stored in files)
+const char SUB_FORMAT_GUID_SUFFIX[14] = { 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, (char)0x80, 0x00, 0x00, (char)0xAA, 0x00, 0x38, (char)0x9B, 0x71 };
+
+/// Format tag of a 'fmt ' chunk, taken from its sub-format GUID if it is extensible
+uint16_t getFormatTag(const char* format, const size_t size) {
+  const uint16_t formatTag = getUint16(format);
+  if(formatTag != WAVE_FORMAT_EXTENSIBLE) {
+    return formatTag;
+  }
+  if(size < FMT_EXTENSIBLE_CHUNK_SIZE) {
+    throw std::runtime_error("Invalid extensible 'fmt ' chunk, without any sub-format.");
+  }
+  const char* subFormat = format + FMT_SUB_FORMAT_OFFSET;
+  if(std::memcmp(subFormat + 2, SUB_FORMAT_GUID_SUFFIX, sizeof(SUB_FORMAT_GUID_SUFFIX)) != 0) {
+    throw std::runtime_error("Unsupported extensible audio sub-format.");
+  }
+  return getUint16(subFormat);
+}
+
+}
+
+uint16_t getUint16(const char* data) {
+  return (uint16_t)((uint8_t)data[0] | ((uint8_t)data[1] << 8));
+}
+
+uint32_t getUint32(const char* data) {
+  return (uint32_t)getUint16(data) | ((uint32_t)getUint16(data + 2) << 16);
+}
+
+uint64_t getUint64(const char* data) {
+  return (uint64_t)getUint32(data) | ((uint64_t)getUint32(data + 4) << 32);
+}
+
+bool isFourCC(const char* data, const char* fourCC) {
+  return std::memcmp(data, fourCC, 4) == 0;
+}
+
+bool isWaveHeader(const char* riffHeader) {
+  return (isFourCC(riffHeader, "RIFF") || isRf64Header(riffHeader)) && isFourCC(riffHeader + 8, "WAVE");
+}
+
+bool isRf64Header(const char* riffHeader) {
+  return isFourCC(riffHeader, "RF64") || isFourCC(riffHeader, "BW64");
+}
+
+Bw64Format parseFormatChunk(const char* format, const size_t size) {
+  if(size < FMT_CHUNK_SIZE) {
+    throw std::runtime_error("Invalid 'fmt ' chunk of " + std::to_string(size) + " bytes.");
+  }
+  // integer PCM and float samples may also be told by an extensible format
+  const uint16_t formatTag = getFormatTag(format, size);
+  if(formatTag != WAVE_FORMAT_PCM && formatTag != WAVE_FORMAT_IEEE_FLOAT) {
+    throw std::runtime_error("Unsupported input audio format: " + std::to_string(formatTag));
+  }
+  Bw64Format bw64Format;
+  bw64Format.channels = getUint16(format + 2);
+  bw64Format.sampleRate = getUint32(format + 4);
+  bw64Format.bitDepth = getUint16(format + 14);
+  bw64Format.isFloat = formatTag == WAVE_FORMAT_IEEE_FLOAT;
+  if(bw64Format.isFloat ? bw64Format.bitDepth != 32 : (bw64Format.bitDepth != 16 && bw64Format.bitDepth != 24 && bw64Format.bitDepth != 32)) {
+    throw std::runtime_error("Unsupported PCM bit depth: " + std::to_string(bw64Format.bitDepth));
+  }
+  if(bw64Format.channels == 0) {
+    throw std::runtime_error("Invalid 'fmt ' chunk, without any channel.");
+  }
+  return bw64Format;
+}
+
+uint64_t parseDs64DataSize(const char* ds64, const size_t size) {
+  if(size < DS64_CHUNK_MIN_SIZE) {
+    throw std::runtime_error("Invalid 'ds64' chunk of " + std::to_string(size) + " bytes.");
+  }
+  return getUint64(ds64 + DS64_DATA_SIZE_OFFSET);
+}
+
+uint64_t getDataSize(const bool isRf64, const uint64_t chunkSize, const uint64_t ds64DataSize) {
+  return (isRf64 && chunkSize == MAX_RIFF_SIZE) ? ds64DataSize : chunkSize;
+}
+
+}
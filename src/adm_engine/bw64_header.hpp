@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace admengine {
+
+const uint32_t MAX_RIFF_SIZE = 0xFFFFFFFF;
+const uint64_t UNKNOWN_RF64_SIZE = 0xFFFFFFFFFFFFFFFF;
+const size_t RIFF_HEADER_SIZE = 12;
+const size_t CHUNK_HEADER_SIZE = 8;
+const uint16_t WAVE_FORMAT_PCM = 1;
+const uint16_t WAVE_FORMAT_IEEE_FLOAT = 3;
+const uint16_t WAVE_FORMAT_EXTENSIBLE = 0xFFFE;
+const size_t FMT_CHUNK_SIZE = 16;
+/// Size of a WAVE_FORMAT_EXTENSIBLE 'fmt ' chunk, ending with the sub-format GUID
+const size_t FMT_EXTENSIBLE_CHUNK_SIZE = 40;
+
+/// Audio format of a 'fmt ' chunk
+struct Bw64Format {
+  uint16_t channels;
+  uint32_t sampleRate;
+  uint16_t bitDepth;
+  bool isFloat;
+};
+
+/// Little-endian integers
+uint16_t getUint16(const char* data);
+uint32_t getUint32(const char* data);
+uint64_t getUint64(const char* data);
+
+bool isFourCC(const char* data, const char* fourCC);
+
+/// Whether a RIFF header is one of a RIFF, RF64 or BW64 WAVE file
+bool isWaveHeader(const char* riffHeader);
+/// Whether a WAVE header sets its sizes in a 'ds64' chunk (RF64 or BW64)
+bool isRf64Header(const char* riffHeader);
+
+/**
+ * Parse the first bytes of a 'fmt ' chunk (up to FMT_EXTENSIBLE_CHUNK_SIZE), throwing if it is
+ * invalid or not 16, 24 or 32-bit integer PCM, or 32-bit float (possibly told by an extensible format).
+ */
+Bw64Format parseFormatChunk(const char* format, const size_t size);
+/// Size of the 'data' chunk set by a 'ds64' chunk, throwing if it is invalid
+uint64_t parseDs64DataSize(const char* ds64, const size_t size);
+/// Size of the 'data' chunk, from its header or from the 'ds64' chunk
+uint64_t getDataSize(const bool isRf64, const uint64_t chunkSize, const uint64_t ds64DataSize);
+
+}
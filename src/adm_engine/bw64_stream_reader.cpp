@@ -0,0 +1,225 @@
+#include "bw64_stream_reader.hpp"
+
+#include "bw64_header.hpp"
+#include "parser.hpp"
+#include "pcm.hpp"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+namespace admengine {
+
+namespace {
+
+const size_t SKIP_BUFFER_SIZE = 64 * 1024;
+
+}
+
+Bw64StreamReader::Bw64StreamReader(const std::string& filePath, const uint64_t maxBufferedDataSize)
+  : _filePath(filePath)
+  , _channels(0)
+  , _sampleRate(0)
+  , _bitDepth(0)
+  , _isFloat(false)
+  , _nbFrames(0)
+  , _dataSizeKnown(false)
+  , _ds64DataSize(0)
+  , _framePosition(0)
+{
+  _fileDescriptor = filePath == "-" ? STDIN_FILENO : ::open(filePath.c_str(), O_RDONLY);
+  if(_fileDescriptor < 0) {
+    throw std::runtime_error("Could not open input file '" + filePath + "': " + std::strerror(errno));
+  }
+  try {
+    readHeader(maxBufferedDataSize);
+  } catch(...) {
+    if(_fileDescriptor != STDIN_FILENO) {
+      ::close(_fileDescriptor);
+    }
+    throw;
+  }
+}
+
+Bw64StreamReader::~Bw64StreamReader() {
+  if(_fileDescriptor != STDIN_FILENO) {
+    ::close(_fileDescriptor);
+  }
+}
+
+bool Bw64StreamReader::isStream(const std::string& filePath) {
+  struct stat fileStatus;
+  return filePath == "-" || (::stat(filePath.c_str(), &fileStatus) == 0 && !S_ISREG(fileStatus.st_mode));
+}
+
+void Bw64StreamReader::readHeader(const uint64_t maxBufferedDataSize) {
+  char riffHeader[RIFF_HEADER_SIZE];
+  if(readBytes(riffHeader, sizeof(riffHeader)) != sizeof(riffHeader)) {
+    throw std::runtime_error("Unexpected end of input stream '" + _filePath + "'.");
+  }
+  if(!isWaveHeader(riffHeader)) {
+    throw std::runtime_error("Input stream '" + _filePath + "' is not a BW64 stream.");
+  }
+  const bool isRf64 = isRf64Header(riffHeader);
+
+  // read the chunks up to the 'data' one, without seeking
+  while(true) {
+    char chunkHeader[CHUNK_HEADER_SIZE];
+    if(readBytes(chunkHeader, sizeof(chunkHeader)) != sizeof(chunkHeader)) {
+      throw std::runtime_error("Input stream '" + _filePath + "' has no 'data' chunk.");
+    }
+    const uint64_t chunkSize = getUint32(chunkHeader + 4);
+    if(!isFourCC(chunkHeader, "data")) {
+      readChunk(chunkHeader, chunkSize);
+      continue;
+    }
+
+    if(_channels == 0) {
+      throw std::runtime_error("Input stream '" + _filePath + "' has no 'fmt ' chunk before its 'data' chunk.");
+    }
+    const size_t blockAlignment = _channels * (_bitDepth / 8);
+    // streaming writers, that cannot seek back to the header, leave the size unset
+    const uint64_t dataSize = getDataSize(isRf64, chunkSize, _ds64DataSize);
+    _dataSizeKnown = dataSize != 0 && dataSize != MAX_RIFF_SIZE && dataSize != UNKNOWN_RF64_SIZE;
+    _nbFrames = _dataSizeKnown ? dataSize / blockAlignment : 0;
+    if(_axmlChunk) {
+      return;
+    }
+
+    // as a last resort, the audio data is kept in memory to reach the chunks after it
+    if(!_dataSizeKnown) {
+      throw std::runtime_error("Input stream '" + _filePath + "' has no 'axml' chunk before its 'data' chunk of unknown size.");
+    }
+    if(dataSize > maxBufferedDataSize) {
+      throw std::runtime_error("Input stream '" + _filePath + "' has no 'axml' chunk before its 'data' chunk, too large to be buffered ("
+                               + std::to_string(dataSize) + " bytes).");
+    }
+    std::cout << "[WARNING] No 'axml' chunk before the 'data' chunk, buffer " << dataSize << " bytes of audio data." << std::endl;
+    _bufferedData.resize(dataSize);
+    const size_t nbReadBytes = readBytes(_bufferedData.data(), dataSize);
+    _bufferedData.resize(nbReadBytes);
+    _nbFrames = nbReadBytes / blockAlignment;
+    if(nbReadBytes == dataSize) {
+      skipBytes(dataSize % 2);
+      readTrailingChunks();
+    }
+    if(!_axmlChunk) {
+      throw std::runtime_error("Input stream '" + _filePath + "' has no 'axml' chunk.");
+    }
+    return;
+  }
+}
+
+void Bw64StreamReader::readTrailingChunks() {
+  char chunkHeader[CHUNK_HEADER_SIZE];
+  while(readBytes(chunkHeader, sizeof(chunkHeader)) == sizeof(chunkHeader)) {
+    readChunk(chunkHeader, getUint32(chunkHeader + 4));
+  }
+}
+
+void Bw64StreamReader::readChunk(const char* chunkHeader, const uint64_t chunkSize) {
+  // only the small metadata chunks are kept
+  std::string chunkData;
+  if(isFourCC(chunkHeader, "ds64")) {
+    readChunkData(chunkData, chunkSize);
+    _ds64DataSize = parseDs64DataSize(chunkData.data(), chunkData.size());
+  } else if(isFourCC(chunkHeader, "fmt ")) {
+    readChunkData(chunkData, chunkSize);
+    const Bw64Format format = parseFormatChunk(chunkData.data(), chunkData.size());
+    _channels = format.channels;
+    _sampleRate = format.sampleRate;
+    _bitDepth = format.bitDepth;
+    _isFloat = format.isFloat;
+  } else if(isFourCC(chunkHeader, "axml")) {
+    readChunkData(chunkData, chunkSize);
+    _axmlChunk = std::make_shared<bw64::AxmlChunk>(chunkData);
+  } else if(isFourCC(chunkHeader, "chna")) {
+    readChunkData(chunkData, chunkSize);
+    _chnaChunk = parseAdmChnaChunk(chunkData.data(), chunkData.size());
+  } else {
+    skipBytes(chunkSize);
+  }
+  skipBytes(chunkSize % 2);
+}
+
+uint64_t Bw64StreamReader::read(float* buffer, const uint64_t nbFrames, const std::vector<size_t>& trackIds) {
+  for (const size_t trackId : trackIds) {
+    if(trackId >= _channels) {
+      throw std::out_of_range("Input track " + std::to_string(trackId) + " is out of the input stream channels.");
+    }
+  }
+  const size_t blockAlignment = _channels * (_bitDepth / 8);
+  uint64_t nbReadFrames = nbFrames;
+  if(_dataSizeKnown || !_bufferedData.empty()) {
+    nbReadFrames = std::min(nbFrames, _nbFrames > _framePosition ? _nbFrames - _framePosition : 0);
+  }
+  if(nbReadFrames == 0) {
+    return 0;
+  }
+
+  const char* data = nullptr;
+  if(!_bufferedData.empty()) {
+    data = _bufferedData.data() + _framePosition * blockAlignment;
+  } else {
+    if(_readBuffer.size() < nbReadFrames * blockAlignment) {
+      _readBuffer.resize(nbReadFrames * blockAlignment);
+    }
+    // a truncated stream ends on its last whole frame
+    nbReadFrames = readBytes(_readBuffer.data(), nbReadFrames * blockAlignment) / blockAlignment;
+    data = _readBuffer.data();
+  }
+
+  if(_isFloat) {
+    decodeFloatSamples(data, _channels, trackIds.data(), trackIds.size(), buffer, nbReadFrames);
+  } else {
+    decodePcmSamples(data, _channels, trackIds.data(), trackIds.size(), buffer, nbReadFrames, _bitDepth);
+  }
+  _framePosition += nbReadFrames;
+  return nbReadFrames;
+}
+
+size_t Bw64StreamReader::readBytes(char* data, const size_t size) {
+  // pipes return what is available, hence reads go on up to the requested size, or to the end of the stream
+  size_t read = 0;
+  while(read < size) {
+    const ssize_t result = ::read(_fileDescriptor, data + read, size - read);
+    if(result < 0) {
+      if(errno == EINTR) {
+        continue;
+      }
+      throw std::runtime_error(std::string("Could not read input stream: ") + std::strerror(errno));
+    }
+    if(result == 0) {
+      break;
+    }
+    read += result;
+  }
+  return read;
+}
+
+void Bw64StreamReader::readChunkData(std::string& data, const uint64_t size) {
+  data.resize(size);
+  if(readBytes(&data[0], size) != size) {
+    throw std::runtime_error("Unexpected end of input stream '" + _filePath + "'.");
+  }
+}
+
+void Bw64StreamReader::skipBytes(uint64_t size) {
+  char skipBuffer[SKIP_BUFFER_SIZE];
+  while(size) {
+    const size_t nbBytes = std::min<uint64_t>(size, sizeof(skipBuffer));
+    if(readBytes(skipBuffer, nbBytes) != nbBytes) {
+      // the last chunks of a stream may be truncated
+      return;
+    }
+    size -= nbBytes;
+  }
+}
+
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <bw64/bw64.hpp>
+
+namespace admengine {
+
+const uint64_t DEFAULT_MAX_BUFFERED_DATA_SIZE = 1024 * 1024 * 1024; // in bytes
+
+/**
+ * BW64 stream reader, reading its input once, forward only (e.g. from a pipe or the standard input).
+ *
+ * The header chunks are read up to the 'data' chunk, whose audio frames are then decoded as they
+ * are read, one block at a time. If the 'axml' chunk comes after the 'data' chunk, as a last resort,
+ * the audio data is buffered (up to a maximum size) to read the chunks that follow it. RIFF, RF64
+ * and BW64 streams are supported, with 16, 24 or 32-bit integer PCM samples, or 32-bit float samples.
+ * A 'data' chunk of unknown size (as written by streaming encoders) is read up to the end of the stream.
+ */
+class Bw64StreamReader {
+
+public:
+  /// Read from a file path, or from the standard input if the path is "-"
+  Bw64StreamReader(const std::string& filePath, const uint64_t maxBufferedDataSize = DEFAULT_MAX_BUFFERED_DATA_SIZE);
+  ~Bw64StreamReader();
+
+  Bw64StreamReader(const Bw64StreamReader&) = delete;
+  Bw64StreamReader& operator=(const Bw64StreamReader&) = delete;
+
+  /// Whether the path is the standard input, or anything else than a regular file (e.g. a named pipe), that cannot be seeked
+  static bool isStream(const std::string& filePath);
+
+  uint16_t channels() const { return _channels; }
+  uint32_t sampleRate() const { return _sampleRate; }
+  uint16_t bitDepth() const { return _bitDepth; }
+  /// Number of frames of the 'data' chunk (0 if unknown)
+  uint64_t numberOfFrames() const { return _nbFrames; }
+  std::shared_ptr<bw64::AxmlChunk> axmlChunk() const { return _axmlChunk; }
+  std::shared_ptr<bw64::ChnaChunk> chnaChunk() const { return _chnaChunk; }
+
+  /**
+   * Read the next frames, decoding only the given tracks.
+   * The buffer receives interleaved frames of trackIds.size() channels, in the trackIds order.
+   * Returns the number of frames read, which is lower than requested at the end of the stream.
+   */
+  uint64_t read(float* buffer, const uint64_t nbFrames, const std::vector<size_t>& trackIds);
+
+private:
+  void readHeader(const uint64_t maxBufferedDataSize);
+  void readTrailingChunks();
+  void readChunk(const char* chunkHeader, const uint64_t chunkSize);
+  size_t readBytes(char* data, const size_t size);
+  void readChunkData(std::string& data, const uint64_t size);
+  void skipBytes(uint64_t size);
+
+private:
+  const std::string _filePath;
+  int _fileDescriptor;
+  uint16_t _channels;
+  uint32_t _sampleRate;
+  uint16_t _bitDepth;
+  bool _isFloat;
+  uint64_t _nbFrames;
+  /// Whether the 'data' chunk size is known, or read up to the end of the stream
+  bool _dataSizeKnown;
+  uint64_t _ds64DataSize;
+  uint64_t _framePosition;
+  std::shared_ptr<bw64::AxmlChunk> _axmlChunk;
+  std::shared_ptr<bw64::ChnaChunk> _chnaChunk;
+  /// Whole audio data, if the 'axml' chunk comes after it
+  std::vector<char> _bufferedData;
+  /// Raw frames of a block, that only grows
+  std::vector<char> _readBuffer;
+};
+
+}
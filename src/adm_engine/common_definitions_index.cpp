@@ -0,0 +1,50 @@
+#include "common_definitions_index.hpp"
+
+#include <adm/common_definitions.hpp>
+
+#include <stdexcept>
+
+namespace admengine {
+
+const CommonDefinitionsIndex& CommonDefinitionsIndex::getInstance() {
+  // initialised once, even from concurrent threads
+  static const CommonDefinitionsIndex commonDefinitionsIndex;
+  return commonDefinitionsIndex;
+}
+
+CommonDefinitionsIndex::CommonDefinitionsIndex() {
+  for(const auto& entry : adm::audioPackFormatLookupTable()) {
+    _audioPackFormatIds.emplace(entry.first, entry.second);
+  }
+  for(const auto& entry : adm::audioTrackFormatLookupTable()) {
+    _audioTrackFormatIds.emplace(entry.first, entry.second);
+    // labels are sorted, so that a track format shared by several labels keeps the first one
+    _speakerLabels.emplace(adm::formatId(entry.second), entry.first);
+  }
+}
+
+const adm::AudioPackFormatId& CommonDefinitionsIndex::getAudioPackFormatId(const std::string& layoutName) const {
+  const auto audioPackFormatId = _audioPackFormatIds.find(layoutName);
+  if(audioPackFormatId == _audioPackFormatIds.end()) {
+    throw std::out_of_range("No common definitions AudioPackFormat for layout: " + layoutName);
+  }
+  return audioPackFormatId->second;
+}
+
+const adm::AudioTrackFormatId& CommonDefinitionsIndex::getAudioTrackFormatId(const std::string& speakerLabel) const {
+  const auto audioTrackFormatId = _audioTrackFormatIds.find(speakerLabel);
+  if(audioTrackFormatId == _audioTrackFormatIds.end()) {
+    throw std::out_of_range("No common definitions AudioTrackFormat for speaker label: " + speakerLabel);
+  }
+  return audioTrackFormatId->second;
+}
+
+std::string CommonDefinitionsIndex::getSpeakerLabel(const adm::AudioTrackFormatId& audioTrackFormatId) const {
+  const auto speakerLabel = _speakerLabels.find(adm::formatId(audioTrackFormatId));
+  if(speakerLabel == _speakerLabels.end()) {
+    return "";
+  }
+  return speakerLabel->second;
+}
+
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <adm/adm.hpp>
+
+#include <string>
+#include <unordered_map>
+
+namespace admengine {
+
+/**
+ * Lookup tables of the ADM common definitions (ITU-R BS.2094), in both directions.
+ *
+ * The libadm tables are built on each call, hence they are built once here, on first use, and never
+ * modified afterwards: the index can be shared by all threads without locking.
+ */
+class CommonDefinitionsIndex {
+
+public:
+  static const CommonDefinitionsIndex& getInstance();
+
+  CommonDefinitionsIndex(const CommonDefinitionsIndex&) = delete;
+  CommonDefinitionsIndex& operator=(const CommonDefinitionsIndex&) = delete;
+
+  /// AudioPackFormat ID of a layout (e.g. "0+5+0"), throwing std::out_of_range if it is not defined
+  const adm::AudioPackFormatId& getAudioPackFormatId(const std::string& layoutName) const;
+  /// AudioTrackFormat ID of a speaker label (e.g. "M+030"), throwing std::out_of_range if it is not defined
+  const adm::AudioTrackFormatId& getAudioTrackFormatId(const std::string& speakerLabel) const;
+  /// Speaker label of a common definitions AudioTrackFormat (empty if it is not defined)
+  std::string getSpeakerLabel(const adm::AudioTrackFormatId& audioTrackFormatId) const;
+
+private:
+  CommonDefinitionsIndex();
+
+private:
+  std::unordered_map<std::string, adm::AudioPackFormatId> _audioPackFormatIds;
+  std::unordered_map<std::string, adm::AudioTrackFormatId> _audioTrackFormatIds;
+  /// Speaker labels by formatted AudioTrackFormat ID
+  std::unordered_map<std::string, std::string> _speakerLabels;
+};
+
+}
@@ -0,0 +1,133 @@
+
+#include "mixing_kernels.hpp"
+
+namespace admengine {
+
+// widest vector is 16 floats (AVX-512), so that every kernel can load full gain vectors
+const size_t MIXING_GAIN_ALIGNMENT = 16;
+
+namespace {
+
+SimdLevel detectSimdLevel() {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("avx512f") && getAvx512MixingKernel(1)) {
+    return SimdLevel::AVX512;
+  }
+  if(__builtin_cpu_supports("avx2") && getAvx2MixingKernel(1)) {
+    return SimdLevel::AVX2;
+  }
+  if(__builtin_cpu_supports("sse2") && getSse2MixingKernel(1)) {
+    return SimdLevel::SSE2;
+  }
+#endif
+  return SimdLevel::SCALAR;
+}
+
+}
+
+SimdLevel getSimdLevel() {
+  static const SimdLevel simdLevel = detectSimdLevel();
+  return simdLevel;
+}
+
+std::string formatSimdLevel(const SimdLevel simdLevel) {
+  switch(simdLevel) {
+    case SimdLevel::SSE2: return "SSE2";
+    case SimdLevel::AVX2: return "AVX2";
+    case SimdLevel::AVX512: return "AVX-512";
+    case SimdLevel::SCALAR:
+    default:
+      return "scalar";
+  }
+}
+
+size_t getMixingGainStride(const size_t nbOutputChannels) {
+  return (nbOutputChannels + MIXING_GAIN_ALIGNMENT - 1) / MIXING_GAIN_ALIGNMENT * MIXING_GAIN_ALIGNMENT;
+}
+
+MixingKernel getMixingKernel(const size_t nbOutputChannels) {
+  return getMixingKernel(nbOutputChannels, getSimdLevel());
+}
+
+MixingKernel getMixingKernel(const size_t nbOutputChannels, const SimdLevel simdLevel) {
+  MixingKernel kernel = nullptr;
+  switch(simdLevel) {
+    case SimdLevel::AVX512: kernel = getAvx512MixingKernel(nbOutputChannels); break;
+    case SimdLevel::AVX2: kernel = getAvx2MixingKernel(nbOutputChannels); break;
+    case SimdLevel::SSE2: kernel = getSse2MixingKernel(nbOutputChannels); break;
+    case SimdLevel::SCALAR:
+    default:
+      break;
+  }
+  return kernel ? kernel : &mixScalar;
+}
+
+RampMixingKernel getRampMixingKernel() {
+  return getRampMixingKernel(getSimdLevel());
+}
+
+RampMixingKernel getRampMixingKernel(const SimdLevel simdLevel) {
+  RampMixingKernel kernel = nullptr;
+  switch(simdLevel) {
+    case SimdLevel::AVX512: kernel = getAvx512RampMixingKernel(); break;
+    case SimdLevel::AVX2: kernel = getAvx2RampMixingKernel(); break;
+    case SimdLevel::SSE2: kernel = getSse2RampMixingKernel(); break;
+    case SimdLevel::SCALAR:
+    default:
+      break;
+  }
+  return kernel ? kernel : &mixRampScalar;
+}
+
+void mixScalar(const size_t nbFrames,
+               const float* input,
+               const size_t inputNbChannels,
+               const size_t* inputTrackIds,
+               const size_t nbInputTracks,
+               const float* gains,
+               const size_t gainStride,
+               float* output,
+               const size_t nbOutputChannels,
+               const bool accumulate) {
+  for (size_t frame = 0; frame < nbFrames; ++frame) {
+    const float* inputFrame = input + frame * inputNbChannels;
+    float* outputFrame = output + frame * nbOutputChannels;
+    for (size_t oc = 0; oc < nbOutputChannels; ++oc) {
+      // same operation order as the vectorised kernels: accumulate track by track into the output
+      float sample = accumulate ? outputFrame[oc] : 0.0f;
+      for (size_t i = 0; i < nbInputTracks; ++i) {
+        sample = sample + inputFrame[inputTrackIds[i]] * gains[i * gainStride + oc];
+      }
+      outputFrame[oc] = sample;
+    }
+  }
+}
+
+void mixRampScalar(const size_t nbFrames,
+                   const float* input,
+                   const size_t inputNbChannels,
+                   const size_t* inputTrackIds,
+                   const size_t nbInputTracks,
+                   const float* const* gains,
+                   const float* const* gainSteps,
+                   const size_t* rampPositions,
+                   float* output,
+                   const size_t nbOutputChannels,
+                   const bool accumulate) {
+  for (size_t frame = 0; frame < nbFrames; ++frame) {
+    const float* inputFrame = input + frame * inputNbChannels;
+    float* outputFrame = output + frame * nbOutputChannels;
+    for (size_t oc = 0; oc < nbOutputChannels; ++oc) {
+      float sample = accumulate ? outputFrame[oc] : 0.0f;
+      for (size_t i = 0; i < nbInputTracks; ++i) {
+        // gains are computed from the ramp start at each frame, so that no rounding error builds up
+        const float position = (float)(rampPositions[i] + frame);
+        sample = sample + inputFrame[inputTrackIds[i]] * (gains[i][oc] + position * gainSteps[i][oc]);
+      }
+      outputFrame[oc] = sample;
+    }
+  }
+}
+
+}
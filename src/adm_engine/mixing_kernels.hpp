@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace admengine {
+
+/**
+ * Mixing kernel: accumulates the selected tracks of a block of interleaved input frames
+ * into a block of interleaved output frames.
+ *
+ * Gains are stored input-major: the gains of the i-th selected input track start at
+ * `gains + i * gainStride`, with one gain per output channel. The stride must be at
+ * least `getMixingGainStride(nbOutputChannels)` and padding gains must be zero.
+ *
+ * Unless `accumulate` is set, output samples are overwritten instead of being accumulated into,
+ * which saves clearing the output block beforehand.
+ */
+typedef void (*MixingKernel)(const size_t nbFrames,
+                             const float* input,
+                             const size_t inputNbChannels,
+                             const size_t* inputTrackIds,
+                             const size_t nbInputTracks,
+                             const float* gains,
+                             const size_t gainStride,
+                             float* output,
+                             const size_t nbOutputChannels,
+                             const bool accumulate);
+
+/**
+ * Ramp mixing kernel: accumulates the selected tracks of a block of interleaved input frames
+ * into a block of interleaved output frames, with gains ramping linearly over the block.
+ *
+ * The gain of the i-th selected track for output channel `oc` at the n-th frame of the block is
+ * `gains[i][oc] + (rampPositions[i] + n) * gainSteps[i][oc]`, where rampPositions[i] is the number
+ * of frames already elapsed since the start of the track ramp. As for MixingKernel, gains and
+ * steps must be padded with zeros up to `getMixingGainStride(nbOutputChannels)`.
+ */
+typedef void (*RampMixingKernel)(const size_t nbFrames,
+                                 const float* input,
+                                 const size_t inputNbChannels,
+                                 const size_t* inputTrackIds,
+                                 const size_t nbInputTracks,
+                                 const float* const* gains,
+                                 const float* const* gainSteps,
+                                 const size_t* rampPositions,
+                                 float* output,
+                                 const size_t nbOutputChannels,
+                                 const bool accumulate);
+
+enum class SimdLevel {
+  SCALAR = 0,
+  SSE2,
+  AVX2,
+  AVX512
+};
+
+/// Best instruction set supported by the running CPU (detected once)
+SimdLevel getSimdLevel();
+std::string formatSimdLevel(const SimdLevel simdLevel);
+
+size_t getMixingGainStride(const size_t nbOutputChannels);
+
+/// Select the kernel for the number of output channels, at the given or detected SIMD level
+MixingKernel getMixingKernel(const size_t nbOutputChannels);
+MixingKernel getMixingKernel(const size_t nbOutputChannels, const SimdLevel simdLevel);
+
+/// Reference implementation, that all vectorised kernels match bit for bit
+void mixScalar(const size_t nbFrames,
+               const float* input,
+               const size_t inputNbChannels,
+               const size_t* inputTrackIds,
+               const size_t nbInputTracks,
+               const float* gains,
+               const size_t gainStride,
+               float* output,
+               const size_t nbOutputChannels,
+               const bool accumulate);
+
+/// Select the ramp kernel at the given or detected SIMD level
+RampMixingKernel getRampMixingKernel();
+RampMixingKernel getRampMixingKernel(const SimdLevel simdLevel);
+
+/// Reference ramp implementation, that all vectorised ramp kernels match bit for bit
+void mixRampScalar(const size_t nbFrames,
+                   const float* input,
+                   const size_t inputNbChannels,
+                   const size_t* inputTrackIds,
+                   const size_t nbInputTracks,
+                   const float* const* gains,
+                   const float* const* gainSteps,
+                   const size_t* rampPositions,
+                   float* output,
+                   const size_t nbOutputChannels,
+                   const bool accumulate);
+
+MixingKernel getSse2MixingKernel(const size_t nbOutputChannels);
+MixingKernel getAvx2MixingKernel(const size_t nbOutputChannels);
+MixingKernel getAvx512MixingKernel(const size_t nbOutputChannels);
+
+RampMixingKernel getSse2RampMixingKernel();
+RampMixingKernel getAvx2RampMixingKernel();
+RampMixingKernel getAvx512RampMixingKernel();
+
+}
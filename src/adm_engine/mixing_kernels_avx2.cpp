@@ -0,0 +1,57 @@
+
+#include "mixing_kernels.hpp"
+
+#if defined(__AVX2__)
+
+#include <immintrin.h>
+
+#include "mixing_kernels_impl.hpp"
+
+namespace admengine {
+namespace {
+
+struct Avx2 {
+  typedef __m256 Vector;
+  typedef __m256i Mask;
+  static const size_t WIDTH = 8;
+
+  static Mask mask(const size_t nbLanes) {
+    return _mm256_cmpgt_epi32(_mm256_set1_epi32((int)nbLanes), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+  }
+  static Vector load(const float* data) { return _mm256_loadu_ps(data); }
+  static Vector maskLoad(const float* data, const Mask mask) { return _mm256_maskload_ps(data, mask); }
+  static void store(float* data, const Vector vector) { _mm256_storeu_ps(data, vector); }
+  static void maskStore(float* data, const Mask mask, const Vector vector) { _mm256_maskstore_ps(data, mask, vector); }
+  static Vector zero() { return _mm256_setzero_ps(); }
+  static Vector broadcast(const float value) { return _mm256_set1_ps(value); }
+  static Vector add(const Vector a, const Vector b) { return _mm256_add_ps(a, b); }
+  static Vector mul(const Vector a, const Vector b) { return _mm256_mul_ps(a, b); }
+};
+
+}
+
+MixingKernel getAvx2MixingKernel(const size_t nbOutputChannels) {
+  return selectMixingKernel<Avx2>(nbOutputChannels);
+}
+
+RampMixingKernel getAvx2RampMixingKernel() {
+  return &mixRamp<Avx2>;
+}
+
+}
+
+#else
+
+namespace admengine {
+
+MixingKernel getAvx2MixingKernel(const size_t) {
+  return nullptr;
+}
+
+RampMixingKernel getAvx2RampMixingKernel() {
+  return nullptr;
+}
+
+}
+
+#endif
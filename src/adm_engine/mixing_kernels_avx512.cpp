@@ -0,0 +1,55 @@
+
+#include "mixing_kernels.hpp"
+
+#if defined(__AVX512F__)
+
+#include <immintrin.h>
+
+#include "mixing_kernels_impl.hpp"
+
+namespace admengine {
+namespace {
+
+struct Avx512 {
+  typedef __m512 Vector;
+  typedef __mmask16 Mask;
+  static const size_t WIDTH = 16;
+
+  static Mask mask(const size_t nbLanes) { return (Mask)((1u << nbLanes) - 1); }
+  static Vector load(const float* data) { return _mm512_loadu_ps(data); }
+  static Vector maskLoad(const float* data, const Mask mask) { return _mm512_maskz_loadu_ps(mask, data); }
+  static void store(float* data, const Vector vector) { _mm512_storeu_ps(data, vector); }
+  static void maskStore(float* data, const Mask mask, const Vector vector) { _mm512_mask_storeu_ps(data, mask, vector); }
+  static Vector zero() { return _mm512_setzero_ps(); }
+  static Vector broadcast(const float value) { return _mm512_set1_ps(value); }
+  static Vector add(const Vector a, const Vector b) { return _mm512_add_ps(a, b); }
+  static Vector mul(const Vector a, const Vector b) { return _mm512_mul_ps(a, b); }
+};
+
+}
+
+MixingKernel getAvx512MixingKernel(const size_t nbOutputChannels) {
+  return selectMixingKernel<Avx512>(nbOutputChannels);
+}
+
+RampMixingKernel getAvx512RampMixingKernel() {
+  return &mixRamp<Avx512>;
+}
+
+}
+
+#else
+
+namespace admengine {
+
+MixingKernel getAvx512MixingKernel(const size_t) {
+  return nullptr;
+}
+
+RampMixingKernel getAvx512RampMixingKernel() {
+  return nullptr;
+}
+
+}
+
+#endif
@@ -0,0 +1,168 @@
+#pragma once
+
+#include "mixing_kernels.hpp"
+
+/**
+ * Vectorised mixing kernels, written once against a SIMD traits class (see mixing_kernels_*.cpp).
+ *
+ * Each translation unit including this file is compiled for a single instruction set, hence
+ * everything here has internal linkage so that no instruction set leaks into another.
+ *
+ * Output channels are processed by vectors of Simd::WIDTH floats, and every kernel accumulates
+ * input tracks into the output in the same order as mixScalar, so that results are bit-identical.
+ */
+namespace admengine {
+namespace {
+
+/// Kernel for a number of output channels known at compile time: all the output vectors of
+/// a frame stay in registers while input tracks are accumulated.
+template <class Simd, size_t NB_OUTPUT_CHANNELS>
+void mixFixedWidth(const size_t nbFrames,
+                   const float* input,
+                   const size_t inputNbChannels,
+                   const size_t* inputTrackIds,
+                   const size_t nbInputTracks,
+                   const float* gains,
+                   const size_t gainStride,
+                   float* output,
+                   const size_t,
+                   const bool accumulate) {
+  typedef typename Simd::Vector Vector;
+  const size_t NB_FULL_VECTORS = NB_OUTPUT_CHANNELS / Simd::WIDTH;
+  const size_t TAIL = NB_OUTPUT_CHANNELS % Simd::WIDTH;
+  const size_t NB_VECTORS = NB_FULL_VECTORS + (TAIL ? 1 : 0);
+  const typename Simd::Mask tailMask = Simd::mask(TAIL);
+
+  for (size_t frame = 0; frame < nbFrames; ++frame) {
+    const float* inputFrame = input + frame * inputNbChannels;
+    float* outputFrame = output + frame * NB_OUTPUT_CHANNELS;
+
+    Vector samples[NB_VECTORS];
+    for (size_t v = 0; v < NB_FULL_VECTORS; ++v) {
+      samples[v] = accumulate ? Simd::load(outputFrame + v * Simd::WIDTH) : Simd::zero();
+    }
+    if(TAIL) {
+      samples[NB_FULL_VECTORS] = accumulate ? Simd::maskLoad(outputFrame + NB_FULL_VECTORS * Simd::WIDTH, tailMask) : Simd::zero();
+    }
+
+    const float* trackGains = gains;
+    for (size_t i = 0; i < nbInputTracks; ++i) {
+      const Vector inputSample = Simd::broadcast(inputFrame[inputTrackIds[i]]);
+      for (size_t v = 0; v < NB_VECTORS; ++v) {
+        samples[v] = Simd::add(samples[v], Simd::mul(inputSample, Simd::load(trackGains + v * Simd::WIDTH)));
+      }
+      trackGains += gainStride;
+    }
+
+    for (size_t v = 0; v < NB_FULL_VECTORS; ++v) {
+      Simd::store(outputFrame + v * Simd::WIDTH, samples[v]);
+    }
+    if(TAIL) {
+      Simd::maskStore(outputFrame + NB_FULL_VECTORS * Simd::WIDTH, tailMask, samples[NB_FULL_VECTORS]);
+    }
+  }
+}
+
+/// Kernel for any number of output channels, processing one output vector at a time.
+template <class Simd>
+void mixAnyWidth(const size_t nbFrames,
+                 const float* input,
+                 const size_t inputNbChannels,
+                 const size_t* inputTrackIds,
+                 const size_t nbInputTracks,
+                 const float* gains,
+                 const size_t gainStride,
+                 float* output,
+                 const size_t nbOutputChannels,
+                 const bool accumulate) {
+  typedef typename Simd::Vector Vector;
+  const size_t nbFullVectors = nbOutputChannels / Simd::WIDTH;
+  const size_t tail = nbOutputChannels % Simd::WIDTH;
+  const typename Simd::Mask tailMask = Simd::mask(tail);
+
+  for (size_t frame = 0; frame < nbFrames; ++frame) {
+    const float* inputFrame = input + frame * inputNbChannels;
+    float* outputFrame = output + frame * nbOutputChannels;
+
+    for (size_t v = 0; v < nbFullVectors; ++v) {
+      Vector samples = accumulate ? Simd::load(outputFrame + v * Simd::WIDTH) : Simd::zero();
+      const float* trackGains = gains + v * Simd::WIDTH;
+      for (size_t i = 0; i < nbInputTracks; ++i) {
+        samples = Simd::add(samples, Simd::mul(Simd::broadcast(inputFrame[inputTrackIds[i]]), Simd::load(trackGains)));
+        trackGains += gainStride;
+      }
+      Simd::store(outputFrame + v * Simd::WIDTH, samples);
+    }
+
+    if(tail) {
+      Vector samples = accumulate ? Simd::maskLoad(outputFrame + nbFullVectors * Simd::WIDTH, tailMask) : Simd::zero();
+      const float* trackGains = gains + nbFullVectors * Simd::WIDTH;
+      for (size_t i = 0; i < nbInputTracks; ++i) {
+        samples = Simd::add(samples, Simd::mul(Simd::broadcast(inputFrame[inputTrackIds[i]]), Simd::load(trackGains)));
+        trackGains += gainStride;
+      }
+      Simd::maskStore(outputFrame + nbFullVectors * Simd::WIDTH, tailMask, samples);
+    }
+  }
+}
+
+/// Ramp kernel for any number of output channels, processing one output vector at a time and
+/// computing the gains of each frame from the ramp starts.
+template <class Simd>
+void mixRamp(const size_t nbFrames,
+             const float* input,
+             const size_t inputNbChannels,
+             const size_t* inputTrackIds,
+             const size_t nbInputTracks,
+             const float* const* gains,
+             const float* const* gainSteps,
+             const size_t* rampPositions,
+             float* output,
+             const size_t nbOutputChannels,
+             const bool accumulate) {
+  typedef typename Simd::Vector Vector;
+  const size_t nbVectors = (nbOutputChannels + Simd::WIDTH - 1) / Simd::WIDTH;
+  const size_t tail = nbOutputChannels % Simd::WIDTH;
+  const typename Simd::Mask tailMask = Simd::mask(tail);
+
+  for (size_t frame = 0; frame < nbFrames; ++frame) {
+    const float* inputFrame = input + frame * inputNbChannels;
+    float* outputFrame = output + frame * nbOutputChannels;
+
+    for (size_t v = 0; v < nbVectors; ++v) {
+      const bool isTail = tail && v + 1 == nbVectors;
+      float* outputVector = outputFrame + v * Simd::WIDTH;
+      Vector samples = Simd::zero();
+      if(accumulate) {
+        samples = isTail ? Simd::maskLoad(outputVector, tailMask) : Simd::load(outputVector);
+      }
+      for (size_t i = 0; i < nbInputTracks; ++i) {
+        const Vector position = Simd::broadcast((float)(rampPositions[i] + frame));
+        const Vector frameGains = Simd::add(Simd::load(gains[i] + v * Simd::WIDTH), Simd::mul(position, Simd::load(gainSteps[i] + v * Simd::WIDTH)));
+        samples = Simd::add(samples, Simd::mul(Simd::broadcast(inputFrame[inputTrackIds[i]]), frameGains));
+      }
+      if(isTail) {
+        Simd::maskStore(outputVector, tailMask, samples);
+      } else {
+        Simd::store(outputVector, samples);
+      }
+    }
+  }
+}
+
+/// Specialised kernels for the common output layout widths, generic kernel otherwise
+template <class Simd>
+MixingKernel selectMixingKernel(const size_t nbOutputChannels) {
+  switch(nbOutputChannels) {
+    case 2: return &mixFixedWidth<Simd, 2>;   // 0+2+0
+    case 6: return &mixFixedWidth<Simd, 6>;   // 0+5+0
+    case 8: return &mixFixedWidth<Simd, 8>;   // 2+5+0, 0+7+0
+    case 10: return &mixFixedWidth<Simd, 10>; // 4+5+0
+    case 12: return &mixFixedWidth<Simd, 12>; // 4+7+0
+    case 24: return &mixFixedWidth<Simd, 24>; // 9+10+3
+    default: return &mixAnyWidth<Simd>;
+  }
+}
+
+}
+}
@@ -0,0 +1,68 @@
+
+#include "mixing_kernels.hpp"
+
+#if defined(__SSE2__)
+
+#include <emmintrin.h>
+
+#include "mixing_kernels_impl.hpp"
+
+namespace admengine {
+namespace {
+
+struct Sse2 {
+  typedef __m128 Vector;
+  /// SSE2 has no masked memory access: the mask is the number of valid lanes
+  typedef size_t Mask;
+  static const size_t WIDTH = 4;
+
+  static Mask mask(const size_t nbLanes) { return nbLanes; }
+  static Vector load(const float* data) { return _mm_loadu_ps(data); }
+  static Vector maskLoad(const float* data, const Mask nbLanes) {
+    float lanes[WIDTH] = { 0.0, 0.0, 0.0, 0.0 };
+    for (size_t i = 0; i < nbLanes; ++i) {
+      lanes[i] = data[i];
+    }
+    return _mm_loadu_ps(lanes);
+  }
+  static void store(float* data, const Vector vector) { _mm_storeu_ps(data, vector); }
+  static void maskStore(float* data, const Mask nbLanes, const Vector vector) {
+    float lanes[WIDTH];
+    _mm_storeu_ps(lanes, vector);
+    for (size_t i = 0; i < nbLanes; ++i) {
+      data[i] = lanes[i];
+    }
+  }
+  static Vector zero() { return _mm_setzero_ps(); }
+  static Vector broadcast(const float value) { return _mm_set1_ps(value); }
+  static Vector add(const Vector a, const Vector b) { return _mm_add_ps(a, b); }
+  static Vector mul(const Vector a, const Vector b) { return _mm_mul_ps(a, b); }
+};
+
+}
+
+MixingKernel getSse2MixingKernel(const size_t nbOutputChannels) {
+  return selectMixingKernel<Sse2>(nbOutputChannels);
+}
+
+RampMixingKernel getSse2RampMixingKernel() {
+  return &mixRamp<Sse2>;
+}
+
+}
+
+#else
+
+namespace admengine {
+
+MixingKernel getSse2MixingKernel(const size_t) {
+  return nullptr;
+}
+
+RampMixingKernel getSse2RampMixingKernel() {
+  return nullptr;
+}
+
+}
+
+#endif
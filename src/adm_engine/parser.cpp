@@ -1,20 +1,331 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <deque>
 #include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <streambuf>
 
 #include "adm/common_definitions.hpp"
 
 #include "parser.hpp"
+#include "timeline_index.hpp"
 
 namespace admengine {
 
+  namespace {
+
+    /// Read-only stream buffer over existing data, so that it can be read as a stream without being copied
+    class MemoryStreamBuffer : public std::streambuf {
+    public:
+      MemoryStreamBuffer(const char* data, const size_t size) {
+        char* begin = const_cast<char*>(data);
+        setg(begin, begin, begin + size);
+      }
+    };
+
+    /// Top-level element of an 'audioFormatExtended' element, as a byte range of the XML
+    struct AdmElementSpan {
+      std::string id;
+      size_t begin;
+      size_t end;
+      /// Text of the '...IDRef' sub-elements
+      std::vector<std::string> references;
+    };
+
+    bool endsWith(const std::string& str, const std::string& suffix) {
+      return str.size() >= suffix.size() && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+
+    std::string trim(const std::string& str) {
+      const size_t first = str.find_first_not_of(" \t\r\n");
+      if(first == std::string::npos) {
+        return "";
+      }
+      return str.substr(first, str.find_last_not_of(" \t\r\n") - first + 1);
+    }
+
+    /// Value of the ID attribute of a tag (e.g. 'audioObjectID', or 'UID' for an audioTrackUID)
+    std::string getIdAttribute(const std::string& tag) {
+      size_t position = tag.find_first_of(" \t\r\n");
+      while(position != std::string::npos) {
+        const size_t equal = tag.find('=', position);
+        if(equal == std::string::npos || equal + 1 >= tag.size()) {
+          break;
+        }
+        const std::string name = trim(tag.substr(position, equal - position));
+        const size_t valueBegin = tag.find_first_of("\"'", equal);
+        if(valueBegin == std::string::npos) {
+          break;
+        }
+        const size_t valueEnd = tag.find(tag[valueBegin], valueBegin + 1);
+        if(valueEnd == std::string::npos) {
+          break;
+        }
+        if(endsWith(name, "ID")) {
+          return tag.substr(valueBegin + 1, valueEnd - valueBegin - 1);
+        }
+        position = valueEnd + 1;
+      }
+      return "";
+    }
+
+    /// Local name of an element, without its namespace prefix
+    std::string getLocalName(const std::string& name) {
+      const size_t colon = name.find(':');
+      return colon == std::string::npos ? name : name.substr(colon + 1);
+    }
+
+    /**
+     * Scan the ADM elements of the XML, with their references, without building any DOM.
+     * Returns false if the XML is not well-formed enough to be scanned.
+     */
+    bool scanAdmElements(const char* data, const size_t size, std::vector<AdmElementSpan>& elements) {
+      const char* end = data + size;
+      const size_t NO_DEPTH = std::string::npos;
+      size_t depth = 0;
+      // depth of the audioFormatExtended children, and of the current child
+      size_t elementsDepth = NO_DEPTH;
+      bool inElement = false;
+      AdmElementSpan element;
+      const char* referenceText = nullptr;
+
+      const char* position = data;
+      while((position = (const char*)std::memchr(position, '<', end - position)) != nullptr) {
+        const char* tagBegin = position;
+        const size_t remaining = end - tagBegin;
+        const char* skipTo = nullptr;
+        if(remaining >= 4 && std::strncmp(tagBegin, "<!--", 4) == 0) {
+          skipTo = "-->";
+        } else if(remaining >= 9 && std::strncmp(tagBegin, "<![CDATA[", 9) == 0) {
+          skipTo = "]]>";
+        } else if(remaining >= 2 && (tagBegin[1] == '?' || tagBegin[1] == '!')) {
+          skipTo = ">";
+        }
+        if(skipTo) {
+          const char* skipEnd = std::search(tagBegin, end, skipTo, skipTo + std::strlen(skipTo));
+          if(skipEnd == end) {
+            return false;
+          }
+          position = skipEnd + std::strlen(skipTo);
+          continue;
+        }
+
+        // find the end of the tag, ignoring '>' in quoted attribute values
+        const char* tagEnd = tagBegin + 1;
+        char quote = 0;
+        while(tagEnd < end && (quote || *tagEnd != '>')) {
+          if(quote && *tagEnd == quote) {
+            quote = 0;
+          } else if(!quote && (*tagEnd == '"' || *tagEnd == '\'')) {
+            quote = *tagEnd;
+          }
+          ++tagEnd;
+        }
+        if(tagEnd == end) {
+          return false;
+        }
+        position = tagEnd + 1;
+
+        if(tagBegin[1] == '/') {
+          if(depth == 0) {
+            return false;
+          }
+          --depth;
+          if(referenceText) {
+            element.references.push_back(trim(std::string(referenceText, tagBegin - referenceText)));
+            referenceText = nullptr;
+          }
+          if(inElement && depth == elementsDepth) {
+            element.end = position - data;
+            elements.push_back(element);
+            inElement = false;
+          } else if(elementsDepth != NO_DEPTH && depth + 1 == elementsDepth) {
+            elementsDepth = NO_DEPTH;
+          }
+          continue;
+        }
+
+        const bool selfClosing = *(tagEnd - 1) == '/';
+        const char* nameEnd = tagBegin + 1;
+        while(nameEnd < tagEnd && !std::strchr(" \t\r\n/", *nameEnd)) {
+          ++nameEnd;
+        }
+        const std::string name = getLocalName(std::string(tagBegin + 1, nameEnd));
+        if(elementsDepth != NO_DEPTH && depth == elementsDepth) {
+          element = AdmElementSpan{ getIdAttribute(std::string(tagBegin + 1, tagEnd)), (size_t)(tagBegin - data), 0, {} };
+          inElement = true;
+          if(selfClosing) {
+            element.end = position - data;
+            elements.push_back(element);
+            inElement = false;
+          }
+        } else if(inElement && !selfClosing && endsWith(name, "IDRef")) {
+          referenceText = position;
+        } else if(name == "audioFormatExtended" && !selfClosing) {
+          elementsDepth = depth + 1;
+        }
+        if(!selfClosing) {
+          ++depth;
+        }
+      }
+      return depth == 0;
+    }
+
+    void appendJsonString(std::string& json, const std::string& value) {
+      json += '"';
+      for(const char c : value) {
+        switch(c) {
+          case '"': json += "\\\""; break;
+          case '\\': json += "\\\\"; break;
+          case '\n': json += "\\n"; break;
+          case '\r': json += "\\r"; break;
+          case '\t': json += "\\t"; break;
+          default:
+            if((unsigned char)c < 0x20) {
+              char escaped[7];
+              std::snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned char)c);
+              json += escaped;
+            } else {
+              json += c;
+            }
+        }
+      }
+      json += '"';
+    }
+
+    void appendJsonNumber(std::string& json, const double value) {
+      char number[32];
+      std::snprintf(number, sizeof(number), "%.9g", value);
+      json += number;
+    }
+
+    void appendJsonInteger(std::string& json, const uint64_t value) {
+      json += std::to_string(value);
+    }
+
+    /// Append a "key": value member (the value being already formatted), preceded by a comma if not the first member
+    void appendJsonKey(std::string& json, const char* key) {
+      if(json.back() != '{') {
+        json += ',';
+      }
+      json += '"';
+      json += key;
+      json += "\":";
+    }
+
+    template <class Element, class ElementId>
+    void appendJsonIds(std::string& json, const char* key, const std::vector<std::shared_ptr<Element>>& elements) {
+      appendJsonKey(json, key);
+      json += '[';
+      for(size_t index = 0; index < elements.size(); ++index) {
+        if(index) {
+          json += ',';
+        }
+        appendJsonString(json, adm::formatId(elements[index]->template get<ElementId>()));
+      }
+      json += ']';
+    }
+
+    double toSeconds(const std::chrono::nanoseconds& time) {
+      return time.count() / 1e9;
+    }
+
+    void appendJsonTypes(const std::shared_ptr<adm::AudioPackFormat>& audioPackFormat, std::vector<std::string>& types) {
+      const std::string type = adm::formatTypeDefinition(audioPackFormat->get<adm::TypeDescriptor>());
+      if(std::find(types.begin(), types.end(), type) == types.end()) {
+        types.push_back(type);
+      }
+    }
+
+    /// Size of the 'chna' header (number of tracks and of UIDs), and of each audio ID entry
+    const size_t CHNA_HEADER_SIZE = 4;
+    const size_t CHNA_AUDIO_ID_SIZE = 40;
+
+    uint16_t readChnaUint16(const char* data) {
+      // little-endian, as every BW64 field
+      return static_cast<uint16_t>(static_cast<unsigned char>(data[0]) | (static_cast<unsigned char>(data[1]) << 8));
+    }
+
+    /// Fixed-size 'chna' field, padded with null characters
+    std::string readChnaString(const char* data, const size_t size) {
+      return std::string(data, strnlen(data, size));
+    }
+
+  }
+
   std::shared_ptr<adm::Document> getAdmDocument(const std::shared_ptr<bw64::AxmlChunk>& axmlChunk) {
-    std::stringstream axmlStringstream;
-    if (axmlChunk) {
-      axmlChunk->write(axmlStringstream);
-    } else {
-      std::cerr << "Error: could not find any axml chunk" << std::endl;
-      exit(1);
+    if (!axmlChunk) {
+      throw std::runtime_error("Could not find any axml chunk.");
     }
-    return adm::parseXml(axmlStringstream);
+    return getAdmDocument(axmlChunk->data().data(), axmlChunk->data().size());
+  }
+
+  std::shared_ptr<adm::Document> getAdmDocument(const char* axmlData, const size_t axmlSize) {
+    // the XML is read straight from the chunk data
+    MemoryStreamBuffer axmlBuffer(axmlData, axmlSize);
+    std::istream axmlStream(&axmlBuffer);
+    return adm::parseXml(axmlStream);
+  }
+
+  std::shared_ptr<adm::Document> getAdmDocument(const std::shared_ptr<bw64::AxmlChunk>& axmlChunk, const std::string& elementId) {
+    if (!axmlChunk) {
+      throw std::runtime_error("Could not find any axml chunk.");
+    }
+    const std::string& axml = axmlChunk->data();
+    const std::string selectedAxml = selectAdmElements(axml, elementId);
+    if(selectedAxml.empty()) {
+      return getAdmDocument(axml.data(), axml.size());
+    }
+    return getAdmDocument(selectedAxml.data(), selectedAxml.size());
+  }
+
+  std::string selectAdmElements(const std::string& axml, const std::string& elementId) {
+    std::vector<AdmElementSpan> elements;
+    if(!scanAdmElements(axml.data(), axml.size(), elements)) {
+      std::cout << "[WARNING] Could not scan the ADM elements, the whole document is parsed." << std::endl;
+      return "";
+    }
+    std::map<std::string, size_t> elementIndexes;
+    for (size_t index = 0; index < elements.size(); ++index) {
+      elementIndexes.emplace(elements[index].id, index);
+    }
+    if(elementIndexes.find(elementId) == elementIndexes.end()) {
+      return "";
+    }
+
+    // follow the references from the selected element (those to common definitions are not in the document)
+    std::vector<bool> selected(elements.size(), false);
+    std::deque<size_t> pendingElements{ elementIndexes.at(elementId) };
+    selected[pendingElements.front()] = true;
+    size_t nbSelectedElements = 1;
+    while(!pendingElements.empty()) {
+      const AdmElementSpan& element = elements[pendingElements.front()];
+      pendingElements.pop_front();
+      for(const std::string& reference : element.references) {
+        const auto referencedElement = elementIndexes.find(reference);
+        if(referencedElement != elementIndexes.end() && !selected[referencedElement->second]) {
+          selected[referencedElement->second] = true;
+          pendingElements.push_back(referencedElement->second);
+          ++nbSelectedElements;
+        }
+      }
+    }
+    std::cout << " >> Parse " << nbSelectedElements << " of " << elements.size() << " ADM elements, required by " << elementId << std::endl;
+
+    // copy the XML without the unselected elements
+    std::string selectedAxml;
+    size_t copyFrom = 0;
+    for (size_t index = 0; index < elements.size(); ++index) {
+      if(!selected[index]) {
+        selectedAxml.append(axml, copyFrom, elements[index].begin - copyFrom);
+        copyFrom = elements[index].end;
+      }
+    }
+    selectedAxml.append(axml, copyFrom, std::string::npos);
+    return selectedAxml;
   }
 
   std::shared_ptr<bw64::AxmlChunk> parseAdmXmlChunk(const std::unique_ptr<bw64::Bw64Reader>& bw64File) {
@@ -35,6 +346,28 @@ namespace admengine {
     return std::shared_ptr<bw64::ChnaChunk>();
   }
 
+  std::shared_ptr<bw64::ChnaChunk> parseAdmChnaChunk(const char* chnaData, const size_t chnaSize) {
+    if(chnaSize < CHNA_HEADER_SIZE) {
+      throw std::runtime_error("Invalid 'chna' chunk: too short.");
+    }
+    const uint16_t nbUids = readChnaUint16(chnaData + 2);
+    if(chnaSize < CHNA_HEADER_SIZE + nbUids * CHNA_AUDIO_ID_SIZE) {
+      std::stringstream message;
+      message << "Invalid 'chna' chunk: " << nbUids << " audio IDs do not fit in " << chnaSize << " bytes.";
+      throw std::runtime_error(message.str());
+    }
+    std::vector<bw64::AudioId> audioIds;
+    for(size_t index = 0; index < nbUids; ++index) {
+      // track index (2 bytes), UID (12), track format reference (14), pack format reference (11), padding (1)
+      const char* audioId = chnaData + CHNA_HEADER_SIZE + index * CHNA_AUDIO_ID_SIZE;
+      audioIds.push_back(bw64::AudioId(readChnaUint16(audioId),
+                                       readChnaString(audioId + 2, 12),
+                                       readChnaString(audioId + 14, 14),
+                                       readChnaString(audioId + 28, 11)));
+    }
+    return std::make_shared<bw64::ChnaChunk>(audioIds);
+  }
+
   std::string getAdmDocumentAsString(const std::shared_ptr<adm::Document>& admDocument) {
     std::stringstream xmlStream;
     adm::writeXml(xmlStream, admDocument);
@@ -46,6 +379,27 @@ namespace admengine {
     std::cout << getAdmDocumentAsString(admDocument);
   }
 
+  void displayAdmTimeline(const std::shared_ptr<adm::Document>& admDocument, const uint32_t sampleRate) {
+    std::cout << "### ADM timeline:" << std::endl;
+    const TimelineIndex timelineIndex(admDocument, sampleRate);
+    for(auto audioObject : admDocument->getElements<adm::AudioObject>()) {
+      std::cout << " - " << formatId(audioObject->get<adm::AudioObjectId>()) << ": " << audioObject->get<adm::AudioObjectName>().get() << ":";
+      const std::vector<FrameSpan> activity = timelineIndex.getObjectActivity(audioObject);
+      if(activity.empty()) {
+        std::cout << " no active block";
+      }
+      for(const FrameSpan& frameSpan : activity) {
+        std::cout << " [" << (double)frameSpan.start / sampleRate << " s, ";
+        if(frameSpan.end == UNBOUNDED_FRAME) {
+          std::cout << "end]";
+        } else {
+          std::cout << (double)frameSpan.end / sampleRate << " s]";
+        }
+      }
+      std::cout << std::endl;
+    }
+  }
+
   void displayChnaChunk(const std::shared_ptr<bw64::ChnaChunk>& chnaChunk) {
     std::cout << "### BW64 file 'chna' chunk:" << std::endl;
     std::cout << " - numTracks: " << chnaChunk->numTracks() << std::endl;
@@ -72,6 +426,142 @@ namespace admengine {
   }
 
 
+  std::string getAdmMetadataAsJson(const std::unique_ptr<bw64::Bw64Reader>& bw64File) {
+    std::string json = "{";
+    appendJsonKey(json, "format");
+    json += '{';
+    appendJsonKey(json, "channels");
+    appendJsonInteger(json, bw64File->channels());
+    appendJsonKey(json, "sampleRate");
+    appendJsonInteger(json, bw64File->sampleRate());
+    appendJsonKey(json, "bitDepth");
+    appendJsonInteger(json, bw64File->bitDepth());
+    appendJsonKey(json, "numberOfFrames");
+    appendJsonInteger(json, bw64File->numberOfFrames());
+    appendJsonKey(json, "duration");
+    appendJsonNumber(json, bw64File->sampleRate() ? (double)bw64File->numberOfFrames() / bw64File->sampleRate() : 0.0);
+    json += '}';
+
+    appendJsonKey(json, "tracks");
+    json += '[';
+    if(const std::shared_ptr<bw64::ChnaChunk> chnaChunk = parseAdmChnaChunk(bw64File)) {
+      for(auto audioId : chnaChunk->audioIds()) {
+        if(json.back() != '[') {
+          json += ',';
+        }
+        json += '{';
+        appendJsonKey(json, "track");
+        appendJsonInteger(json, audioId.trackIndex());
+        appendJsonKey(json, "uid");
+        appendJsonString(json, audioId.uid());
+        appendJsonKey(json, "trackFormat");
+        appendJsonString(json, audioId.trackRef());
+        appendJsonKey(json, "packFormat");
+        appendJsonString(json, audioId.packRef());
+        json += '}';
+      }
+    }
+    json += ']';
+
+    // without any axml chunk, only the format and the tracks are dumped
+    const std::shared_ptr<bw64::AxmlChunk> axmlChunk = parseAdmXmlChunk(bw64File);
+    if(!axmlChunk) {
+      return json + "}";
+    }
+    const std::shared_ptr<adm::Document> admDocument = getAdmDocument(axmlChunk);
+
+    appendJsonKey(json, "programmes");
+    json += '[';
+    for(auto audioProgramme : admDocument->getElements<adm::AudioProgramme>()) {
+      if(json.back() != '[') {
+        json += ',';
+      }
+      json += '{';
+      appendJsonKey(json, "id");
+      appendJsonString(json, adm::formatId(audioProgramme->get<adm::AudioProgrammeId>()));
+      appendJsonKey(json, "name");
+      appendJsonString(json, audioProgramme->get<adm::AudioProgrammeName>().get());
+      appendJsonIds<adm::AudioContent, adm::AudioContentId>(json, "contents", getAudioContents(audioProgramme));
+      json += '}';
+    }
+    json += ']';
+
+    appendJsonKey(json, "contents");
+    json += '[';
+    for(auto audioContent : admDocument->getElements<adm::AudioContent>()) {
+      if(json.back() != '[') {
+        json += ',';
+      }
+      json += '{';
+      appendJsonKey(json, "id");
+      appendJsonString(json, adm::formatId(audioContent->get<adm::AudioContentId>()));
+      appendJsonKey(json, "name");
+      appendJsonString(json, audioContent->get<adm::AudioContentName>().get());
+      appendJsonIds<adm::AudioObject, adm::AudioObjectId>(json, "objects", getAudioObjects(audioContent));
+      json += '}';
+    }
+    json += ']';
+
+    appendJsonKey(json, "objects");
+    json += '[';
+    for(auto audioObject : admDocument->getElements<adm::AudioObject>()) {
+      if(json.back() != '[') {
+        json += ',';
+      }
+      json += '{';
+      appendJsonKey(json, "id");
+      appendJsonString(json, adm::formatId(audioObject->get<adm::AudioObjectId>()));
+      appendJsonKey(json, "name");
+      appendJsonString(json, audioObject->get<adm::AudioObjectName>().get());
+      appendJsonKey(json, "start");
+      appendJsonNumber(json, audioObject->has<adm::Start>() ? toSeconds(audioObject->get<adm::Start>().get()) : 0.0);
+      if(audioObject->has<adm::Duration>()) {
+        appendJsonKey(json, "duration");
+        appendJsonNumber(json, toSeconds(audioObject->get<adm::Duration>().get()));
+      }
+      std::vector<std::string> types;
+      for(auto audioPackFormat : audioObject->getReferences<adm::AudioPackFormat>()) {
+        appendJsonTypes(audioPackFormat, types);
+      }
+      appendJsonKey(json, "types");
+      json += '[';
+      for(const std::string& type : types) {
+        if(json.back() != '[') {
+          json += ',';
+        }
+        appendJsonString(json, type);
+      }
+      json += ']';
+      appendJsonIds<adm::AudioPackFormat, adm::AudioPackFormatId>(json, "packs", getAudioPackFormats(audioObject));
+      appendJsonIds<adm::AudioTrackUid, adm::AudioTrackUidId>(json, "trackUids", getAudioTrackUids(audioObject));
+      appendJsonIds<adm::AudioObject, adm::AudioObjectId>(json, "objects", audioObject->getReferences<adm::AudioObject>());
+      json += '}';
+    }
+    json += ']';
+
+    appendJsonKey(json, "packs");
+    json += '[';
+    for(auto audioPackFormat : admDocument->getElements<adm::AudioPackFormat>()) {
+      if(json.back() != '[') {
+        json += ',';
+      }
+      json += '{';
+      appendJsonKey(json, "id");
+      appendJsonString(json, adm::formatId(audioPackFormat->get<adm::AudioPackFormatId>()));
+      appendJsonKey(json, "name");
+      appendJsonString(json, audioPackFormat->get<adm::AudioPackFormatName>().get());
+      appendJsonKey(json, "type");
+      appendJsonString(json, adm::formatTypeDefinition(audioPackFormat->get<adm::TypeDescriptor>()));
+      appendJsonKey(json, "channels");
+      appendJsonInteger(json, audioPackFormat->getReferences<adm::AudioChannelFormat>().size());
+      json += '}';
+    }
+    json += ']';
+
+    return json + "}";
+  }
+
+
   void parseAudioProgramme(const std::shared_ptr<adm::AudioProgramme>& audioProgramme) {
     // parse audio programmes to get audio contents
     displayAudioProgramme(audioProgramme);
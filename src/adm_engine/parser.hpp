@@ -8,14 +8,33 @@
 namespace admengine {
 
   std::shared_ptr<adm::Document> getAdmDocument(const std::shared_ptr<bw64::AxmlChunk>& axmlChunk);
+  /// Parse an ADM document from the raw 'axml' chunk data (e.g. memory-mapped), without copying it
+  std::shared_ptr<adm::Document> getAdmDocument(const char* axmlData, const size_t axmlSize);
+  /// Parse only the ADM elements that the given element (e.g. "APR_1001" or "AO_1001") depends on
+  std::shared_ptr<adm::Document> getAdmDocument(const std::shared_ptr<bw64::AxmlChunk>& axmlChunk, const std::string& elementId);
+  /**
+   * Remove the audioFormatExtended elements that the given element does not reference, directly or not,
+   * from the axml data, scanning it without building any DOM. Returns an empty string if the element
+   * is not found, or if the data cannot be scanned.
+   */
+  std::string selectAdmElements(const std::string& axml, const std::string& elementId);
   std::shared_ptr<bw64::AxmlChunk> parseAdmXmlChunk(const std::unique_ptr<bw64::Bw64Reader>& bw64File);
   std::shared_ptr<bw64::ChnaChunk> parseAdmChnaChunk(const std::unique_ptr<bw64::Bw64Reader>& bw64File);
+  /// Parse a 'chna' chunk from its raw data (without the chunk header), as written in a BW64 file
+  std::shared_ptr<bw64::ChnaChunk> parseAdmChnaChunk(const char* chnaData, const size_t chnaSize);
 
   std::string getAdmDocumentAsString(const std::shared_ptr<adm::Document>& admDocument);
 
   void displayAdmDocument(const std::shared_ptr<adm::Document>& admDocument);
+  /// Display the activity spans of each audio object, from the block timings only
+  void displayAdmTimeline(const std::shared_ptr<adm::Document>& admDocument, const uint32_t sampleRate);
   void displayChnaChunk(const std::shared_ptr<bw64::ChnaChunk>& chnaChunk);
   void displayBw64FileInfos(const std::unique_ptr<bw64::Bw64Reader>& bw64File);
+  /**
+   * Summary of the file format, 'chna' track mapping, and ADM programmes, contents, objects and packs,
+   * as a compact JSON object. Only the file header and the ADM chunks are read, never the audio data.
+   */
+  std::string getAdmMetadataAsJson(const std::unique_ptr<bw64::Bw64Reader>& bw64File);
 
   void parseAudioProgramme(const std::shared_ptr<adm::AudioProgramme>& audioProgramme);
   void parseAudioContent(const std::shared_ptr<adm::AudioContent>& audioContent);
@@ -0,0 +1,101 @@
+
+#include "pcm.hpp"
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace admengine {
+
+namespace {
+
+template <int NB_BYTES>
+void encodeSamples(const float* input, char* output, const size_t nbSamples) {
+  const double scale = (double)((1ull << (NB_BYTES * 8 - 1)) - 1);
+  for (size_t i = 0; i < nbSamples; ++i) {
+    double sample = input[i];
+    if(sample > 1.0) {
+      sample = 1.0;
+    } else if(sample < -1.0) {
+      sample = -1.0;
+    }
+    sample *= scale;
+    const int32_t value = (int32_t)(sample >= 0.0 ? sample + 0.5 : sample - 0.5);
+    for (int b = 0; b < NB_BYTES; ++b) {
+      output[b] = (char)((value >> (8 * b)) & 0xFF);
+    }
+    output += NB_BYTES;
+  }
+}
+
+template <int NB_BYTES>
+void decodeSamples(const char* input,
+                   const size_t inputNbChannels,
+                   const size_t* channelIds,
+                   const size_t nbChannels,
+                   float* output,
+                   const size_t nbFrames) {
+  // samples are shifted up to 32 bits (sign included), then scaled by a power of two, hence exactly
+  const float scale = 1.0f / 2147483648.0f;
+  const size_t frameSize = inputNbChannels * NB_BYTES;
+  for (size_t frame = 0; frame < nbFrames; ++frame) {
+    const char* inputFrame = input + frame * frameSize;
+    for (size_t c = 0; c < nbChannels; ++c) {
+      const uint8_t* sample = reinterpret_cast<const uint8_t*>(inputFrame + channelIds[c] * NB_BYTES);
+      uint32_t value = 0;
+      for (int b = 0; b < NB_BYTES; ++b) {
+        value |= (uint32_t)sample[b] << (8 * (b + 4 - NB_BYTES));
+      }
+      output[c] = (float)(int32_t)value * scale;
+    }
+    output += nbChannels;
+  }
+}
+
+}
+
+void decodePcmSamples(const char* input,
+                      const size_t inputNbChannels,
+                      const size_t* channelIds,
+                      const size_t nbChannels,
+                      float* output,
+                      const size_t nbFrames,
+                      const uint16_t bitDepth) {
+  switch(bitDepth) {
+    case 16: decodeSamples<2>(input, inputNbChannels, channelIds, nbChannels, output, nbFrames); break;
+    case 24: decodeSamples<3>(input, inputNbChannels, channelIds, nbChannels, output, nbFrames); break;
+    case 32: decodeSamples<4>(input, inputNbChannels, channelIds, nbChannels, output, nbFrames); break;
+    default:
+      throw std::runtime_error("Unsupported PCM bit depth: " + std::to_string(bitDepth));
+  }
+}
+
+void decodeFloatSamples(const char* input,
+                        const size_t inputNbChannels,
+                        const size_t* channelIds,
+                        const size_t nbChannels,
+                        float* output,
+                        const size_t nbFrames) {
+  // IEEE float bits, assembled byte by byte as the data may be unaligned
+  for (size_t frame = 0; frame < nbFrames; ++frame) {
+    const char* inputFrame = input + frame * inputNbChannels * sizeof(float);
+    for (size_t c = 0; c < nbChannels; ++c) {
+      const uint8_t* sample = reinterpret_cast<const uint8_t*>(inputFrame + channelIds[c] * sizeof(float));
+      const uint32_t value = (uint32_t)sample[0] | ((uint32_t)sample[1] << 8) | ((uint32_t)sample[2] << 16) | ((uint32_t)sample[3] << 24);
+      std::memcpy(&output[c], &value, sizeof(float));
+    }
+    output += nbChannels;
+  }
+}
+
+void encodePcmSamples(const float* input, char* output, const size_t nbSamples, const uint16_t bitDepth) {
+  switch(bitDepth) {
+    case 16: encodeSamples<2>(input, output, nbSamples); break;
+    case 24: encodeSamples<3>(input, output, nbSamples); break;
+    case 32: encodeSamples<4>(input, output, nbSamples); break;
+    default:
+      throw std::runtime_error("Unsupported PCM bit depth: " + std::to_string(bitDepth));
+  }
+}
+
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace admengine {
+
+/// Convert float samples to little-endian integer PCM (16, 24 or 32 bits), with clipping
+void encodePcmSamples(const float* input, char* output, const size_t nbSamples, const uint16_t bitDepth);
+
+/// Convert the selected channels of interleaved little-endian integer PCM frames into compact interleaved float frames
+void decodePcmSamples(const char* input,
+                      const size_t inputNbChannels,
+                      const size_t* channelIds,
+                      const size_t nbChannels,
+                      float* output,
+                      const size_t nbFrames,
+                      const uint16_t bitDepth);
+
+/// Same as decodePcmSamples, for little-endian 32-bit IEEE float samples
+void decodeFloatSamples(const char* input,
+                        const size_t inputNbChannels,
+                        const size_t* channelIds,
+                        const size_t nbChannels,
+                        float* output,
+                        const size_t nbFrames);
+
+}
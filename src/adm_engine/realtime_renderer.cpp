@@ -0,0 +1,201 @@
+#include "realtime_renderer.hpp"
+
+#include "parser.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace admengine {
+
+RealtimeRenderer::RealtimeRenderer(const char* axmlData,
+                                   const size_t axmlSize,
+                                   const char* chnaData,
+                                   const size_t chnaSize,
+                                   const uint16_t nbInputChannels,
+                                   const uint32_t sampleRate,
+                                   const std::vector<std::string>& outputLayouts,
+                                   const std::map<std::string, float> elementGains,
+                                   const std::string& elementIdToRender,
+                                   const size_t maxBlockSize,
+                                   const size_t gainQueueCapacity)
+  // render plans are left at unity gains, element gains being applied to the input tracks
+  : _bufferRenderer(axmlData, axmlSize, chnaData, chnaSize, nbInputChannels, sampleRate, outputLayouts, {}, elementIdToRender)
+  , _maxBlockSize(maxBlockSize ? maxBlockSize : DEFAULT_REALTIME_BLOCK_SIZE)
+  , _gainRampLength(sampleRate * DEFAULT_GAIN_RAMP_DURATION / 1000)
+  , _gainChanges(gainQueueCapacity)
+  , _framePosition(0)
+  , _trackTargetGains(nbInputChannels, 1.0)
+  , _trackGainSteps(nbInputChannels, 0.0)
+  , _trackRampLengths(nbInputChannels, 0)
+  , _scaledInput(_maxBlockSize * nbInputChannels)
+  , _blockOutputs(_bufferRenderer.getNbOutputLayouts())
+{
+  // input tracks of each element, without duplicates (an object may belong to several contents)
+  std::map<std::string, std::vector<size_t>> elementTracks;
+  const auto addTracks = [](std::vector<size_t>& tracks, const std::vector<size_t>& otherTracks) {
+    for(const size_t inputTrackId : otherTracks) {
+      if(std::find(tracks.begin(), tracks.end(), inputTrackId) == tracks.end()) {
+        tracks.push_back(inputTrackId);
+      }
+    }
+  };
+  const std::shared_ptr<adm::Document> document = _bufferRenderer.getDocument();
+  for(auto audioObject : document->getElements<adm::AudioObject>()) {
+    std::vector<size_t>& tracks = elementTracks[formatId(audioObject->get<adm::AudioObjectId>())];
+    for(auto audioTrackUid : getAudioTrackUids(audioObject)) {
+      // same track indexes as the render plans
+      const size_t inputTrackId = audioTrackUid->get<adm::AudioTrackUidId>().get<adm::AudioTrackUidIdValue>().get() - 1;
+      if(inputTrackId < nbInputChannels) {
+        addTracks(tracks, { inputTrackId });
+      }
+    }
+  }
+  for(auto audioContent : document->getElements<adm::AudioContent>()) {
+    std::vector<size_t>& tracks = elementTracks[formatId(audioContent->get<adm::AudioContentId>())];
+    for(auto audioObject : getAudioObjects(audioContent)) {
+      addTracks(tracks, elementTracks[formatId(audioObject->get<adm::AudioObjectId>())]);
+    }
+  }
+  for(auto audioProgramme : document->getElements<adm::AudioProgramme>()) {
+    std::vector<size_t>& tracks = elementTracks[formatId(audioProgramme->get<adm::AudioProgrammeId>())];
+    for(auto audioContent : getAudioContents(audioProgramme)) {
+      addTracks(tracks, elementTracks[formatId(audioContent->get<adm::AudioContentId>())]);
+    }
+  }
+
+  // a track gain is the product of the gains of its object, content and programme
+  _trackElementIndexes.resize(nbInputChannels);
+  for(const auto& element : elementTracks) {
+    const size_t elementIndex = _elementTrackIds.size();
+    _elementIndexes[element.first] = elementIndex;
+    _elementTrackIds.push_back(element.second);
+    for(const size_t inputTrackId : element.second) {
+      _trackElementIndexes[inputTrackId].push_back(elementIndex);
+    }
+    const auto elementGain = elementGains.find(element.first);
+    _elementGains.push_back(elementGain == elementGains.end() ? 1.0 : elementGain->second);
+  }
+  _pendingGainChanges.reserve(_gainChanges.capacity());
+
+  // initial gains apply from the first frame, without any ramp
+  _trackGains.resize(nbInputChannels);
+  for (size_t inputTrackId = 0; inputTrackId < nbInputChannels; ++inputTrackId) {
+    _trackGains[inputTrackId] = getTrackGain(inputTrackId);
+  }
+  _trackTargetGains = _trackGains;
+}
+
+void RealtimeRenderer::setGainRampLength(const size_t rampLength) {
+  _gainRampLength = rampLength;
+}
+
+bool RealtimeRenderer::setElementGain(const std::string& elementId, const float gain, const uint64_t framePosition) {
+  const auto elementIndex = _elementIndexes.find(elementId);
+  if(elementIndex == _elementIndexes.end()) {
+    throw std::runtime_error("Could not find any audio element from ID: '" + elementId + "'.");
+  }
+  // the tracks of the element get their new gains on the audio thread
+  return _gainChanges.push(GainChange{ framePosition, elementIndex->second, gain, _gainRampLength });
+}
+
+float RealtimeRenderer::getTrackGain(const size_t inputTrackId) const {
+  float gain = 1.0;
+  for(const size_t elementIndex : _trackElementIndexes[inputTrackId]) {
+    gain *= _elementGains[elementIndex];
+  }
+  return gain;
+}
+
+void RealtimeRenderer::process(const float* input, float* const* outputs, const size_t nbFrames) {
+  const size_t nbInputChannels = _trackGains.size();
+  for (size_t frame = 0; frame < nbFrames; frame += _maxBlockSize) {
+    const size_t nbBlockFrames = std::min(_maxBlockSize, nbFrames - frame);
+    scaleInput(input + frame * nbInputChannels, nbBlockFrames);
+    for (size_t layoutIndex = 0; layoutIndex < _blockOutputs.size(); ++layoutIndex) {
+      _blockOutputs[layoutIndex] = outputs[layoutIndex] + frame * _bufferRenderer.getNbOutputChannels(layoutIndex);
+    }
+    _bufferRenderer.process(_scaledInput.data(), nbBlockFrames, _blockOutputs.data());
+  }
+  _framePosition.store(_bufferRenderer.getFramePosition(), std::memory_order_relaxed);
+}
+
+void RealtimeRenderer::takeGainChanges() {
+  // sorted as they are taken (within the reserved capacity), the latest change of a position coming first
+  while(_pendingGainChanges.size() < _pendingGainChanges.capacity()) {
+    const GainChange* gainChange = _gainChanges.front();
+    if(!gainChange) {
+      break;
+    }
+    const auto position = std::lower_bound(_pendingGainChanges.begin(), _pendingGainChanges.end(), gainChange->framePosition,
+                                           [](const GainChange& pendingGainChange, const uint64_t framePosition) { return pendingGainChange.framePosition > framePosition; });
+    _pendingGainChanges.insert(position, *gainChange);
+    _gainChanges.pop();
+  }
+}
+
+void RealtimeRenderer::scaleInput(const float* input, const size_t nbFrames) {
+  const uint64_t blockPosition = _bufferRenderer.getFramePosition();
+  size_t frame = 0;
+  while(frame < nbFrames) {
+    // gain changes due so far are applied, and the next one ends the frames scaled with the current gains
+    takeGainChanges();
+    size_t lastFrame = nbFrames;
+    while(!_pendingGainChanges.empty()) {
+      const GainChange& gainChange = _pendingGainChanges.back();
+      if(gainChange.framePosition > blockPosition + frame) {
+        lastFrame = std::min<uint64_t>(nbFrames, gainChange.framePosition - blockPosition);
+        break;
+      }
+      applyGainChange(gainChange);
+      _pendingGainChanges.pop_back();
+    }
+    scaleInputFrames(input, frame, lastFrame);
+    frame = lastFrame;
+  }
+}
+
+void RealtimeRenderer::scaleInputFrames(const float* input, const size_t firstFrame, const size_t lastFrame) {
+  const size_t nbInputChannels = _trackGains.size();
+  for (size_t channel = 0; channel < nbInputChannels; ++channel) {
+    float gain = _trackGains[channel];
+    size_t frame = firstFrame;
+    if(_trackRampLengths[channel]) {
+      const size_t rampLastFrame = std::min(lastFrame, firstFrame + _trackRampLengths[channel]);
+      const float gainStep = _trackGainSteps[channel];
+      for (; frame < rampLastFrame; ++frame) {
+        gain += gainStep;
+        _scaledInput[frame * nbInputChannels + channel] = input[frame * nbInputChannels + channel] * gain;
+      }
+      _trackRampLengths[channel] -= rampLastFrame - firstFrame;
+      if(_trackRampLengths[channel] == 0) {
+        // no rounding error left once the ramp is over
+        gain = _trackTargetGains[channel];
+      }
+    }
+    for (; frame < lastFrame; ++frame) {
+      _scaledInput[frame * nbInputChannels + channel] = input[frame * nbInputChannels + channel] * gain;
+    }
+    _trackGains[channel] = gain;
+  }
+}
+
+void RealtimeRenderer::applyGainChange(const GainChange& gainChange) {
+  _elementGains[gainChange.elementIndex] = gainChange.gain;
+  for(const size_t inputTrackId : _elementTrackIds[gainChange.elementIndex]) {
+    startGainRamp(inputTrackId, getTrackGain(inputTrackId), gainChange.rampLength);
+  }
+}
+
+void RealtimeRenderer::startGainRamp(const size_t inputTrackId, const float gain, const size_t rampLength) {
+  _trackTargetGains[inputTrackId] = gain;
+  _trackRampLengths[inputTrackId] = rampLength;
+  if(rampLength == 0) {
+    _trackGains[inputTrackId] = gain;
+    _trackGainSteps[inputTrackId] = 0.0;
+  } else {
+    // ramps start from the current gain, even if a previous ramp did not reach its target
+    _trackGainSteps[inputTrackId] = (gain - _trackGains[inputTrackId]) / rampLength;
+  }
+}
+
+}
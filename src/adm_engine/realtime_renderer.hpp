@@ -0,0 +1,107 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "buffer_renderer.hpp"
+#include "spsc_queue.hpp"
+
+namespace admengine {
+
+const unsigned int DEFAULT_REALTIME_BLOCK_SIZE = 256; // in frames
+const unsigned int DEFAULT_GAIN_QUEUE_CAPACITY = 1024; // in gain changes
+const unsigned int DEFAULT_GAIN_RAMP_DURATION = 10; // in milliseconds
+
+/**
+ * Renderer of in-memory content from a realtime audio thread.
+ *
+ * Everything is prepared by the constructor (ADM parsing, render plans, buffers), so that process
+ * takes no lock, makes no heap allocation and does not log anything. Element gains are applied to
+ * the input tracks before mixing: gain changes are published by a control thread through a
+ * lock-free queue, and ramp linearly from the given frame position, so that they are sample-accurate.
+ */
+class RealtimeRenderer {
+
+public:
+  /// Render the given element, or the first audio programme (or audio object) if no element ID is given
+  RealtimeRenderer(const char* axmlData,
+                   const size_t axmlSize,
+                   const char* chnaData,
+                   const size_t chnaSize,
+                   const uint16_t nbInputChannels,
+                   const uint32_t sampleRate,
+                   const std::vector<std::string>& outputLayouts,
+                   const std::map<std::string, float> elementGains = {},
+                   const std::string& elementIdToRender = "",
+                   const size_t maxBlockSize = DEFAULT_REALTIME_BLOCK_SIZE,
+                   const size_t gainQueueCapacity = DEFAULT_GAIN_QUEUE_CAPACITY);
+  RealtimeRenderer(const RealtimeRenderer&) = delete;
+  RealtimeRenderer& operator=(const RealtimeRenderer&) = delete;
+
+  const BufferRenderer& getBufferRenderer() const { return _bufferRenderer; }
+  /// Number of input frames rendered so far (from any thread)
+  uint64_t getFramePosition() const { return _framePosition.load(std::memory_order_relaxed); }
+
+  /// Duration of the next gain ramps, in frames (from the control thread)
+  void setGainRampLength(const size_t rampLength);
+  /**
+   * Set the linear gain of an audio programme, content or object, ramping from the given frame position
+   * (as soon as possible if already rendered). Changes apply by frame position, whatever the order they
+   * are set in (and in that order at the same position), so that a change scheduled later never holds
+   * back the next ones. Called from a single control thread: returns false if the gain queue is full,
+   * in which case nothing changes.
+   */
+  bool setElementGain(const std::string& elementId, const float gain, const uint64_t framePosition = 0);
+
+  /// Render interleaved input frames into an output buffer per layout, from the audio thread (wait-free)
+  void process(const float* input, float* const* outputs, const size_t nbFrames);
+
+private:
+  /// Gain of an element, that its input tracks reach after a linear ramp starting at a frame position
+  struct GainChange {
+    uint64_t framePosition;
+    size_t elementIndex;
+    float gain;
+    size_t rampLength;
+  };
+
+  /// Product of the gains of the elements of an input track
+  float getTrackGain(const size_t inputTrackId) const;
+  void takeGainChanges();
+  void scaleInput(const float* input, const size_t nbFrames);
+  void scaleInputFrames(const float* input, const size_t firstFrame, const size_t lastFrame);
+  void applyGainChange(const GainChange& gainChange);
+  void startGainRamp(const size_t inputTrackId, const float gain, const size_t rampLength);
+
+private:
+  BufferRenderer _bufferRenderer;
+  const size_t _maxBlockSize;
+
+  // control thread state
+  /// Index of each audio programme, content and object
+  std::map<std::string, size_t> _elementIndexes;
+  size_t _gainRampLength;
+
+  SpscQueue<GainChange> _gainChanges;
+  std::atomic<uint64_t> _framePosition;
+
+  // audio thread state, allocated once
+  /// Input tracks of each element, and elements of each input track, by index
+  std::vector<std::vector<size_t>> _elementTrackIds;
+  std::vector<std::vector<size_t>> _trackElementIndexes;
+  std::vector<float> _elementGains;
+  /// Gain changes taken from the queue, from the latest frame position to the earliest one
+  std::vector<GainChange> _pendingGainChanges;
+  std::vector<float> _trackGains;
+  std::vector<float> _trackTargetGains;
+  std::vector<float> _trackGainSteps;
+  /// Remaining frames of the track gain ramps
+  std::vector<size_t> _trackRampLengths;
+  std::vector<float> _scaledInput;
+  std::vector<float*> _blockOutputs;
+};
+
+}
@@ -0,0 +1,469 @@
+#include "render_plan.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace admengine {
+
+/// Number of time-varying input tracks mixed at once by the ramp kernel
+const size_t RAMP_TRACK_GROUP_SIZE = 16;
+
+/// Serialised render plan header, followed by the plan version
+const char RENDER_PLAN_MAGIC[8] = { 'A', 'D', 'M', 'P', 'L', 'A', 'N', '1' };
+/// Bound on serialised vector sizes, against corrupted files
+const uint64_t MAX_RENDER_PLAN_VALUES = 1ull << 32;
+
+namespace {
+
+void writeValue(std::ostream& stream, const uint64_t value) {
+  stream.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <class T>
+void writeValues(std::ostream& stream, const std::vector<T>& values) {
+  writeValue(stream, values.size());
+  stream.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+}
+
+uint64_t readValue(std::istream& stream) {
+  uint64_t value = 0;
+  if(!stream.read(reinterpret_cast<char*>(&value), sizeof(value))) {
+    throw std::runtime_error("Truncated render plan.");
+  }
+  return value;
+}
+
+template <class T>
+std::vector<T> readValues(std::istream& stream) {
+  const uint64_t size = readValue(stream);
+  if(size > MAX_RENDER_PLAN_VALUES) {
+    throw std::runtime_error("Invalid render plan size.");
+  }
+  std::vector<T> values(size);
+  if(!stream.read(reinterpret_cast<char*>(values.data()), size * sizeof(T))) {
+    throw std::runtime_error("Truncated render plan.");
+  }
+  return values;
+}
+
+}
+
+RenderPlan::RenderPlan(const size_t nbOutputChannels)
+  : _nbOutputChannels(nbOutputChannels)
+  , _kernel(getMixingKernel(nbOutputChannels))
+  , _rampKernel(getRampMixingKernel())
+{
+}
+
+size_t RenderPlan::getInputTrackIndex(const size_t inputTrackId) const {
+  for (size_t i = 0; i < _inputTrackIds.size(); ++i) {
+    if(_inputTrackIds[i] == inputTrackId) {
+      return i;
+    }
+  }
+  return _inputTrackIds.size();
+}
+
+size_t RenderPlan::getGainTimelineIndex(const size_t inputTrackId) const {
+  for (size_t i = 0; i < _gainTimelines.size(); ++i) {
+    if(_gainTimelines[i].inputTrackId == inputTrackId) {
+      return i;
+    }
+  }
+  return _gainTimelines.size();
+}
+
+size_t RenderPlan::addInputTrack(const size_t inputTrackId) {
+  const size_t index = getInputTrackIndex(inputTrackId);
+  if(index < _inputTrackIds.size()) {
+    return index;
+  }
+
+  // insert a new zero column into the row-major matrix
+  const size_t nbInputTracks = _inputTrackIds.size();
+  std::vector<float> gains(_nbOutputChannels * (nbInputTracks + 1), 0.0);
+  for (size_t oc = 0; oc < _nbOutputChannels; ++oc) {
+    for (size_t i = 0; i < nbInputTracks; ++i) {
+      gains[oc * (nbInputTracks + 1) + i] = _gains[oc * nbInputTracks + i];
+    }
+  }
+  _gains.swap(gains);
+  _inputTrackIds.push_back(inputTrackId);
+  return nbInputTracks;
+}
+
+void RenderPlan::removeInputTrack(const size_t inputTrackId) {
+  const size_t timelineIndex = getGainTimelineIndex(inputTrackId);
+  if(timelineIndex < _gainTimelines.size()) {
+    _gainTimelines.erase(_gainTimelines.begin() + timelineIndex);
+  }
+
+  const size_t index = getInputTrackIndex(inputTrackId);
+  if(index == _inputTrackIds.size()) {
+    return;
+  }
+  // remove the column from the row-major matrix
+  const size_t nbInputTracks = _inputTrackIds.size();
+  std::vector<float> gains;
+  gains.reserve(_nbOutputChannels * (nbInputTracks - 1));
+  for (size_t oc = 0; oc < _nbOutputChannels; ++oc) {
+    for (size_t i = 0; i < nbInputTracks; ++i) {
+      if(i != index) {
+        gains.push_back(_gains[oc * nbInputTracks + i]);
+      }
+    }
+  }
+  _gains.swap(gains);
+  _inputTrackIds.erase(_inputTrackIds.begin() + index);
+}
+
+void RenderPlan::setInputTrackGains(const size_t inputTrackId, const std::vector<float>& gains) {
+  if(gains.size() != _nbOutputChannels) {
+    throw std::runtime_error("Render plan gains do not fit the number of output channels.");
+  }
+  if(getGainTimelineIndex(inputTrackId) < _gainTimelines.size()) {
+    removeInputTrack(inputTrackId);
+  }
+  const size_t index = addInputTrack(inputTrackId);
+  const size_t nbInputTracks = _inputTrackIds.size();
+  for (size_t oc = 0; oc < _nbOutputChannels; ++oc) {
+    _gains[oc * nbInputTracks + index] = gains[oc];
+  }
+  updateKernel();
+}
+
+void RenderPlan::setInputTrackGains(const size_t inputTrackId, const std::vector<GainPoint>& gainPoints) {
+  setGainTimeline(inputTrackId, gainPoints);
+  updateKernel();
+}
+
+void RenderPlan::setGainTimeline(const size_t inputTrackId, const std::vector<GainPoint>& gainPoints) {
+  if(gainPoints.empty()) {
+    throw std::runtime_error("Render plan gain timeline has no gain point.");
+  }
+  for (size_t p = 0; p < gainPoints.size(); ++p) {
+    if(gainPoints[p].gains.size() != _nbOutputChannels) {
+      throw std::runtime_error("Render plan gains do not fit the number of output channels.");
+    }
+    if(p && gainPoints[p].frame < gainPoints[p - 1].frame) {
+      throw std::runtime_error("Render plan gain points are not sorted by frame.");
+    }
+  }
+  removeInputTrack(inputTrackId);
+
+  GainTimeline gainTimeline;
+  gainTimeline.inputTrackId = inputTrackId;
+  const size_t gainStride = getMixingGainStride(_nbOutputChannels);
+  // the first gains are held from the start of the rendering
+  const bool holdFirstGains = gainPoints.front().frame > 0;
+  const size_t nbPoints = gainPoints.size() + (holdFirstGains ? 1 : 0);
+  gainTimeline.gains.assign(nbPoints * gainStride, 0.0);
+  for (size_t p = 0; p < nbPoints; ++p) {
+    const GainPoint& gainPoint = gainPoints[holdFirstGains && p ? p - 1 : p];
+    gainTimeline.frames.push_back(holdFirstGains && p == 0 ? 0 : gainPoint.frame);
+    std::copy(gainPoint.gains.begin(), gainPoint.gains.end(), gainTimeline.gains.begin() + p * gainStride);
+  }
+  updateGainSteps(gainTimeline);
+  _gainTimelines.push_back(gainTimeline);
+}
+
+void RenderPlan::updateGainSteps(GainTimeline& gainTimeline) const {
+  const size_t gainStride = getMixingGainStride(_nbOutputChannels);
+  const size_t nbPoints = gainTimeline.frames.size();
+  gainTimeline.gainSteps.assign(nbPoints * gainStride, 0.0);
+  for (size_t p = 0; p + 1 < nbPoints; ++p) {
+    const uint64_t rampLength = gainTimeline.frames[p + 1] - gainTimeline.frames[p];
+    if(rampLength == 0) {
+      continue;
+    }
+    for (size_t oc = 0; oc < _nbOutputChannels; ++oc) {
+      const float gainDelta = gainTimeline.gains[(p + 1) * gainStride + oc] - gainTimeline.gains[p * gainStride + oc];
+      gainTimeline.gainSteps[p * gainStride + oc] = gainDelta / rampLength;
+    }
+  }
+}
+
+std::vector<float> RenderPlan::getTrackGains(const size_t inputTrackId, const uint64_t framePosition, const bool beforeJump) const {
+  std::vector<float> gains(_nbOutputChannels, 0.0);
+  const size_t index = getInputTrackIndex(inputTrackId);
+  if(index < _inputTrackIds.size()) {
+    for (size_t oc = 0; oc < _nbOutputChannels; ++oc) {
+      gains[oc] = _gains[oc * _inputTrackIds.size() + index];
+    }
+    return gains;
+  }
+
+  const size_t timelineIndex = getGainTimelineIndex(inputTrackId);
+  if(timelineIndex == _gainTimelines.size()) {
+    return gains;
+  }
+  const GainTimeline& gainTimeline = _gainTimelines[timelineIndex];
+  const size_t gainStride = getMixingGainStride(_nbOutputChannels);
+  const auto first = std::lower_bound(gainTimeline.frames.begin(), gainTimeline.frames.end(), framePosition);
+  const auto last = std::upper_bound(gainTimeline.frames.begin(), gainTimeline.frames.end(), framePosition);
+  if(first != last) {
+    // on a gain point: take the gains on the requested side of a jump
+    const size_t p = (beforeJump ? first : last - 1) - gainTimeline.frames.begin();
+    std::copy(gainTimeline.gains.begin() + p * gainStride, gainTimeline.gains.begin() + p * gainStride + _nbOutputChannels, gains.begin());
+    return gains;
+  }
+  // within a ramp (timelines start at frame 0, hence there is a previous point)
+  const size_t p = (first - gainTimeline.frames.begin()) - 1;
+  const float position = (float)(framePosition - gainTimeline.frames[p]);
+  for (size_t oc = 0; oc < _nbOutputChannels; ++oc) {
+    gains[oc] = gainTimeline.gains[p * gainStride + oc] + position * gainTimeline.gainSteps[p * gainStride + oc];
+  }
+  return gains;
+}
+
+std::vector<uint64_t> RenderPlan::getTrackGainFrames(const size_t inputTrackId) const {
+  const size_t timelineIndex = getGainTimelineIndex(inputTrackId);
+  if(timelineIndex == _gainTimelines.size()) {
+    return std::vector<uint64_t>();
+  }
+  return _gainTimelines[timelineIndex].frames;
+}
+
+void RenderPlan::merge(const RenderPlan& renderPlan) {
+  if(renderPlan._nbOutputChannels != _nbOutputChannels) {
+    throw std::runtime_error("Cannot merge render plans with different numbers of output channels.");
+  }
+  for (const size_t inputTrackId : renderPlan._usedInputTrackIds) {
+    const size_t otherIndex = renderPlan.getInputTrackIndex(inputTrackId);
+    if(otherIndex < renderPlan._inputTrackIds.size() && getGainTimelineIndex(inputTrackId) == _gainTimelines.size()) {
+      // gains of input tracks used by both plans are summed up, as they would be mixed
+      const size_t index = addInputTrack(inputTrackId);
+      const size_t nbInputTracks = _inputTrackIds.size();
+      for (size_t oc = 0; oc < _nbOutputChannels; ++oc) {
+        _gains[oc * nbInputTracks + index] += renderPlan._gains[oc * renderPlan._inputTrackIds.size() + otherIndex];
+      }
+      continue;
+    }
+
+    // time-varying gains are summed up at the gain points of both plans, between which both are linear
+    std::vector<uint64_t> frames = getTrackGainFrames(inputTrackId);
+    const std::vector<uint64_t> otherFrames = renderPlan.getTrackGainFrames(inputTrackId);
+    frames.insert(frames.end(), otherFrames.begin(), otherFrames.end());
+    std::sort(frames.begin(), frames.end());
+    frames.erase(std::unique(frames.begin(), frames.end()), frames.end());
+
+    std::vector<GainPoint> gainPoints;
+    for (const uint64_t frame : frames) {
+      GainPoint before = { frame, getTrackGains(inputTrackId, frame, true) };
+      GainPoint after = { frame, getTrackGains(inputTrackId, frame, false) };
+      const std::vector<float> otherBefore = renderPlan.getTrackGains(inputTrackId, frame, true);
+      const std::vector<float> otherAfter = renderPlan.getTrackGains(inputTrackId, frame, false);
+      for (size_t oc = 0; oc < _nbOutputChannels; ++oc) {
+        before.gains[oc] += otherBefore[oc];
+        after.gains[oc] += otherAfter[oc];
+      }
+      if(before.gains != after.gains) {
+        gainPoints.push_back(before);
+      }
+      gainPoints.push_back(after);
+    }
+    setGainTimeline(inputTrackId, gainPoints);
+  }
+  updateKernel();
+}
+
+RenderPlan RenderPlan::remapInputTracks(const std::vector<size_t>& inputTrackIds) const {
+  RenderPlan renderPlan(_nbOutputChannels);
+  for (const size_t inputTrackId : _usedInputTrackIds) {
+    const auto position = std::find(inputTrackIds.begin(), inputTrackIds.end(), inputTrackId);
+    if(position == inputTrackIds.end()) {
+      throw std::runtime_error("Render plan input track " + std::to_string(inputTrackId) + " is missing from the remapped tracks.");
+    }
+    const size_t remappedTrackId = position - inputTrackIds.begin();
+    const size_t timelineIndex = getGainTimelineIndex(inputTrackId);
+    if(timelineIndex < _gainTimelines.size()) {
+      GainTimeline gainTimeline = _gainTimelines[timelineIndex];
+      gainTimeline.inputTrackId = remappedTrackId;
+      renderPlan._gainTimelines.push_back(gainTimeline);
+    } else {
+      renderPlan.setInputTrackGains(remappedTrackId, getTrackGains(inputTrackId, 0, false));
+    }
+  }
+  renderPlan.updateKernel();
+  return renderPlan;
+}
+
+float RenderPlan::getGain(const size_t inputTrackId, const size_t outputChannel, const uint64_t framePosition) const {
+  const bool isUsed = getInputTrackIndex(inputTrackId) < _inputTrackIds.size() || getGainTimelineIndex(inputTrackId) < _gainTimelines.size();
+  if(!isUsed || outputChannel >= _nbOutputChannels) {
+    throw std::out_of_range("No render plan gain for this input track and output channel.");
+  }
+  return getTrackGains(inputTrackId, framePosition, false)[outputChannel];
+}
+
+void RenderPlan::applyGain(const float gain) {
+  for(float& value : _gains) {
+    value *= gain;
+  }
+  for(GainTimeline& gainTimeline : _gainTimelines) {
+    for(float& value : gainTimeline.gains) {
+      value *= gain;
+    }
+    updateGainSteps(gainTimeline);
+  }
+  updateKernel();
+}
+
+void RenderPlan::applyGain(const size_t inputTrackId, const size_t outputChannel, const float gain) {
+  const size_t index = getInputTrackIndex(inputTrackId);
+  const size_t timelineIndex = getGainTimelineIndex(inputTrackId);
+  if((index == _inputTrackIds.size() && timelineIndex == _gainTimelines.size()) || outputChannel >= _nbOutputChannels) {
+    throw std::out_of_range("No render plan gain for this input track and output channel.");
+  }
+  if(index < _inputTrackIds.size()) {
+    _gains[outputChannel * _inputTrackIds.size() + index] *= gain;
+  } else {
+    GainTimeline& gainTimeline = _gainTimelines[timelineIndex];
+    const size_t gainStride = getMixingGainStride(_nbOutputChannels);
+    for (size_t p = 0; p < gainTimeline.frames.size(); ++p) {
+      gainTimeline.gains[p * gainStride + outputChannel] *= gain;
+    }
+    updateGainSteps(gainTimeline);
+  }
+  updateKernel();
+}
+
+void RenderPlan::write(std::ostream& stream) const {
+  stream.write(RENDER_PLAN_MAGIC, sizeof(RENDER_PLAN_MAGIC));
+  writeValue(stream, RENDER_PLAN_VERSION);
+  writeValue(stream, _nbOutputChannels);
+  writeValues(stream, std::vector<uint64_t>(_inputTrackIds.begin(), _inputTrackIds.end()));
+  writeValues(stream, _gains);
+  writeValue(stream, _gainTimelines.size());
+  for(const GainTimeline& gainTimeline : _gainTimelines) {
+    // padded gains are written as they are, steps are computed again
+    writeValue(stream, gainTimeline.inputTrackId);
+    writeValues(stream, gainTimeline.frames);
+    writeValues(stream, gainTimeline.gains);
+  }
+}
+
+RenderPlan RenderPlan::read(std::istream& stream) {
+  char magic[sizeof(RENDER_PLAN_MAGIC)];
+  if(!stream.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), RENDER_PLAN_MAGIC)) {
+    throw std::runtime_error("Invalid render plan header.");
+  }
+  const uint64_t version = readValue(stream);
+  if(version != RENDER_PLAN_VERSION) {
+    throw std::runtime_error("Unsupported render plan version: " + std::to_string(version));
+  }
+  RenderPlan renderPlan(readValue(stream));
+  const size_t gainStride = getMixingGainStride(renderPlan._nbOutputChannels);
+
+  const std::vector<uint64_t> inputTrackIds = readValues<uint64_t>(stream);
+  renderPlan._inputTrackIds.assign(inputTrackIds.begin(), inputTrackIds.end());
+  renderPlan._gains = readValues<float>(stream);
+  if(renderPlan._gains.size() != inputTrackIds.size() * renderPlan._nbOutputChannels) {
+    throw std::runtime_error("Invalid render plan gains.");
+  }
+
+  const uint64_t nbGainTimelines = readValue(stream);
+  for (uint64_t t = 0; t < nbGainTimelines; ++t) {
+    GainTimeline gainTimeline;
+    gainTimeline.inputTrackId = readValue(stream);
+    gainTimeline.frames = readValues<uint64_t>(stream);
+    gainTimeline.gains = readValues<float>(stream);
+    if(gainTimeline.frames.empty() || gainTimeline.gains.size() != gainTimeline.frames.size() * gainStride) {
+      throw std::runtime_error("Invalid render plan gain timeline.");
+    }
+    renderPlan.updateGainSteps(gainTimeline);
+    renderPlan._gainTimelines.push_back(gainTimeline);
+  }
+  renderPlan.updateKernel();
+  return renderPlan;
+}
+
+void RenderPlan::updateKernel() {
+  // transpose the row-major matrix, padding each input track gains with zeros
+  const size_t nbInputTracks = _inputTrackIds.size();
+  const size_t gainStride = getMixingGainStride(_nbOutputChannels);
+  _kernelGains.assign(nbInputTracks * gainStride, 0.0);
+  for (size_t i = 0; i < nbInputTracks; ++i) {
+    for (size_t oc = 0; oc < _nbOutputChannels; ++oc) {
+      _kernelGains[i * gainStride + oc] = _gains[oc * nbInputTracks + i];
+    }
+  }
+  _kernel = getMixingKernel(_nbOutputChannels);
+  _rampKernel = getRampMixingKernel();
+
+  _usedInputTrackIds = _inputTrackIds;
+  for(const GainTimeline& gainTimeline : _gainTimelines) {
+    _usedInputTrackIds.push_back(gainTimeline.inputTrackId);
+  }
+}
+
+void RenderPlan::process(const uint64_t framePosition,
+                         const size_t nbFrames,
+                         const float* input,
+                         const size_t inputNbChannels,
+                         float* output,
+                         const bool accumulate) const {
+  // constant gains first (which also clears the output block if there is no other track)
+  bool overwrite = !accumulate;
+  if(!_inputTrackIds.empty() || _gainTimelines.empty()) {
+    _kernel(nbFrames, input, inputNbChannels,
+            _inputTrackIds.data(), _inputTrackIds.size(),
+            _kernelGains.data(), getMixingGainStride(_nbOutputChannels),
+            output, _nbOutputChannels, accumulate);
+    overwrite = false;
+  }
+
+  // then time-varying gains, by groups of tracks mixed together over the frames where all their gains are linear
+  const size_t gainStride = getMixingGainStride(_nbOutputChannels);
+  const uint64_t lastFrame = framePosition + nbFrames;
+  for (size_t firstTimeline = 0; firstTimeline < _gainTimelines.size(); firstTimeline += RAMP_TRACK_GROUP_SIZE) {
+    const size_t nbTracks = std::min(RAMP_TRACK_GROUP_SIZE, _gainTimelines.size() - firstTimeline);
+    size_t inputTrackIds[RAMP_TRACK_GROUP_SIZE];
+    size_t points[RAMP_TRACK_GROUP_SIZE];
+    const float* gains[RAMP_TRACK_GROUP_SIZE];
+    const float* gainSteps[RAMP_TRACK_GROUP_SIZE];
+    size_t rampPositions[RAMP_TRACK_GROUP_SIZE];
+    for (size_t i = 0; i < nbTracks; ++i) {
+      const std::vector<uint64_t>& frames = _gainTimelines[firstTimeline + i].frames;
+      inputTrackIds[i] = _gainTimelines[firstTimeline + i].inputTrackId;
+      points[i] = (std::upper_bound(frames.begin(), frames.end(), framePosition) - frames.begin()) - 1;
+    }
+
+    uint64_t frame = framePosition;
+    while(frame < lastFrame) {
+      uint64_t rampEnd = lastFrame;
+      for (size_t i = 0; i < nbTracks; ++i) {
+        const GainTimeline& gainTimeline = _gainTimelines[firstTimeline + i];
+        const size_t p = points[i];
+        if(p + 1 < gainTimeline.frames.size()) {
+          rampEnd = std::min(rampEnd, gainTimeline.frames[p + 1]);
+        }
+        gains[i] = gainTimeline.gains.data() + p * gainStride;
+        gainSteps[i] = gainTimeline.gainSteps.data() + p * gainStride;
+        rampPositions[i] = frame - gainTimeline.frames[p];
+      }
+
+      const size_t blockOffset = frame - framePosition;
+      _rampKernel(rampEnd - frame,
+                  input + blockOffset * inputNbChannels, inputNbChannels,
+                  inputTrackIds, nbTracks,
+                  gains, gainSteps, rampPositions,
+                  output + blockOffset * _nbOutputChannels, _nbOutputChannels,
+                  !overwrite);
+      frame = rampEnd;
+
+      // move each track to the last point reached (past any jump)
+      for (size_t i = 0; i < nbTracks; ++i) {
+        const std::vector<uint64_t>& frames = _gainTimelines[firstTimeline + i].frames;
+        while(points[i] + 1 < frames.size() && frames[points[i] + 1] <= frame) {
+          ++points[i];
+        }
+      }
+    }
+    // every segment of the first group overwrites its frames, the next groups add onto them
+    overwrite = false;
+  }
+}
+
+}
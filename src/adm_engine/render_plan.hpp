@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+#include "mixing_kernels.hpp"
+
+namespace admengine {
+
+/// Version of the serialised render plans and of the gains they hold, to be increased whenever either one changes
+const uint64_t RENDER_PLAN_VERSION = 2;
+
+/// Gains of an input track (one per output channel), reached at a frame position
+struct GainPoint {
+  uint64_t frame;
+  std::vector<float> gains;
+};
+
+/**
+ * Dense mixing matrix compiled from ADM rendering gains.
+ *
+ * Gains are stored contiguously in row-major order (output channels x used input tracks),
+ * next to the compact list of the input track indexes they apply to, so that a whole block
+ * of interleaved frames can be mixed without any lookup. Blocks are mixed by the vectorised
+ * kernel selected for the running CPU and the number of output channels.
+ *
+ * Input tracks with time-varying gains (as for Objects) get a gain timeline instead: gains are
+ * only known at some points, and ramp linearly from one point to the next. Each block is mixed
+ * by the ramp kernel, over the ramps it overlaps, so that gains are exact at any frame position.
+ */
+class RenderPlan {
+
+public:
+  RenderPlan(const size_t nbOutputChannels = 0);
+
+  void setInputTrackGains(const size_t inputTrackId, const std::vector<float>& gains);
+  /// Set time-varying gains, from points sorted by frame (two points at the same frame make a jump).
+  /// Gains are held before the first point and after the last one.
+  void setInputTrackGains(const size_t inputTrackId, const std::vector<GainPoint>& gainPoints);
+  void merge(const RenderPlan& renderPlan);
+  /// Same plan, mixing blocks that only hold the given input tracks (in that order)
+  RenderPlan remapInputTracks(const std::vector<size_t>& inputTrackIds) const;
+
+  float getGain(const size_t inputTrackId, const size_t outputChannel, const uint64_t framePosition = 0) const;
+  void applyGain(const float gain);
+  void applyGain(const size_t inputTrackId, const size_t outputChannel, const float gain);
+
+  const std::vector<size_t>& getInputTrackIds() const { return _usedInputTrackIds; }
+  size_t getNbInputTracks() const { return _usedInputTrackIds.size(); }
+  size_t getNbOutputChannels() const { return _nbOutputChannels; }
+  bool empty() const { return _usedInputTrackIds.empty(); }
+  /// Whether gains are constant over the whole rendering (as for DirectSpeakers)
+  bool isStatic() const { return _gainTimelines.empty(); }
+
+  /// Serialise the plan gains (see RenderPlanCache), to be read back identically
+  void write(std::ostream& stream) const;
+  static RenderPlan read(std::istream& stream);
+
+  /// Mix the input block starting at the given frame position into the output block, or overwrite it unless accumulate is set
+  void process(const uint64_t framePosition,
+               const size_t nbFrames,
+               const float* input,
+               const size_t inputNbChannels,
+               float* output,
+               const bool accumulate = true) const;
+
+private:
+  /// Piecewise-linear gains of an input track
+  struct GainTimeline {
+    size_t inputTrackId;
+    /// Point frames, in increasing order and starting at 0 (two equal frames make a jump)
+    std::vector<uint64_t> frames;
+    /// Gains of each point, padded to the kernel gain stride
+    std::vector<float> gains;
+    /// Gain increment per frame, from each point to the next one (zero after the last one)
+    std::vector<float> gainSteps;
+  };
+
+  size_t getInputTrackIndex(const size_t inputTrackId) const;
+  size_t getGainTimelineIndex(const size_t inputTrackId) const;
+  size_t addInputTrack(const size_t inputTrackId);
+  void removeInputTrack(const size_t inputTrackId);
+  void setGainTimeline(const size_t inputTrackId, const std::vector<GainPoint>& gainPoints);
+  std::vector<float> getTrackGains(const size_t inputTrackId, const uint64_t framePosition, const bool beforeJump) const;
+  std::vector<uint64_t> getTrackGainFrames(const size_t inputTrackId) const;
+  void updateGainSteps(GainTimeline& gainTimeline) const;
+  void updateKernel();
+
+private:
+  size_t _nbOutputChannels;
+  /// Index of used input channels with constant gains
+  std::vector<size_t> _inputTrackIds;
+  /// Constant gains by output channel (rows) and used input channel (columns)
+  std::vector<float> _gains;
+  /// Same gains, packed by used input channel for the mixing kernel (see getMixingGainStride)
+  std::vector<float> _kernelGains;
+  /// Input channels with time-varying gains
+  std::vector<GainTimeline> _gainTimelines;
+  /// Index of all used input channels: constant ones, then time-varying ones
+  std::vector<size_t> _usedInputTrackIds;
+  MixingKernel _kernel;
+  RampMixingKernel _rampKernel;
+};
+
+}
@@ -0,0 +1,109 @@
+#include "render_plan_cache.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
+
+namespace admengine {
+
+std::string hashData(const std::string& data) {
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for(const char c : data) {
+    hash ^= (uint8_t)c;
+    hash *= 0x100000001b3ull;
+  }
+  char hexHash[17];
+  std::snprintf(hexHash, sizeof(hexHash), "%016llx", (unsigned long long)hash);
+  return hexHash;
+}
+
+RenderPlanCache::RenderPlanCache(const std::string& directory, const size_t capacity)
+  : _directory(directory)
+  , _capacity(capacity)
+{
+}
+
+std::string RenderPlanCache::getKey(const std::string& documentHash, const uint32_t sampleRate, const std::string& layoutName, const std::string& elementId) {
+  // block timings are converted into frames, at the sample rate
+  return documentHash + "-" + hashData(std::to_string(RENDER_PLAN_VERSION) + "\n" + std::to_string(sampleRate) + "\n" + layoutName + "\n" + elementId);
+}
+
+std::string RenderPlanCache::getFilePath(const std::string& key) const {
+  std::string filePath = _directory;
+  if(filePath.back() != '/' && filePath.back() != '\\') {
+    filePath += "/";
+  }
+  return filePath + key + ".plan";
+}
+
+bool RenderPlanCache::get(const std::string& key, RenderPlan& renderPlan) {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    const auto cachedPlan = _renderPlans.find(key);
+    if(cachedPlan != _renderPlans.end()) {
+      renderPlan = cachedPlan->second;
+      return true;
+    }
+  }
+  if(_directory.empty()) {
+    return false;
+  }
+
+  std::ifstream file(getFilePath(key), std::ios::binary);
+  if(!file) {
+    return false;
+  }
+  try {
+    renderPlan = RenderPlan::read(file);
+  } catch(const std::exception& e) {
+    std::cout << "[WARNING] Ignore cached render plan " << getFilePath(key) << ": " << e.what() << std::endl;
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(_mutex);
+  putInMemory(key, renderPlan);
+  return true;
+}
+
+void RenderPlanCache::put(const std::string& key, const RenderPlan& renderPlan) {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    putInMemory(key, renderPlan);
+  }
+  if(_directory.empty()) {
+    return;
+  }
+
+  // written aside then renamed, so that concurrent readers never get a partial plan (the name being unique among processes and threads)
+  std::stringstream temporaryFilePath;
+  temporaryFilePath << getFilePath(key) << "." << getpid() << "." << std::this_thread::get_id() << ".tmp";
+  {
+    std::ofstream file(temporaryFilePath.str(), std::ios::binary);
+    renderPlan.write(file);
+    if(!file) {
+      std::cout << "[WARNING] Could not write render plan cache file: " << temporaryFilePath.str() << std::endl;
+      std::remove(temporaryFilePath.str().c_str());
+      return;
+    }
+  }
+  if(std::rename(temporaryFilePath.str().c_str(), getFilePath(key).c_str()) != 0) {
+    std::cout << "[WARNING] Could not write render plan cache file: " << getFilePath(key) << std::endl;
+    std::remove(temporaryFilePath.str().c_str());
+  }
+}
+
+void RenderPlanCache::putInMemory(const std::string& key, const RenderPlan& renderPlan) {
+  if(_renderPlans.find(key) == _renderPlans.end()) {
+    _keys.push_back(key);
+  }
+  _renderPlans[key] = renderPlan;
+  while(_keys.size() > _capacity) {
+    _renderPlans.erase(_keys.front());
+    _keys.pop_front();
+  }
+}
+
+}
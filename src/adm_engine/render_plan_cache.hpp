@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "render_plan.hpp"
+
+namespace admengine {
+
+const size_t DEFAULT_RENDER_PLAN_CACHE_CAPACITY = 1024; // in render plans
+
+/// 64-bit FNV-1a hash of the given data, as 16 hexadecimal digits
+std::string hashData(const std::string& data);
+
+/**
+ * Cache of the render plans computed for the elements of ADM documents, so that rendering the same
+ * content again (e.g. with other user gains) does not compute any gain again.
+ *
+ * Plans are kept in memory (the oldest ones being dropped beyond the capacity), and also stored as
+ * files into the cache directory if any, to be shared between processes. Cached plans must not hold
+ * user gains, that are applied to them once they are loaded. The cache is thread-safe.
+ */
+class RenderPlanCache {
+
+public:
+  RenderPlanCache(const std::string& directory = "", const size_t capacity = DEFAULT_RENDER_PLAN_CACHE_CAPACITY);
+  RenderPlanCache(const RenderPlanCache&) = delete;
+  RenderPlanCache& operator=(const RenderPlanCache&) = delete;
+
+  /// Key of the plan of an element, rendered from an ADM document (identified by the hash of its chunks) at a sample rate
+  /// to a layout, by the current plan version
+  static std::string getKey(const std::string& documentHash, const uint32_t sampleRate, const std::string& layoutName, const std::string& elementId);
+
+  const std::string& getDirectory() const { return _directory; }
+
+  /// Get the plan cached under the key, from memory or from the cache directory
+  bool get(const std::string& key, RenderPlan& renderPlan);
+  void put(const std::string& key, const RenderPlan& renderPlan);
+
+private:
+  std::string getFilePath(const std::string& key) const;
+  void putInMemory(const std::string& key, const RenderPlan& renderPlan);
+
+private:
+  const std::string _directory;
+  const size_t _capacity;
+  std::mutex _mutex;
+  std::map<std::string, RenderPlan> _renderPlans;
+  /// Keys of the plans kept in memory, from the oldest one
+  std::deque<std::string> _keys;
+};
+
+}
@@ -4,25 +4,189 @@
 #include "parser.hpp"
 #include "utils.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <thread>
+
 namespace admengine {
 
+namespace {
+
+std::vector<ear::Layout> getLayouts(const std::vector<std::string>& outputLayouts) {
+  if(outputLayouts.empty()) {
+    throw std::runtime_error("At least one output layout must be specified.");
+  }
+  std::vector<ear::Layout> layouts;
+  for(const std::string& outputLayout : outputLayouts) {
+    layouts.push_back(getOutputLayout(outputLayout));
+  }
+  return layouts;
+}
+
+}
+
+const ear::Layout& getOutputLayout(const std::string& outputLayout) {
+  // layouts are built once per process, and shared by the following renderers (e.g. of a batch)
+  static std::mutex mutex;
+  static std::map<std::string, ear::Layout> layouts;
+  std::lock_guard<std::mutex> lock(mutex);
+  auto layout = layouts.find(outputLayout);
+  if(layout == layouts.end()) {
+    layout = layouts.emplace(outputLayout, ear::getLayout(outputLayout)).first;
+  }
+  return layout->second;
+}
+
 Renderer::Renderer(const std::unique_ptr<bw64::Bw64Reader>& inputFile,
-           const std::string& outputLayout,
+           const std::vector<std::string>& outputLayouts,
            const std::string& outputDirectory,
            const std::map<std::string, float> elementGains,
            const std::string& elementIdToRender)
-  : _inputFile(inputFile)
+  : _inputFile(inputFile.get())
+  , _inputStream(nullptr)
   , _inputNbChannels(inputFile->channels())
-  , _outputLayout(ear::getLayout(outputLayout))
+  , _sampleRate(inputFile->sampleRate())
+  , _inputBitDepth(inputFile->bitDepth())
+  , _outputLayouts(getLayouts(outputLayouts))
   , _outputDirectory(outputDirectory)
   , _elementGainsMap(elementGains)
   , _elementIdToRender(elementIdToRender)
+  , _nbCachedRenderPlans(0)
+  , _nbComputedRenderPlans(0)
+  , _blockSize(BLOCK_SIZE)
+  , _queueDepth(DEFAULT_QUEUE_DEPTH)
+  , _timeSharding(false)
+  , _outputFileDescriptor(-1)
+  , _outputFormat(OutputFormat::Bw64)
 {
-  _admDocument = getAdmDocument(parseAdmXmlChunk(_inputFile));
-  _chnaChunk = parseAdmChnaChunk(_inputFile);
+  // chunks are parsed once, and shared by the renderers and the outputs
+  _axmlChunk = parseAdmXmlChunk(inputFile);
+  _chnaChunk = parseAdmChnaChunk(inputFile);
+  initDocument();
+}
+
+Renderer::Renderer(Bw64StreamReader& inputStream,
+                   const std::vector<std::string>& outputLayouts,
+                   const std::string& outputDirectory,
+                   const std::map<std::string, float> elementGains,
+                   const std::string& elementIdToRender)
+  : _inputFile(nullptr)
+  , _inputStream(&inputStream)
+  , _inputNbChannels(inputStream.channels())
+  , _sampleRate(inputStream.sampleRate())
+  , _inputBitDepth(inputStream.bitDepth())
+  , _outputLayouts(getLayouts(outputLayouts))
+  , _outputDirectory(outputDirectory)
+  , _elementGainsMap(elementGains)
+  , _elementIdToRender(elementIdToRender)
+  , _axmlChunk(inputStream.axmlChunk())
+  , _chnaChunk(inputStream.chnaChunk())
+  , _nbCachedRenderPlans(0)
+  , _nbComputedRenderPlans(0)
+  , _blockSize(BLOCK_SIZE)
+  , _queueDepth(DEFAULT_QUEUE_DEPTH)
+  , _timeSharding(false)
+  , _outputFileDescriptor(-1)
+  , _outputFormat(OutputFormat::Bw64)
+{
+  // the stream header chunks are already read, up to the audio data
+  initDocument();
+}
+
+Renderer::Renderer(const std::shared_ptr<bw64::AxmlChunk>& axmlChunk,
+                   const std::shared_ptr<bw64::ChnaChunk>& chnaChunk,
+                   const uint16_t nbInputChannels,
+                   const uint32_t sampleRate,
+                   const std::vector<std::string>& outputLayouts,
+                   const std::map<std::string, float> elementGains,
+                   const std::string& elementIdToRender)
+  : _inputFile(nullptr)
+  , _inputStream(nullptr)
+  , _inputNbChannels(nbInputChannels)
+  , _sampleRate(sampleRate)
+  , _inputBitDepth(0)
+  , _outputLayouts(getLayouts(outputLayouts))
+  , _elementGainsMap(elementGains)
+  , _elementIdToRender(elementIdToRender)
+  , _axmlChunk(axmlChunk)
+  , _chnaChunk(chnaChunk)
+  , _nbCachedRenderPlans(0)
+  , _nbComputedRenderPlans(0)
+  , _blockSize(BLOCK_SIZE)
+  , _queueDepth(DEFAULT_QUEUE_DEPTH)
+  , _timeSharding(false)
+  , _outputFileDescriptor(-1)
+  , _outputFormat(OutputFormat::Bw64)
+{
+  if(!_axmlChunk) {
+    throw std::runtime_error("In-memory content cannot be rendered without any 'axml' chunk.");
+  }
+  initDocument();
+}
+
+void Renderer::initDocument() {
+  // when a single element is rendered, the elements it does not depend on are not even parsed
+  _admDocument = _elementIdToRender.empty() ? getAdmDocument(_axmlChunk) : getAdmDocument(_axmlChunk, _elementIdToRender);
+  _timelineIndex.reset(new TimelineIndex(_admDocument, _sampleRate));
+}
+
+void Renderer::setNbThreads(const size_t nbThreads) {
+  _threadPool.reset(nbThreads > 1 ? new ThreadPool(nbThreads) : nullptr);
+}
+
+void Renderer::setBlockSize(const size_t blockSize) {
+  if(blockSize == 0) {
+    throw std::runtime_error("Rendering block size must not be null.");
+  }
+  _blockSize = blockSize;
+}
+
+void Renderer::setQueueDepth(const size_t queueDepth) {
+  _queueDepth = queueDepth;
+}
+
+void Renderer::setInputFilePath(const std::string& inputFilePath, const bool memoryMapped) {
+  try {
+    _inputFileReader.reset(new Bw64FileReader(inputFilePath, memoryMapped));
+  } catch(const std::exception& e) {
+    std::cout << "[WARNING] " << e.what() << " Fall back to decoding all input tracks." << std::endl;
+    _inputFileReader.reset();
+  }
+}
+
+void Renderer::enableTimeSharding() {
+  _timeSharding = true;
+}
+
+void Renderer::setOutputStream(const int fileDescriptor, const OutputFormat format) {
+  _outputFileDescriptor = fileDescriptor;
+  _outputFormat = format;
+}
+
+void Renderer::setProgressCallback(const ProgressCallback& progressCallback) {
+  _progressCallback = progressCallback;
+}
+
+void Renderer::setRenderPlanCache(const std::shared_ptr<RenderPlanCache>& renderPlanCache) {
+  _renderPlanCache = renderPlanCache;
+  if(_renderPlanCache && _documentHash.empty()) {
+    // plans only depend on the ADM metadata, and on the tracks it is bound to (the axml data being hashed in place)
+    std::stringstream admChunks;
+    admChunks << hashData(_axmlChunk->data());
+    if(_chnaChunk) {
+      _chnaChunk->write(admChunks);
+    }
+    _documentHash = hashData(admChunks.str());
+  }
 }
 
 void Renderer::process() {
+  if(!_inputFile && !_inputStream) {
+    throw std::runtime_error("Rendering to files needs an input file or stream, in-memory content is rendered by blocks.");
+  }
   // if the user selected an item ID to render, find it and render
   if(!_elementIdToRender.empty()) {
     for(auto audioProgramme : getDocumentAudioProgrammes()) {
@@ -47,23 +211,42 @@ void Renderer::process() {
   }
 
   // otherwise select items to render, based on Rec. ITU-R  BS.2127-0, 5.2 Determination of Rendering Items (Fig. 3)
+  // all render plans are built up front, so that the input is read only once
+  std::vector<RenderOutput> outputs;
   auto audioProgrammes = getDocumentAudioProgrammes();
   if(audioProgrammes.size()) {
+    // elements of the same name would be written to the same output file
+    std::map<std::string, size_t> nbProgrammesByName;
+    for(auto audioProgramme : audioProgrammes) {
+      ++nbProgrammesByName[getOutputName(audioProgramme->get<adm::AudioProgrammeName>().get())];
+    }
     for(auto audioProgramme : audioProgrammes) {
       std::cout << "### Render audio programme: " << toString(audioProgramme) << std::endl;
       initAudioProgrammeRendering(audioProgramme);
-      processAudioProgramme(audioProgramme);
+      const bool isNameShared = nbProgrammesByName[getOutputName(audioProgramme->get<adm::AudioProgrammeName>().get())] > 1;
+      for (size_t layoutIndex = 0; layoutIndex < _outputLayouts.size(); ++layoutIndex) {
+        outputs.push_back(createRenderOutput(audioProgramme, layoutIndex, isNameShared));
+      }
     }
+    render(outputs);
     return;
   }
 
   auto audioObjects = getDocumentAudioObjects();
   if(audioObjects.size()) {
+    std::map<std::string, size_t> nbObjectsByName;
+    for(auto audioObject : audioObjects) {
+      ++nbObjectsByName[getOutputName(audioObject->get<adm::AudioObjectName>().get())];
+    }
     for(auto audioObject : audioObjects) {
       std::cout << "### Render audio object: " << toString(audioObject) << std::endl;
       initAudioObjectRendering(audioObject);
-      processAudioObject(audioObject);
+      const bool isNameShared = nbObjectsByName[getOutputName(audioObject->get<adm::AudioObjectName>().get())] > 1;
+      for (size_t layoutIndex = 0; layoutIndex < _outputLayouts.size(); ++layoutIndex) {
+        outputs.push_back(createRenderOutput(audioObject, layoutIndex, isNameShared));
+      }
     }
+    render(outputs);
     return;
   }
 
@@ -93,61 +276,133 @@ std::vector<std::shared_ptr<adm::AudioObject>> Renderer::getDocumentAudioObjects
 }
 
 std::shared_ptr<bw64::AxmlChunk> Renderer::getAdmXmlChunk() const {
-  return parseAdmXmlChunk(_inputFile);
+  return _axmlChunk;
 }
 
 std::shared_ptr<bw64::ChnaChunk> Renderer::getAdmChnaChunk() const {
-  return parseAdmChnaChunk(_inputFile);
+  return _chnaChunk;
 }
 
 void Renderer::initAudioProgrammeRendering(const std::shared_ptr<adm::AudioProgramme>& audioProgramme) {
+  const auto start = std::chrono::steady_clock::now();
+  // one set of renderers per output layout
   _renderers.clear();
+  _renderers.resize(_outputLayouts.size());
+  _nbCachedRenderPlans = 0;
+  _nbComputedRenderPlans = 0;
   const float audioProgrammeGain = getElementGain(formatId(audioProgramme->get<adm::AudioProgrammeId>()));
   for(const std::shared_ptr<adm::AudioContent> audioContent : getAudioContents(audioProgramme)) {
     const float audioContentGain = audioProgrammeGain * getElementGain(formatId(audioContent->get<adm::AudioContentId>()));
     for(const std::shared_ptr<adm::AudioObject> audioObject : getAudioObjects(audioContent)) {
-      AudioObjectRenderer renderer(_outputLayout, audioObject, _chnaChunk);
       const float audioObjectGain = audioContentGain * getElementGain(formatId(audioObject->get<adm::AudioObjectId>()));
-      renderer.applyUserGain(audioObjectGain);
-      std::cout << " >> Add renderer: " << renderer << std::endl;
-      _renderers.push_back(renderer);
+      addAudioObjectRenderers(audioObject, audioObjectGain);
     }
   }
+  compileRenderPlans();
+  displayRenderPlansInitialisation(start);
 }
 
 void Renderer::initAudioObjectRendering(const std::shared_ptr<adm::AudioObject>& audioObject) {
+  const auto start = std::chrono::steady_clock::now();
   _renderers.clear();
-  AudioObjectRenderer renderer(_outputLayout, audioObject, _chnaChunk);
-  const float audioObjectGain = getElementGain(formatId(audioObject->get<adm::AudioObjectId>()));
-  renderer.applyUserGain(audioObjectGain);
-  std::cout << " >> Add renderer: " << renderer << std::endl;
-  _renderers.push_back(renderer);
+  _renderers.resize(_outputLayouts.size());
+  _nbCachedRenderPlans = 0;
+  _nbComputedRenderPlans = 0;
+  addAudioObjectRenderers(audioObject, getElementGain(formatId(audioObject->get<adm::AudioObjectId>())));
+  compileRenderPlans();
+  displayRenderPlansInitialisation(start);
 }
 
+void Renderer::displayRenderPlansInitialisation(const std::chrono::steady_clock::time_point& start) const {
+  typedef std::chrono::duration<double, std::milli> Milliseconds;
+  std::cout << " >> Render plans: " << _nbCachedRenderPlans << " loaded from cache, " << _nbComputedRenderPlans << " computed, in "
+            << Milliseconds(std::chrono::steady_clock::now() - start).count() << " ms" << std::endl;
+}
 
-void Renderer::processAudioProgramme(const std::shared_ptr<adm::AudioProgramme>& audioProgramme) {
-  // Create output programme ADM
-  std::shared_ptr<adm::Document> document = createAdmDocument(audioProgramme, _outputLayout);
-  std::shared_ptr<bw64::AxmlChunk> axml = createAxmlChunk(document);
-  std::shared_ptr<bw64::ChnaChunk> chna = createChnaChunk(document);
+AudioObjectRenderer Renderer::createAudioObjectRenderer(const size_t layoutIndex, const std::shared_ptr<adm::AudioObject>& audioObject) {
+  const ear::Layout& outputLayout = _outputLayouts[layoutIndex];
+  if(!_renderPlanCache) {
+    ++_nbComputedRenderPlans;
+    return AudioObjectRenderer(outputLayout, audioObject, _chnaChunk, *_timelineIndex);
+  }
 
-  // Output file
-  std::stringstream outputFileName;
-  outputFileName << _outputDirectory;
-  if(_outputDirectory.back() != std::string(PATH_SEPARATOR).back()) {
-    outputFileName << PATH_SEPARATOR;
+  // cached plans are the ones of objects, before any user gain, that is a mere scaling of them
+  const std::string cacheKey = RenderPlanCache::getKey(_documentHash, _sampleRate, outputLayout.name(), formatId(audioObject->get<adm::AudioObjectId>()));
+  RenderPlan renderPlan;
+  if(_renderPlanCache->get(cacheKey, renderPlan)) {
+    ++_nbCachedRenderPlans;
+    return AudioObjectRenderer(outputLayout, audioObject, _chnaChunk, *_timelineIndex, renderPlan);
+  }
+  ++_nbComputedRenderPlans;
+  AudioObjectRenderer renderer(outputLayout, audioObject, _chnaChunk, *_timelineIndex);
+  _renderPlanCache->put(cacheKey, renderer.getRenderPlan());
+  return renderer;
+}
+
+void Renderer::addAudioObjectRenderers(const std::shared_ptr<adm::AudioObject>& audioObject, const float gain) {
+  for (size_t layoutIndex = 0; layoutIndex < _outputLayouts.size(); ++layoutIndex) {
+    AudioObjectRenderer renderer = createAudioObjectRenderer(layoutIndex, audioObject);
+    renderer.applyUserGain(gain);
+    std::cout << " >> Add renderer (" << _outputLayouts[layoutIndex].name() << "): " << renderer << std::endl;
+    _renderers[layoutIndex].push_back(renderer);
   }
-  outputFileName << replaceSpecialCharacters(audioProgramme->get<adm::AudioProgrammeName>().get()) << ".wav";
-  std::unique_ptr<bw64::Bw64Writer> outputFile =
-    bw64::writeFile(outputFileName.str(), _outputLayout.channels().size(), _inputFile->sampleRate(), _inputFile->bitDepth(), chna, axml);
+}
 
-  toFile(outputFile);
-  std::cout << " >> Done: " << outputFileName.str() << std::endl;
+void Renderer::compileRenderPlans() {
+  _renderPlans.clear();
+  for (size_t layoutIndex = 0; layoutIndex < _outputLayouts.size(); ++layoutIndex) {
+    RenderPlan renderPlan(getNbOutputChannels(layoutIndex));
+    for(const AudioObjectRenderer& renderer : _renderers[layoutIndex]) {
+      renderPlan.merge(renderer.getRenderPlan());
+    }
+    _renderPlans.push_back(renderPlan);
+  }
+}
+
+
+void Renderer::processAudioProgramme(const std::shared_ptr<adm::AudioProgramme>& audioProgramme) {
+  std::vector<RenderOutput> outputs;
+  for (size_t layoutIndex = 0; layoutIndex < _outputLayouts.size(); ++layoutIndex) {
+    outputs.push_back(createRenderOutput(audioProgramme, layoutIndex));
+  }
+  render(outputs);
 }
 
 void Renderer::processAudioObject(const std::shared_ptr<adm::AudioObject>& audioObject) {
+  std::vector<RenderOutput> outputs;
+  for (size_t layoutIndex = 0; layoutIndex < _outputLayouts.size(); ++layoutIndex) {
+    outputs.push_back(createRenderOutput(audioObject, layoutIndex));
+  }
+  render(outputs);
+}
+
+std::string Renderer::getOutputName(const std::string& elementName) {
+  // file names only keep portable characters
+  std::string outputName = elementName;
+  return replaceSpecialCharacters(outputName);
+}
+
+RenderOutput Renderer::createRenderOutput(const std::shared_ptr<adm::AudioProgramme>& audioProgramme, const size_t layoutIndex, const bool isNameShared) {
   // Create output programme ADM
-  std::shared_ptr<adm::Document> document = createAdmDocument(audioObject, _outputLayout);
+  std::shared_ptr<adm::Document> document = createAdmDocument(audioProgramme, _outputLayouts[layoutIndex]);
+  std::string outputName = audioProgramme->get<adm::AudioProgrammeName>().get();
+  if(isNameShared) {
+    outputName += "_" + formatId(audioProgramme->get<adm::AudioProgrammeId>());
+  }
+  return createRenderOutput(outputName, document, layoutIndex);
+}
+
+RenderOutput Renderer::createRenderOutput(const std::shared_ptr<adm::AudioObject>& audioObject, const size_t layoutIndex, const bool isNameShared) {
+  // Create output object ADM
+  std::shared_ptr<adm::Document> document = createAdmDocument(audioObject, _outputLayouts[layoutIndex]);
+  std::string outputName = audioObject->get<adm::AudioObjectName>().get();
+  if(isNameShared) {
+    outputName += "_" + formatId(audioObject->get<adm::AudioObjectId>());
+  }
+  return createRenderOutput(outputName, document, layoutIndex);
+}
+
+RenderOutput Renderer::createRenderOutput(const std::string& elementName, const std::shared_ptr<adm::Document>& document, const size_t layoutIndex) {
   std::shared_ptr<bw64::AxmlChunk> axml = createAxmlChunk(document);
   std::shared_ptr<bw64::ChnaChunk> chna = createChnaChunk(document);
 
@@ -157,55 +412,345 @@ void Renderer::processAudioObject(const std::shared_ptr<adm::AudioObject>& audio
   if(_outputDirectory.back() != std::string(PATH_SEPARATOR).back()) {
     outputFileName << PATH_SEPARATOR;
   }
-  outputFileName << replaceSpecialCharacters(audioObject->get<adm::AudioObjectName>().get()) << ".wav";
-  std::unique_ptr<bw64::Bw64Writer> outputFile =
-    bw64::writeFile(outputFileName.str(), _outputLayout.channels().size(), _inputFile->sampleRate(), _inputFile->bitDepth(), chna, axml);
+  std::string outputName = elementName;
+  if(_outputLayouts.size() > 1) {
+    // outputs of the same element are told apart by their layout
+    outputName += "_" + _outputLayouts[layoutIndex].name();
+  }
+  outputFileName << getOutputName(outputName) << ".wav";
+
+  RenderOutput output;
+  output.renderPlan = _renderPlans[layoutIndex];
+  output.outputFilePath = outputFileName.str();
+  output.axmlChunk = axml;
+  output.chnaChunk = chna;
+  return output;
+}
+
+void Renderer::render(std::vector<RenderOutput>& outputs) {
+  selectInputTracks(outputs);
+  if(!_timeSharding) {
+    toFiles(outputs);
+    return;
+  }
+  if(!_threadPool) {
+    std::cout << "[WARNING] Time shards need several rendering threads, fall back to sequential rendering." << std::endl;
+    toFiles(outputs);
+    return;
+  }
+  if(_outputFileDescriptor >= 0) {
+    std::cout << "[WARNING] Time shards cannot be streamed in order, fall back to sequential rendering." << std::endl;
+    toFiles(outputs);
+    return;
+  }
+  // time shards read the input concurrently, through the positional reader
+  if(!_inputFileReader) {
+    std::cout << "[WARNING] Time shards need the input file path, fall back to sequential rendering." << std::endl;
+    toFiles(outputs);
+    return;
+  }
+  // gain timelines are evaluated at the frame position of each block, hence shards are independent
+  toFilesInShards(outputs);
+}
 
-  toFile(outputFile);
-  std::cout << " >> Done: " << outputFileName.str() << std::endl;
+void Renderer::selectInputTracks(std::vector<RenderOutput>& outputs) {
+  _readTrackIds.clear();
+  if(!_inputFileReader && !_inputStream) {
+    return;
+  }
+  // decode the union of the tracks used by all outputs, and mix them from that compact block
+  std::set<size_t> trackIds;
+  for(const RenderOutput& output : outputs) {
+    trackIds.insert(output.renderPlan.getInputTrackIds().begin(), output.renderPlan.getInputTrackIds().end());
+  }
+  _readTrackIds.assign(trackIds.begin(), trackIds.end());
+  for(RenderOutput& output : outputs) {
+    output.renderPlan = output.renderPlan.remapInputTracks(_readTrackIds);
+  }
+  std::cout << " >> Read " << _readTrackIds.size() << " of " << _inputNbChannels << " input tracks" << std::endl;
 }
 
-size_t Renderer::processBlock(const size_t nbFrames, const float* input, float* output) const {
-  const size_t outputNbChannels = _outputLayout.channels().size();
-  size_t frame = 0;
-  size_t read = 0;
-  size_t written = 0;
+size_t Renderer::getNbReadChannels() const {
+  return (_inputFileReader || _inputStream) ? _readTrackIds.size() : _inputNbChannels;
+}
+
+uint64_t Renderer::readInputBlock(const uint64_t framePosition, float* buffer, const size_t nbFrames) {
+  if(_inputFileReader) {
+    return _inputFileReader->read(framePosition, buffer, nbFrames, _readTrackIds);
+  }
+  if(_inputStream) {
+    // blocks are read in order, hence the stream position is the frame position
+    return _inputStream->read(buffer, nbFrames, _readTrackIds);
+  }
+  // the BW64 reader decodes all the tracks, sequentially
+  return _inputFile->read(buffer, nbFrames);
+}
 
-  while(frame < nbFrames) {
-    float* ocframe = &output[written];
-    const float* icframe = &input[read];
-    for(AudioObjectRenderer renderer : _renderers) {
-      renderer.renderAudioFrame(icframe, ocframe);
+size_t Renderer::processBlock(const uint64_t framePosition, const size_t nbFrames, const float* input, float* output, const size_t layoutIndex, const bool accumulate) const {
+  _renderPlans.at(layoutIndex).process(framePosition, nbFrames, input, _inputNbChannels, output, accumulate);
+  return nbFrames * _renderPlans[layoutIndex].getNbOutputChannels();
+}
+
+void Renderer::reportProgress(const uint64_t nbRenderedFrames) {
+  if(_progressCallback) {
+    std::lock_guard<std::mutex> lock(_progressMutex);
+    _progressCallback(nbRenderedFrames, getNbInputFrames());
+  }
+}
+
+uint64_t Renderer::getNbInputFrames() const {
+  if(_inputFileReader) {
+    return _inputFileReader->numberOfFrames();
+  }
+  // a stream may not tell its length
+  return _inputStream ? _inputStream->numberOfFrames() : _inputFile->numberOfFrames();
+}
+
+size_t Renderer::getMaxNbOutputChannels() const {
+  size_t nbOutputChannels = 0;
+  for (size_t layoutIndex = 0; layoutIndex < _outputLayouts.size(); ++layoutIndex) {
+    nbOutputChannels = std::max(nbOutputChannels, getNbOutputChannels(layoutIndex));
+  }
+  return nbOutputChannels;
+}
+
+Renderer::BlockBuffers Renderer::getBlockBuffers(const size_t slot, const size_t nbInputChannels, const size_t nbOutputs) {
+  // pool buffers are laid out by slot: the input buffer, then one buffer per output (sized for the widest layout)
+  const size_t firstBufferIndex = slot * (nbOutputs + 1);
+  BlockBuffers buffers;
+  buffers.input = _bufferPool.getBuffer(firstBufferIndex, _blockSize * nbInputChannels);
+  for (size_t i = 0; i < nbOutputs; ++i) {
+    buffers.outputs.push_back(_bufferPool.getBuffer(firstBufferIndex + 1 + i, _blockSize * getMaxNbOutputChannels()));
+  }
+  return buffers;
+}
+
+void Renderer::renderBlock(const std::vector<RenderOutput>& outputs,
+                           const uint64_t framePosition,
+                           const size_t nbFrames,
+                           const BlockBuffers& buffers) {
+  // Each output block is split into frame ranges, so that idle threads can help with wide programmes
+  const size_t inputNbChannels = getNbReadChannels();
+  const size_t nbTasksByOutput = _threadPool ? _threadPool->getNbThreads() : 1;
+  auto renderTask = [&](const size_t taskIndex) {
+    const size_t outputIndex = taskIndex / nbTasksByOutput;
+    const size_t range = taskIndex % nbTasksByOutput;
+    const size_t firstFrame = nbFrames * range / nbTasksByOutput;
+    const size_t lastFrame = nbFrames * (range + 1) / nbTasksByOutput;
+    const size_t outputNbChannels = outputs[outputIndex].renderPlan.getNbOutputChannels();
+    // the output block is overwritten by the render plan, no need to clear it
+    outputs[outputIndex].renderPlan.process(framePosition + firstFrame,
+                                            lastFrame - firstFrame,
+                                            buffers.input + firstFrame * inputNbChannels,
+                                            inputNbChannels,
+                                            buffers.outputs[outputIndex] + firstFrame * outputNbChannels,
+                                            false);
+  };
+
+  if(_threadPool) {
+    _threadPool->parallelFor(outputs.size() * nbTasksByOutput, renderTask);
+  } else {
+    for (size_t i = 0; i < outputs.size(); ++i) {
+      renderTask(i);
     }
-    written += _outputLayout.channels().size();
-    read += _inputNbChannels;
-    frame++;
   }
-  return written;
 }
 
-void Renderer::toFile(const std::unique_ptr<bw64::Bw64Writer>& outputFile) {
+void Renderer::openOutputs(std::vector<RenderOutput>& outputs) {
+  if(_outputFileDescriptor < 0) {
+    for(RenderOutput& output : outputs) {
+      // all the outputs go through the same PCM encoder, whatever the rendering mode
+      output.outputFile.reset(new Bw64FileWriter(output.outputFilePath, output.renderPlan.getNbOutputChannels(), _sampleRate, _inputBitDepth, output.chnaChunk, output.axmlChunk));
+    }
+    return;
+  }
+  // a stream holds a single output, whose header is written right away
+  if(outputs.size() != 1) {
+    std::stringstream message;
+    message << "Only one output can be streamed, instead of " << outputs.size() << ": select a single element and output layout.";
+    throw std::runtime_error(message.str());
+  }
+  outputs[0].outputFile.reset(new Bw64FileWriter(_outputFileDescriptor, outputs[0].renderPlan.getNbOutputChannels(), _sampleRate, _inputBitDepth,
+                                                 outputs[0].chnaChunk, outputs[0].axmlChunk, _outputFormat));
+}
+
+void Renderer::closeOutputs(std::vector<RenderOutput>& outputs) {
+  for(RenderOutput& output : outputs) {
+    // closing the writer sets the final header sizes
+    output.outputFile->close();
+    output.outputFile.reset();
+    std::cout << " >> Done: " << (_outputFileDescriptor < 0 ? output.outputFilePath : "streamed output") << std::endl;
+  }
+}
+
+void Renderer::toFiles(std::vector<RenderOutput>& outputs) {
+  openOutputs(outputs);
+
+  if(_queueDepth) {
+    toFilesInPipeline(outputs);
+  } else {
+    // Buffers: the decoded input block is shared (read-only) by all outputs
+    const BlockBuffers buffers = getBlockBuffers(0, getNbReadChannels(), outputs.size());
+
+    // Read each input block once, and render it to every output file
+    uint64_t frame = 0;
+    while (const uint64_t nbFrames = readInputBlock(frame, buffers.input, _blockSize)) {
+      renderBlock(outputs, frame, nbFrames, buffers);
+      for (size_t i = 0; i < outputs.size(); ++i) {
+        outputs[i].outputFile->write(frame, buffers.outputs[i], nbFrames);
+      }
+      frame += nbFrames;
+      reportProgress(frame);
+    }
+  }
+  if(_inputFile) {
+    _inputFile->seek(0);
+  }
+
+  closeOutputs(outputs);
+}
+
+void Renderer::toFilesInPipeline(std::vector<RenderOutput>& outputs) {
+  // Blocks circulate from the reader thread, to the render stage (this thread), to the writer thread,
+  // and back to the reader. Besides the one held by each stage, up to _queueDepth blocks are in flight.
+  struct PipelineBlock {
+    BlockBuffers buffers;
+    uint64_t framePosition;
+    size_t nbFrames;
+  };
+  std::vector<PipelineBlock> blocks(_queueDepth + 2);
+  for (size_t i = 0; i < blocks.size(); ++i) {
+    blocks[i].buffers = getBlockBuffers(i, getNbReadChannels(), outputs.size());
+    blocks[i].framePosition = 0;
+    blocks[i].nbFrames = 0;
+  }
+
+  BlockQueue<size_t> freeBlocks(blocks.size());
+  BlockQueue<size_t> readBlocks(blocks.size());
+  BlockQueue<size_t> renderedBlocks(blocks.size());
+  std::chrono::nanoseconds readStallTime(0);
+  std::chrono::nanoseconds renderStallTime(0);
+  std::chrono::nanoseconds writeStallTime(0);
+  std::exception_ptr readError;
+  std::exception_ptr renderError;
+  std::exception_ptr writeError;
+
+  for (size_t i = 0; i < blocks.size(); ++i) {
+    freeBlocks.push(i, readStallTime);
+  }
+
+  std::thread reader([&]() {
+    try {
+      size_t blockIndex = 0;
+      uint64_t frame = 0;
+      while(freeBlocks.pop(blockIndex, readStallTime)) {
+        PipelineBlock& block = blocks[blockIndex];
+        block.framePosition = frame;
+        block.nbFrames = readInputBlock(frame, block.buffers.input, _blockSize);
+        if(block.nbFrames == 0 || !readBlocks.push(blockIndex, readStallTime)) {
+          break;
+        }
+        frame += block.nbFrames;
+      }
+    } catch(...) {
+      readError = std::current_exception();
+    }
+    readBlocks.close();
+  });
 
-  // Buffers
-  const size_t outputNbChannels = outputFile->channels();
-  const size_t inputBufferLength = BLOCK_SIZE * _inputNbChannels;
-  const size_t outputBufferLength = BLOCK_SIZE * outputNbChannels;
+  std::thread writer([&]() {
+    try {
+      size_t blockIndex = 0;
+      while(renderedBlocks.pop(blockIndex, writeStallTime)) {
+        PipelineBlock& block = blocks[blockIndex];
+        for (size_t i = 0; i < outputs.size(); ++i) {
+          outputs[i].outputFile->write(block.framePosition, block.buffers.outputs[i], block.nbFrames);
+        }
+        reportProgress(block.framePosition + block.nbFrames);
+        freeBlocks.push(blockIndex, writeStallTime);
+      }
+    } catch(...) {
+      writeError = std::current_exception();
+    }
+    // unblock the other stages, that stop on a closed queue
+    freeBlocks.close();
+    readBlocks.close();
+  });
 
-  // Read file, render with gains and write output file
-  float inputBuffer[inputBufferLength]; // nb of samples * nb input channels
-  memset(inputBuffer, 0.0, inputBufferLength * sizeof(float));
+  try {
+    size_t blockIndex = 0;
+    while(readBlocks.pop(blockIndex, renderStallTime)) {
+      PipelineBlock& block = blocks[blockIndex];
+      renderBlock(outputs, block.framePosition, block.nbFrames, block.buffers);
+      if(!renderedBlocks.push(blockIndex, renderStallTime)) {
+        break;
+      }
+    }
+  } catch(...) {
+    renderError = std::current_exception();
+  }
+  renderedBlocks.close();
+  writer.join();
+  reader.join();
 
-  while (!_inputFile->eof()) {
-    // Reset output buffer
-    float outputBuffer[outputBufferLength]; // nb of samples * nb output channels
-    memset(outputBuffer, 0.0, outputBufferLength * sizeof(float));
+  typedef std::chrono::duration<double, std::milli> Milliseconds;
+  std::cout << " >> Pipeline stall times: read: " << Milliseconds(readStallTime).count() << " ms"
+            << ", render: " << Milliseconds(renderStallTime).count() << " ms"
+            << ", write: " << Milliseconds(writeStallTime).count() << " ms" << std::endl;
 
-    // Read a data block
-    auto nbFrames = _inputFile->read(inputBuffer, BLOCK_SIZE);
-    processBlock(nbFrames, inputBuffer, outputBuffer);
-    outputFile->write(outputBuffer, nbFrames);
+  for(const std::exception_ptr& error : { readError, renderError, writeError }) {
+    if(error) {
+      std::rethrow_exception(error);
+    }
   }
-  _inputFile->seek(0);
+}
+
+void Renderer::toFilesInShards(std::vector<RenderOutput>& outputs) {
+  if(!_inputFileReader) {
+    throw std::runtime_error("Time shards need the input file path to be set.");
+  }
+  openOutputs(outputs);
+
+  // One shard per thread, starting on a block boundary
+  const uint64_t nbFrames = _inputFileReader->numberOfFrames();
+  const uint64_t nbShards = _threadPool->getNbThreads();
+  const uint64_t nbBlocks = (nbFrames + _blockSize - 1) / _blockSize;
+  const uint64_t shardLength = (nbBlocks + nbShards - 1) / nbShards * _blockSize;
+  std::cout << " >> Render " << nbFrames << " frames in " << nbShards << " time shards of " << shardLength << " frames" << std::endl;
+
+  std::atomic<uint64_t> nbRenderedFrames(0);
+  std::vector<BlockBuffers> shardBuffers;
+  for (size_t shard = 0; shard < nbShards; ++shard) {
+    shardBuffers.push_back(getBlockBuffers(shard, getNbReadChannels(), 1));
+  }
+
+  _threadPool->parallelFor(nbShards, [&](const size_t shard) {
+    const uint64_t firstFrame = shard * shardLength;
+    const uint64_t lastFrame = std::min(nbFrames, firstFrame + shardLength);
+    if(firstFrame >= lastFrame) {
+      return;
+    }
+
+    float* inputBuffer = shardBuffers[shard].input;
+    float* outputBuffer = shardBuffers[shard].outputs[0];
+
+    uint64_t frame = firstFrame;
+    while(frame < lastFrame) {
+      const uint64_t nbBlockFrames = _inputFileReader->read(frame, inputBuffer, std::min<uint64_t>(_blockSize, lastFrame - frame), _readTrackIds);
+      if(nbBlockFrames == 0) {
+        break;
+      }
+      for (size_t i = 0; i < outputs.size(); ++i) {
+        outputs[i].renderPlan.process(frame, nbBlockFrames, inputBuffer, _readTrackIds.size(), outputBuffer, false);
+        outputs[i].outputFile->write(frame, outputBuffer, nbBlockFrames);
+      }
+      frame += nbBlockFrames;
+      // shards progress at the same time, hence the frames rendered by all of them are counted
+      reportProgress(nbRenderedFrames += nbBlockFrames);
+    }
+  });
+
+  closeOutputs(outputs);
 }
 
 }
@@ -4,7 +4,19 @@
 #include <bw64/bw64.hpp>
 #include <adm/adm.hpp>
 
+#include <functional>
+#include <mutex>
+
 #include "audio_object_renderer.hpp"
+#include "block_queue.hpp"
+#include "buffer_pool.hpp"
+#include "bw64_file_reader.hpp"
+#include "bw64_file_writer.hpp"
+#include "bw64_stream_reader.hpp"
+#include "render_plan.hpp"
+#include "render_plan_cache.hpp"
+#include "thread_pool.hpp"
+#include "timeline_index.hpp"
 
 #if defined(WIN32) || defined(_WIN32)
 #define PATH_SEPARATOR "\\"
@@ -15,15 +27,60 @@
 namespace admengine {
 
 const unsigned int BLOCK_SIZE = 4096; // in frames
+const unsigned int DEFAULT_QUEUE_DEPTH = 2; // in blocks
+const char* const DEFAULT_OUTPUT_LAYOUT = "0+2+0";
+
+/// Called with the number of frames rendered into the outputs so far, and the number of input frames
+typedef std::function<void(const uint64_t nbRenderedFrames, const uint64_t nbFrames)> ProgressCallback;
+
+/// Layout of an ITU-R BS.2051 system name (e.g. "0+5+0"), built once per process (thread-safe)
+const ear::Layout& getOutputLayout(const std::string& outputLayout);
+
+/// Render plan of an ADM element, and the file (or stream) it is rendered to
+struct RenderOutput {
+  RenderPlan renderPlan;
+  std::string outputFilePath;
+  std::shared_ptr<bw64::AxmlChunk> axmlChunk;
+  std::shared_ptr<bw64::ChnaChunk> chnaChunk;
+  std::unique_ptr<Bw64FileWriter> outputFile;
+};
 
 class Renderer {
 
 public:
   Renderer(const std::unique_ptr<bw64::Bw64Reader>& inputFile,
-           const std::string& outputLayout,
+           const std::vector<std::string>& outputLayouts,
+           const std::string& outputDirectory,
+           const std::map<std::string, float> elementGains = {},
+           const std::string& elementIdToRender = "");
+  /// Renderer of a BW64 stream (e.g. a pipe), read once, forward only: all outputs are rendered in a single pass
+  Renderer(Bw64StreamReader& inputStream,
+           const std::vector<std::string>& outputLayouts,
            const std::string& outputDirectory,
            const std::map<std::string, float> elementGains = {},
            const std::string& elementIdToRender = "");
+  /// Renderer of in-memory content, described by its ADM chunks, whose blocks are mixed by processBlock
+  Renderer(const std::shared_ptr<bw64::AxmlChunk>& axmlChunk,
+           const std::shared_ptr<bw64::ChnaChunk>& chnaChunk,
+           const uint16_t nbInputChannels,
+           const uint32_t sampleRate,
+           const std::vector<std::string>& outputLayouts,
+           const std::map<std::string, float> elementGains = {},
+           const std::string& elementIdToRender = "");
+
+  void setNbThreads(const size_t nbThreads);
+  void setBlockSize(const size_t blockSize);
+  /// Number of blocks buffered between the read, render and write stages (0 to run them sequentially)
+  void setQueueDepth(const size_t queueDepth);
+  /// Reopen the input file for positional reads (or through a memory mapping), decoding only the tracks used by the rendering
+  void setInputFilePath(const std::string& inputFilePath, const bool memoryMapped = false);
+  void enableTimeSharding();
+  /// Load the gains of already rendered elements from the cache, and store the computed ones into it
+  void setRenderPlanCache(const std::shared_ptr<RenderPlanCache>& renderPlanCache);
+  /// Stream the rendered element to a file descriptor (e.g. the standard output), block by block, instead of to an output file
+  void setOutputStream(const int fileDescriptor, const OutputFormat format = OutputFormat::Bw64);
+  /// Report the rendering progress after each written block (from the rendering threads, one call at a time)
+  void setProgressCallback(const ProgressCallback& progressCallback);
 
   void process();
 
@@ -33,13 +90,24 @@ public:
   void processAudioProgramme(const std::shared_ptr<adm::AudioProgramme>& audioProgramme);
   void processAudioObject(const std::shared_ptr<adm::AudioObject>& audioObject);
 
-  size_t processBlock(const size_t nbFrames,
+  /// Mix a block of interleaved input frames, starting at the given frame position, into the output block of a layout,
+  /// or overwrite it unless accumulate is set (without any heap allocation)
+  size_t processBlock(const uint64_t framePosition,
+                      const size_t nbFrames,
                       const float* input,
-                      float* output) const;
+                      float* output,
+                      const size_t layoutIndex = 0,
+                      const bool accumulate = true) const;
 
-  void toFile(const std::unique_ptr<bw64::Bw64Writer>& outputFile);
+  void toFiles(std::vector<RenderOutput>& outputs);
+  void toFilesInPipeline(std::vector<RenderOutput>& outputs);
+  void toFilesInShards(std::vector<RenderOutput>& outputs);
 
-  size_t getNbOutputChannels() const { return _outputLayout.channels().size(); }
+  uint32_t getSampleRate() const { return _sampleRate; }
+  size_t getNbInputChannels() const { return _inputNbChannels; }
+  size_t getNbOutputLayouts() const { return _outputLayouts.size(); }
+  const ear::Layout& getLayout(const size_t layoutIndex = 0) const { return _outputLayouts.at(layoutIndex); }
+  size_t getNbOutputChannels(const size_t layoutIndex = 0) const { return _outputLayouts.at(layoutIndex).channels().size(); }
 
   std::shared_ptr<adm::Document> getDocument() const { return _admDocument; };
   std::vector<std::shared_ptr<adm::AudioProgramme>> getDocumentAudioProgrammes();
@@ -49,6 +117,38 @@ public:
   std::shared_ptr<bw64::ChnaChunk> getAdmChnaChunk() const;
 
 private:
+  /// Input and output buffers of a rendering block, taken from the buffer pool
+  struct BlockBuffers {
+    float* input;
+    std::vector<float*> outputs;
+  };
+
+  void initDocument();
+  AudioObjectRenderer createAudioObjectRenderer(const size_t layoutIndex, const std::shared_ptr<adm::AudioObject>& audioObject);
+  void addAudioObjectRenderers(const std::shared_ptr<adm::AudioObject>& audioObject, const float gain);
+  void compileRenderPlans();
+  void displayRenderPlansInitialisation(const std::chrono::steady_clock::time_point& start) const;
+  size_t getMaxNbOutputChannels() const;
+  void reportProgress(const uint64_t nbRenderedFrames);
+  BlockBuffers getBlockBuffers(const size_t slot, const size_t nbInputChannels, const size_t nbOutputs);
+  void render(std::vector<RenderOutput>& outputs);
+  void selectInputTracks(std::vector<RenderOutput>& outputs);
+  void openOutputs(std::vector<RenderOutput>& outputs);
+  void closeOutputs(std::vector<RenderOutput>& outputs);
+  size_t getNbReadChannels() const;
+  uint64_t getNbInputFrames() const;
+  uint64_t readInputBlock(const uint64_t framePosition, float* buffer, const size_t nbFrames);
+  void renderBlock(const std::vector<RenderOutput>& outputs,
+                   const uint64_t framePosition,
+                   const size_t nbFrames,
+                   const BlockBuffers& buffers);
+
+  /// Output of an element to a layout, whose file name also holds the element ID if other elements have the same name
+  RenderOutput createRenderOutput(const std::shared_ptr<adm::AudioProgramme>& audioProgramme, const size_t layoutIndex, const bool isNameShared = false);
+  RenderOutput createRenderOutput(const std::shared_ptr<adm::AudioObject>& audioObject, const size_t layoutIndex, const bool isNameShared = false);
+  RenderOutput createRenderOutput(const std::string& elementName, const std::shared_ptr<adm::Document>& document, const size_t layoutIndex);
+  static std::string getOutputName(const std::string& elementName);
+
   float getElementGain(const std::string& elementId) {
     if(_elementGainsMap.find(elementId) == _elementGainsMap.end()) {
       return 1.0;
@@ -57,16 +157,46 @@ private:
   }
 
 private:
-  const std::unique_ptr<bw64::Bw64Reader>& _inputFile;
+  /// Input file (null for in-memory content)
+  bw64::Bw64Reader* const _inputFile;
+  /// Input stream (null if the input is not streamed)
+  Bw64StreamReader* const _inputStream;
   const size_t _inputNbChannels;
-  const ear::Layout _outputLayout;
+  const uint32_t _sampleRate;
+  const uint16_t _inputBitDepth;
+  /// Layouts rendered in the same pass, from the same input blocks
+  const std::vector<ear::Layout> _outputLayouts;
   const std::string _outputDirectory;
   const std::map<std::string, float> _elementGainsMap;
   const std::string _elementIdToRender;
 
-  std::shared_ptr<adm::Document> _admDocument;
+  std::shared_ptr<bw64::AxmlChunk> _axmlChunk;
   std::shared_ptr<bw64::ChnaChunk> _chnaChunk;
-  std::vector<AudioObjectRenderer> _renderers;
+  std::shared_ptr<adm::Document> _admDocument;
+  std::unique_ptr<TimelineIndex> _timelineIndex;
+  /// Renderers and compiled render plan of the current element, by output layout
+  std::vector<std::vector<AudioObjectRenderer>> _renderers;
+  std::vector<RenderPlan> _renderPlans;
+  std::shared_ptr<RenderPlanCache> _renderPlanCache;
+  /// Hash of the input ADM chunks, that render plans are cached for
+  std::string _documentHash;
+  /// Number of object render plans loaded from the cache, and computed, since the last initialisation
+  size_t _nbCachedRenderPlans;
+  size_t _nbComputedRenderPlans;
+  std::unique_ptr<ThreadPool> _threadPool;
+  size_t _blockSize;
+  size_t _queueDepth;
+  BufferPool _bufferPool;
+  /// Positional input reader (null if the input file path is not known)
+  std::unique_ptr<Bw64FileReader> _inputFileReader;
+  /// Input tracks read by the positional reader, that render plans are remapped to
+  std::vector<size_t> _readTrackIds;
+  bool _timeSharding;
+  /// Output stream file descriptor (-1 to render to output files)
+  int _outputFileDescriptor;
+  OutputFormat _outputFormat;
+  ProgressCallback _progressCallback;
+  std::mutex _progressMutex;
 };
 
 template<class T>
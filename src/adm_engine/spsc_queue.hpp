@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace admengine {
+
+/**
+ * Bounded lock-free FIFO ring buffer, between a single producer thread and a single consumer thread.
+ *
+ * Neither side ever blocks nor allocates: push fails while the queue is full, and the consumer
+ * peeks at the front item before popping it. Items are copied in and out of preallocated slots.
+ */
+template <class T>
+class SpscQueue {
+
+public:
+  SpscQueue(const size_t capacity)
+    : _items((capacity ? capacity : 1) + 1) // one slot is kept empty, to tell a full queue from an empty one
+    , _head(0)
+    , _tail(0)
+  {
+  }
+  SpscQueue(const SpscQueue&) = delete;
+  SpscQueue& operator=(const SpscQueue&) = delete;
+
+  size_t capacity() const { return _items.size() - 1; }
+
+  /// Number of items that can be pushed (from the producer thread)
+  size_t getFreeSpace() const {
+    const size_t tail = _tail.load(std::memory_order_relaxed);
+    const size_t head = _head.load(std::memory_order_acquire);
+    return capacity() - (tail + _items.size() - head) % _items.size();
+  }
+
+  /// Push an item (from the producer thread), or return false if the queue is full
+  bool push(const T& item) {
+    const size_t tail = _tail.load(std::memory_order_relaxed);
+    const size_t nextTail = (tail + 1) % _items.size();
+    if(nextTail == _head.load(std::memory_order_acquire)) {
+      return false;
+    }
+    _items[tail] = item;
+    _tail.store(nextTail, std::memory_order_release);
+    return true;
+  }
+
+  /// Oldest item (from the consumer thread), or null if the queue is empty
+  const T* front() const {
+    const size_t head = _head.load(std::memory_order_relaxed);
+    if(head == _tail.load(std::memory_order_acquire)) {
+      return nullptr;
+    }
+    return &_items[head];
+  }
+
+  /// Remove the front item (from the consumer thread, once front returned it)
+  void pop() {
+    const size_t head = _head.load(std::memory_order_relaxed);
+    _head.store((head + 1) % _items.size(), std::memory_order_release);
+  }
+
+private:
+  std::vector<T> _items;
+  /// Next slot to pop, written by the consumer only
+  std::atomic<size_t> _head;
+  /// Next slot to push, written by the producer only
+  std::atomic<size_t> _tail;
+};
+
+}
@@ -0,0 +1,125 @@
+
+#include "thread_pool.hpp"
+
+namespace admengine {
+
+ThreadPool::ThreadPool(const size_t nbThreads)
+  : _task(nullptr)
+  , _generation(0)
+  , _nbPendingTasks(0)
+  , _stopping(false)
+{
+  const size_t nbQueues = nbThreads ? nbThreads : 1;
+  for (size_t i = 0; i < nbQueues; ++i) {
+    _queues.emplace_back(new TaskQueue());
+  }
+  // the first queue belongs to the calling thread
+  for (size_t i = 1; i < nbQueues; ++i) {
+    _threads.emplace_back(&ThreadPool::workerLoop, this, i);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stopping = true;
+  }
+  _wakeUp.notify_all();
+  for(std::thread& thread : _threads) {
+    thread.join();
+  }
+}
+
+void ThreadPool::parallelFor(const size_t nbTasks, const std::function<void(const size_t)>& task) {
+  if(_threads.empty() || nbTasks == 1) {
+    for (size_t i = 0; i < nbTasks; ++i) {
+      task(i);
+    }
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _task = &task;
+    _nbPendingTasks = nbTasks;
+    _error = nullptr;
+    // spread consecutive tasks over the queues
+    for (size_t i = 0; i < nbTasks; ++i) {
+      TaskQueue& queue = *_queues[i % _queues.size()];
+      std::lock_guard<std::mutex> queueLock(queue.mutex);
+      queue.tasks.push_back(i);
+    }
+    _generation++;
+  }
+  _wakeUp.notify_all();
+
+  runTasks(0);
+
+  std::unique_lock<std::mutex> lock(_mutex);
+  _done.wait(lock, [this]{ return _nbPendingTasks == 0; });
+  _task = nullptr;
+  if(_error) {
+    std::rethrow_exception(_error);
+  }
+}
+
+void ThreadPool::workerLoop(const size_t threadIndex) {
+  size_t generation = 0;
+  while(true) {
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      _wakeUp.wait(lock, [this, &generation]{ return _stopping || _generation != generation; });
+      if(_stopping) {
+        return;
+      }
+      generation = _generation;
+    }
+    runTasks(threadIndex);
+  }
+}
+
+void ThreadPool::runTasks(const size_t threadIndex) {
+  size_t taskIndex = 0;
+  while(popTask(threadIndex, taskIndex)) {
+    std::exception_ptr error;
+    try {
+      (*_task)(taskIndex);
+    } catch(...) {
+      error = std::current_exception();
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    if(error && !_error) {
+      _error = error;
+    }
+    if(--_nbPendingTasks == 0) {
+      _done.notify_all();
+    }
+  }
+}
+
+bool ThreadPool::popTask(const size_t threadIndex, size_t& taskIndex) {
+  // own tasks first, in order...
+  {
+    TaskQueue& queue = *_queues[threadIndex];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if(!queue.tasks.empty()) {
+      taskIndex = queue.tasks.front();
+      queue.tasks.pop_front();
+      return true;
+    }
+  }
+  // ... then steal from the back of the other queues
+  for (size_t i = 1; i < _queues.size(); ++i) {
+    TaskQueue& queue = *_queues[(threadIndex + i) % _queues.size()];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if(!queue.tasks.empty()) {
+      taskIndex = queue.tasks.back();
+      queue.tasks.pop_back();
+      return true;
+    }
+  }
+  return false;
+}
+
+}
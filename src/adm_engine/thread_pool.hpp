@@ -0,0 +1,59 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace admengine {
+
+/**
+ * Pool of rendering threads, with work stealing.
+ *
+ * Each thread owns a task queue, and takes tasks from the other queues once its own is empty,
+ * so that a few expensive tasks do not leave other threads idle. The calling thread takes part
+ * in the processing, hence a pool of N threads only starts N - 1 of them.
+ */
+class ThreadPool {
+
+public:
+  ThreadPool(const size_t nbThreads);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  size_t getNbThreads() const { return _queues.size(); }
+
+  /// Call task(i) for each i in [0, nbTasks) over the pool threads, and wait for all of them
+  void parallelFor(const size_t nbTasks, const std::function<void(const size_t)>& task);
+
+private:
+  struct TaskQueue {
+    std::mutex mutex;
+    std::deque<size_t> tasks;
+  };
+
+  void workerLoop(const size_t threadIndex);
+  void runTasks(const size_t threadIndex);
+  bool popTask(const size_t threadIndex, size_t& taskIndex);
+
+private:
+  std::vector<std::unique_ptr<TaskQueue>> _queues;
+  std::vector<std::thread> _threads;
+
+  std::mutex _mutex;
+  std::condition_variable _wakeUp;
+  std::condition_variable _done;
+  const std::function<void(const size_t)>* _task;
+  size_t _generation;
+  size_t _nbPendingTasks;
+  std::exception_ptr _error;
+  bool _stopping;
+};
+
+}
@@ -0,0 +1,128 @@
+#include "timeline_index.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace admengine {
+
+namespace {
+
+template <class AudioBlockFormat>
+std::vector<BlockSpan> computeBlockSpans(const std::shared_ptr<adm::AudioChannelFormat>& audioChannelFormat, const uint32_t sampleRate) {
+  std::vector<BlockSpan> blockSpans;
+  const std::vector<AudioBlockFormat> audioBlockFormats = audioChannelFormat->template getElements<AudioBlockFormat>();
+  for (size_t blockIndex = 0; blockIndex < audioBlockFormats.size(); ++blockIndex) {
+    const AudioBlockFormat& audioBlockFormat = audioBlockFormats[blockIndex];
+    // a block without timing applies to the whole rendering
+    BlockSpan blockSpan{ 0, UNBOUNDED_FRAME, blockIndex };
+    if(audioBlockFormat.template has<adm::Rtime>()) {
+      blockSpan.start = toFrames(audioBlockFormat.template get<adm::Rtime>().get(), sampleRate);
+      if(audioBlockFormat.template has<adm::Duration>()) {
+        blockSpan.end = blockSpan.start + toFrames(audioBlockFormat.template get<adm::Duration>().get(), sampleRate);
+      }
+    }
+    blockSpans.push_back(blockSpan);
+  }
+  std::stable_sort(blockSpans.begin(), blockSpans.end(), [](const BlockSpan& a, const BlockSpan& b) { return a.start < b.start; });
+  return blockSpans;
+}
+
+void addAudioChannelFormats(const std::shared_ptr<adm::AudioPackFormat>& audioPackFormat, std::vector<std::shared_ptr<adm::AudioChannelFormat>>& audioChannelFormats) {
+  for(auto audioChannelFormat : audioPackFormat->getReferences<adm::AudioChannelFormat>()) {
+    audioChannelFormats.push_back(audioChannelFormat);
+  }
+  for(auto nestedAudioPackFormat : audioPackFormat->getReferences<adm::AudioPackFormat>()) {
+    addAudioChannelFormats(nestedAudioPackFormat, audioChannelFormats);
+  }
+}
+
+}
+
+uint64_t toFrames(const std::chrono::nanoseconds& time, const uint32_t sampleRate) {
+  // rounded to the nearest frame
+  return (time.count() * (int64_t)sampleRate + 500000000) / 1000000000;
+}
+
+TimelineIndex::TimelineIndex(const std::shared_ptr<adm::Document>& document, const uint32_t sampleRate)
+  : _sampleRate(sampleRate)
+{
+  for(auto audioChannelFormat : document->getElements<adm::AudioChannelFormat>()) {
+    addChannel(audioChannelFormat);
+  }
+}
+
+void TimelineIndex::addChannel(const std::shared_ptr<adm::AudioChannelFormat>& audioChannelFormat) {
+  const std::string audioChannelFormatId = adm::formatId(audioChannelFormat->get<adm::AudioChannelFormatId>());
+  switch(audioChannelFormat->get<adm::TypeDescriptor>().get()) {
+    case 1: // TypeDefinition::DIRECT_SPEAKERS
+      _blockSpans[audioChannelFormatId] = computeBlockSpans<adm::AudioBlockFormatDirectSpeakers>(audioChannelFormat, _sampleRate);
+      break;
+    case 3: // TypeDefinition::OBJECTS
+      _blockSpans[audioChannelFormatId] = computeBlockSpans<adm::AudioBlockFormatObjects>(audioChannelFormat, _sampleRate);
+      break;
+    case 4: // TypeDefinition::HOA
+      _blockSpans[audioChannelFormatId] = computeBlockSpans<adm::AudioBlockFormatHoa>(audioChannelFormat, _sampleRate);
+      break;
+    default:
+      // not rendered, hence not indexed
+      break;
+  }
+}
+
+bool TimelineIndex::hasChannel(const adm::AudioChannelFormatId& audioChannelFormatId) const {
+  return _blockSpans.find(adm::formatId(audioChannelFormatId)) != _blockSpans.end();
+}
+
+const std::vector<BlockSpan>& TimelineIndex::getBlockSpans(const adm::AudioChannelFormatId& audioChannelFormatId) const {
+  const auto blockSpans = _blockSpans.find(adm::formatId(audioChannelFormatId));
+  if(blockSpans == _blockSpans.end()) {
+    throw std::runtime_error("No timeline found for AudioChannelFormat: " + adm::formatId(audioChannelFormatId));
+  }
+  return blockSpans->second;
+}
+
+uint64_t TimelineIndex::getObjectStart(const std::shared_ptr<adm::AudioObject>& audioObject) const {
+  return audioObject->has<adm::Start>() ? toFrames(audioObject->get<adm::Start>().get()) : 0;
+}
+
+uint64_t TimelineIndex::getObjectEnd(const std::shared_ptr<adm::AudioObject>& audioObject) const {
+  return audioObject->has<adm::Duration>() ? getObjectStart(audioObject) + toFrames(audioObject->get<adm::Duration>().get()) : UNBOUNDED_FRAME;
+}
+
+std::vector<FrameSpan> TimelineIndex::getObjectActivity(const std::shared_ptr<adm::AudioObject>& audioObject) const {
+  const uint64_t objectStart = getObjectStart(audioObject);
+  const uint64_t objectEnd = getObjectEnd(audioObject);
+
+  std::vector<std::shared_ptr<adm::AudioChannelFormat>> audioChannelFormats;
+  for(auto audioPackFormat : audioObject->getReferences<adm::AudioPackFormat>()) {
+    addAudioChannelFormats(audioPackFormat, audioChannelFormats);
+  }
+
+  std::vector<FrameSpan> frameSpans;
+  for(auto audioChannelFormat : audioChannelFormats) {
+    const adm::AudioChannelFormatId audioChannelFormatId = audioChannelFormat->get<adm::AudioChannelFormatId>();
+    if(!hasChannel(audioChannelFormatId)) {
+      continue;
+    }
+    for(const BlockSpan& blockSpan : getBlockSpans(audioChannelFormatId)) {
+      const uint64_t end = blockSpan.end == UNBOUNDED_FRAME ? objectEnd : std::min(objectStart + blockSpan.end, objectEnd);
+      if(objectStart + blockSpan.start < end) {
+        frameSpans.push_back(FrameSpan{ objectStart + blockSpan.start, end });
+      }
+    }
+  }
+
+  // merge overlapping and contiguous spans
+  std::sort(frameSpans.begin(), frameSpans.end(), [](const FrameSpan& a, const FrameSpan& b) { return a.start < b.start; });
+  std::vector<FrameSpan> activity;
+  for(const FrameSpan& frameSpan : frameSpans) {
+    if(!activity.empty() && frameSpan.start <= activity.back().end) {
+      activity.back().end = std::max(activity.back().end, frameSpan.end);
+    } else {
+      activity.push_back(frameSpan);
+    }
+  }
+  return activity;
+}
+
+}
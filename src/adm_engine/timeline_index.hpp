@@ -0,0 +1,69 @@
+#pragma once
+
+#include <adm/adm.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace admengine {
+
+/// End of a span that lasts until the end of the rendering
+const uint64_t UNBOUNDED_FRAME = std::numeric_limits<uint64_t>::max();
+
+/// Convert an ADM time into a number of frames, rounded to the nearest frame
+uint64_t toFrames(const std::chrono::nanoseconds& time, const uint32_t sampleRate);
+
+/// Frame span of an AudioBlockFormat, relative to the start of its AudioObject
+struct BlockSpan {
+  uint64_t start;
+  /// First frame after the block (UNBOUNDED_FRAME if the block has no duration)
+  uint64_t end;
+  /// Index of the block in the AudioChannelFormat elements
+  size_t blockIndex;
+};
+
+/// Frame span of activity, in absolute frame positions
+struct FrameSpan {
+  uint64_t start;
+  uint64_t end;
+};
+
+/**
+ * Block spans of every AudioChannelFormat of an ADM document, sorted by rtime and converted
+ * into frames once, so that the active block of a channel can be found without scanning its
+ * AudioBlockFormat elements.
+ */
+class TimelineIndex {
+
+public:
+  TimelineIndex(const std::shared_ptr<adm::Document>& document, const uint32_t sampleRate);
+
+  uint32_t getSampleRate() const { return _sampleRate; }
+  uint64_t toFrames(const std::chrono::nanoseconds& time) const { return admengine::toFrames(time, _sampleRate); }
+
+  bool hasChannel(const adm::AudioChannelFormatId& audioChannelFormatId) const;
+  /// Spans of the channel blocks, sorted by start frame
+  const std::vector<BlockSpan>& getBlockSpans(const adm::AudioChannelFormatId& audioChannelFormatId) const;
+
+  uint64_t getObjectStart(const std::shared_ptr<adm::AudioObject>& audioObject) const;
+  /// First frame after the object (UNBOUNDED_FRAME if the object has no duration)
+  uint64_t getObjectEnd(const std::shared_ptr<adm::AudioObject>& audioObject) const;
+  /// Frame spans where any block of the object channels is active, merged and sorted
+  std::vector<FrameSpan> getObjectActivity(const std::shared_ptr<adm::AudioObject>& audioObject) const;
+
+private:
+  void addChannel(const std::shared_ptr<adm::AudioChannelFormat>& audioChannelFormat);
+
+private:
+  const uint32_t _sampleRate;
+  /// Block spans by AudioChannelFormat ID
+  std::map<std::string, std::vector<BlockSpan>> _blockSpans;
+};
+
+}
@@ -4,9 +4,13 @@
 #include <stdio.h>
 #include <string.h>
 #include <iostream>
+#include <mutex>
+#include <thread>
 
 #include <bw64/bw64.hpp>
 
+#include "adm_engine/batch_renderer.hpp"
+#include "adm_engine/buffer_renderer.hpp"
 #include "adm_engine/renderer.hpp"
 #include "adm_engine/parser.hpp"
 
@@ -22,9 +26,14 @@ void assignStringtoPointer(const std::string& str, const char** pointer) {
   std::memcpy((void*)*pointer, str.c_str(), length);
 }
 
-int dumpBw64AdmFile(const std::string& path, const char** output_message) {
+int dumpBw64AdmFile(const std::string& path, const std::string& dumpFormat, const char** output_message) {
   try {
     auto bw64File = bw64::readFile(path);
+    if(dumpFormat == "json") {
+      // only the file header and ADM chunks are read
+      assignStringtoPointer(getAdmMetadataAsJson(bw64File), output_message);
+      return 0;
+    }
     const std::string admDocumentStr = getAdmDocumentAsString(getAdmDocument(parseAdmXmlChunk(bw64File)));
 
     assignStringtoPointer(admDocumentStr, output_message);
@@ -37,76 +46,67 @@ int dumpBw64AdmFile(const std::string& path, const char** output_message) {
   return 0;
 }
 
-std::map<std::string, float> parseElementGains(const std::string& elementGainsStr) {
-  std::map<std::string, float> elementGains;
-  const size_t arrayInPos = elementGainsStr.find("[");
+std::vector<std::string> parseStringArray(const std::string& arrayStr) {
+  // format: ["first", "second", ...]
+  std::vector<std::string> strings;
+  const size_t arrayInPos = arrayStr.find("[");
   if(arrayInPos ==  std::string::npos) {
-    throw std::runtime_error("Invalid gains mapping string format: missing '[' as first character.");
+    throw std::runtime_error("Invalid array string format: missing '[' as first character.");
   }
-  const size_t arrayOutPos = elementGainsStr.find("]");
+  const size_t arrayOutPos = arrayStr.find("]");
   if(arrayOutPos ==  std::string::npos) {
-    throw std::runtime_error("Invalid gains mapping string format:  missing ']' as last character.");
+    throw std::runtime_error("Invalid array string format:  missing ']' as last character.");
   }
-  const std::string gainPairsStr = elementGainsStr.substr(arrayInPos + 1, arrayOutPos - 1);
+  const std::string itemsStr = arrayStr.substr(arrayInPos + 1, arrayOutPos - 1);
 
   size_t nextPosition = 0;
   std::string separator = ", ";
-  while(nextPosition < gainPairsStr.size()){
-    size_t separatorPos = gainPairsStr.find(separator, nextPosition);
+  while(nextPosition < itemsStr.size()){
+    size_t separatorPos = itemsStr.find(separator, nextPosition);
 
     if(separatorPos == std::string::npos){
-      separatorPos = gainPairsStr.size();
+      separatorPos = itemsStr.size();
     }
 
-    const std::string gainPair = gainPairsStr.substr(nextPosition + 1, separatorPos - (nextPosition + 2)); // "element_id=gain"
+    strings.push_back(itemsStr.substr(nextPosition + 1, separatorPos - (nextPosition + 2))); // without quotes
+    nextPosition = separatorPos + separator.size();
+  }
+  return strings;
+}
+
+std::map<std::string, float> parseElementGains(const std::string& elementGainsStr) {
+  std::map<std::string, float> elementGains;
+  for(const std::string& gainPair : parseStringArray(elementGainsStr)) { // "element_id=gain"
     const size_t equalPos = gainPair.find("=");
     const std::string elemId = gainPair.substr(0, equalPos); // "element_id"
     const std::string gainDbStr = gainPair.substr(equalPos + 1, gainPair.size()); // "gain"
     elementGains[elemId] = pow(10.0, std::atof(gainDbStr.c_str()) / 20.0);
     std::cout << "Gain:                  " << elementGains[elemId] << " (" << gainDbStr << " dB) applied to " << elemId << std::endl;
-
-    nextPosition = separatorPos + separator.size();
   }
-
   return elementGains;
 }
 
-int renderAdmContent(const char* input,
-                     const char* destination,
-                     const char* elementGainsCStr,
-                     const char* elementIdToRenderCStr,
-                     const char** output_message) {
-
-  const std::string inputFilePath(input);
-  const std::string outputDirectoryPath(destination);
-  std::cout << "Input file:            " << inputFilePath << std::endl;
-  std::cout << "Output directory:      " << outputDirectoryPath << std::endl;
-
-  std::string elementIdToRender;
-  if(elementIdToRenderCStr) {
-    elementIdToRender = elementIdToRenderCStr;
-    std::cout << "ADM element to render: " << elementIdToRender << std::endl;
+std::shared_ptr<RenderPlanCache> getRenderPlanCache(const std::string& directory) {
+  // kept from one job to the next, as long as the cache directory does not change
+  static std::mutex mutex;
+  static std::shared_ptr<RenderPlanCache> renderPlanCache;
+  std::lock_guard<std::mutex> lock(mutex);
+  if(!renderPlanCache || renderPlanCache->getDirectory() != directory) {
+    renderPlanCache = std::make_shared<RenderPlanCache>(directory);
   }
+  return renderPlanCache;
+}
 
-  std::map<std::string, float> elementGains;
-  if(elementGainsCStr) {
-    elementGains = parseElementGains(elementGainsCStr);
-  }
-
-  try {
-    auto bw64File = bw64::readFile(inputFilePath);
-    const std::string outputLayout("0+2+0"); // TODO: get it from args
-
-    Renderer renderer(bw64File, outputLayout, outputDirectoryPath, elementGains, elementIdToRender);
-    renderer.process();
-
-  } catch(const std::exception& e) {
-    std::string error(e.what());
-    std::cerr << "Error: " << error << std::endl;
-    assignStringtoPointer(error, output_message);
-    return 1;
-  }
-  return 0;
+/**
+ * Renderer shared by the concurrent jobs of the worker, within the budgets set by the environment:
+ *  - ADM_ENGINE_THREAD_BUDGET: rendering threads of all running jobs (default: number of CPU cores)
+ *  - ADM_ENGINE_MEMORY_BUDGET: estimated memory (in MB) of all running jobs (default: unlimited)
+ */
+BatchRenderer& getBatchRenderer() {
+  static BatchRenderer batchRenderer(DEFAULT_NB_CONCURRENT_JOBS,
+                                     getenv("ADM_ENGINE_MEMORY_BUDGET") ? std::atoll(getenv("ADM_ENGINE_MEMORY_BUDGET")) * 1024 * 1024 : 0,
+                                     getenv("ADM_ENGINE_THREAD_BUDGET") ? std::atoi(getenv("ADM_ENGINE_THREAD_BUDGET")) : std::thread::hardware_concurrency());
+  return batchRenderer;
 }
 
 void displayUsage() {
@@ -116,6 +116,13 @@ void displayUsage() {
   std::cout << "  output         (string) (optional)            Destination directory" << std::endl;
   std::cout << "  element_id     (string) (optional)            Select the AudioProgramme or AudioObject to be renderer by `element_id`" << std::endl;
   std::cout << "  gain_mapping   (array_of_strings) (optional)  Array of `ELEMENT_ID=GAIN` strings, where `GAIN` is the gain value (in dB) to apply to ADM element defined by its `ELEMENT_ID`" << std::endl;
+  std::cout << "  output_layouts (array_of_strings) (optional)  Array of output layouts, as ITU-R BS.2051 system names, rendered in one pass (default: [\"0+2+0\"])" << std::endl;
+  std::cout << "  threads        (integer) (optional)           Number of rendering threads (default: 1)" << std::endl;
+  std::cout << "  block_size     (integer) (optional)           Number of frames rendered per block (default: " << BLOCK_SIZE << ")" << std::endl;
+  std::cout << "  queue_depth    (integer) (optional)           Number of blocks buffered between read, render and write threads (default: " << DEFAULT_QUEUE_DEPTH << ", 0 to disable)" << std::endl;
+  std::cout << "  memory_mapping (boolean) (optional)           Read the input file through a memory mapping (default: false)" << std::endl;
+  std::cout << "  cache_directory (string) (optional)           Directory of render plans shared between workers (render plans are always cached in memory)" << std::endl;
+  std::cout << "  dump_format    (string) (optional)            Format of the file information dumped without `output`: `xml` for the ADM document, or `json` for a metadata summary (default: xml)" << std::endl;
   std::cout << std::endl;
   std::cout << "  If no `output` argument is specified, this program dumps the input BW64/ADM file information." << std::endl;
   std::cout << "  Otherwise, it enables ADM rendering to BW64/ADM file into destination directory." << std::endl;
@@ -168,8 +175,10 @@ typedef struct Parameter {
 // Worker parameters
 char* string_kind[1] = { (char*)"string" };
 char* array_of_strings_kind[1] = { (char*)"array_of_strings" };
+char* integer_kind[1] = { (char*)"integer" };
+char* boolean_kind[1] = { (char*)"boolean" };
 
-Parameter worker_parameters[4] = {
+Parameter worker_parameters[11] = {
     {
         .identifier = (char*)"input",
         .label = (char*)"BW64/ADM audio file path",
@@ -197,6 +206,55 @@ Parameter worker_parameters[4] = {
         .kind_size = 1,
         .kind = array_of_strings_kind,
         .required = 0
+    },
+    {
+        .identifier = (char*)"output_layouts",
+        .label = (char*)"Array of output layouts, as ITU-R BS.2051 system names, rendered in one pass",
+        .kind_size = 1,
+        .kind = array_of_strings_kind,
+        .required = 0
+    },
+    {
+        .identifier = (char*)"threads",
+        .label = (char*)"Number of rendering threads",
+        .kind_size = 1,
+        .kind = integer_kind,
+        .required = 0
+    },
+    {
+        .identifier = (char*)"block_size",
+        .label = (char*)"Number of frames rendered per block",
+        .kind_size = 1,
+        .kind = integer_kind,
+        .required = 0
+    },
+    {
+        .identifier = (char*)"queue_depth",
+        .label = (char*)"Number of blocks buffered between read, render and write threads (0 to disable the pipeline)",
+        .kind_size = 1,
+        .kind = integer_kind,
+        .required = 0
+    },
+    {
+        .identifier = (char*)"memory_mapping",
+        .label = (char*)"Read the input file through a memory mapping",
+        .kind_size = 1,
+        .kind = boolean_kind,
+        .required = 0
+    },
+    {
+        .identifier = (char*)"cache_directory",
+        .label = (char*)"Directory of render plans shared between workers",
+        .kind_size = 1,
+        .kind = string_kind,
+        .required = 0
+    },
+    {
+        .identifier = (char*)"dump_format",
+        .label = (char*)"Format of the file information dumped without `output`: `xml` or `json`",
+        .kind_size = 1,
+        .kind = string_kind,
+        .required = 0
     }
 };
 
@@ -215,6 +273,225 @@ void get_parameters(Parameter* parameters) {
     memcpy(parameters, worker_parameters, sizeof(worker_parameters));
 }
 
+/**
+ * Create a renderer of in-memory content, from the 'axml' and 'chna' chunk data (without their headers)
+ * @param axml_data             'axml' chunk data
+ * @param axml_size             'axml' chunk data size (in bytes)
+ * @param chna_data             'chna' chunk data (optional)
+ * @param chna_size             'chna' chunk data size (in bytes)
+ * @param nb_input_channels     Number of interleaved input channels
+ * @param sample_rate           Input sample rate
+ * @param element_gains         Array of `ELEMENT_ID=GAIN` strings (optional)
+ * @param element_id            AudioProgramme or AudioObject to render (optional, the first programme or object by default)
+ * @param output_layouts        Array of output layouts (optional, default: ["0+2+0"])
+ * @param output_message        Output error message pointer
+ * @return the renderer, or NULL on error
+ */
+void* create_buffer_renderer(const char* axml_data,
+                             const size_t axml_size,
+                             const char* chna_data,
+                             const size_t chna_size,
+                             const unsigned int nb_input_channels,
+                             const unsigned int sample_rate,
+                             const char* element_gains,
+                             const char* element_id,
+                             const char* output_layouts,
+                             const char** output_message) {
+  try {
+    std::vector<std::string> outputLayouts;
+    if(output_layouts) {
+      outputLayouts = parseStringArray(output_layouts);
+    }
+    if(outputLayouts.empty()) {
+      outputLayouts.push_back(DEFAULT_OUTPUT_LAYOUT);
+    }
+    BufferRenderer* renderer = new BufferRenderer(axml_data, axml_size, chna_data, chna_size, nb_input_channels, sample_rate,
+                                                  outputLayouts,
+                                                  element_gains ? parseElementGains(element_gains) : std::map<std::string, float>(),
+                                                  element_id ? element_id : "",
+                                                  getRenderPlanCache(""));
+    return renderer;
+  } catch(const std::exception& e) {
+    std::string error(e.what());
+    std::cerr << "Error: " << error << std::endl;
+    assignStringtoPointer(error, output_message);
+    return NULL;
+  }
+}
+
+/**
+ * Get the number of output layouts of a buffer renderer
+ */
+unsigned int get_buffer_renderer_nb_output_layouts(void* renderer) {
+  return static_cast<BufferRenderer*>(renderer)->getNbOutputLayouts();
+}
+
+/**
+ * Get the number of interleaved channels of an output layout
+ */
+unsigned int get_buffer_renderer_nb_output_channels(void* renderer, const unsigned int layout_index) {
+  return static_cast<BufferRenderer*>(renderer)->getNbOutputChannels(layout_index);
+}
+
+/**
+ * Get the 'axml' chunk data of an output layout (owned by the renderer, valid until it is destroyed)
+ * @param size    Output data size pointer (in bytes)
+ */
+const char* get_buffer_renderer_output_axml(void* renderer, const unsigned int layout_index, size_t* size) {
+  const std::string& data = static_cast<BufferRenderer*>(renderer)->getOutputAxmlData(layout_index);
+  *size = data.size();
+  return data.data();
+}
+
+/**
+ * Get the 'chna' chunk data of an output layout (owned by the renderer, valid until it is destroyed)
+ * @param size    Output data size pointer (in bytes)
+ */
+const char* get_buffer_renderer_output_chna(void* renderer, const unsigned int layout_index, size_t* size) {
+  const std::string& data = static_cast<BufferRenderer*>(renderer)->getOutputChnaData(layout_index);
+  *size = data.size();
+  return data.data();
+}
+
+/**
+ * Render the next block of interleaved input frames, into caller-owned output buffers (one per output layout)
+ * @param input       Interleaved input frames
+ * @param nb_frames   Number of input frames
+ * @param outputs     Output buffers, each one sized for `nb_frames` frames of its layout channels
+ */
+void process_buffer_renderer(void* renderer, const float* input, const size_t nb_frames, float* const* outputs) {
+  static_cast<BufferRenderer*>(renderer)->process(input, nb_frames, outputs);
+}
+
+/**
+ * Destroy a buffer renderer
+ */
+void destroy_buffer_renderer(void* renderer) {
+  delete static_cast<BufferRenderer*>(renderer);
+}
+
+/// Called with the opaque handler given along with it, each time the rendering progress percentage increases
+typedef void (*JobProgressCallback)(void* handler, unsigned char progression_percentage);
+
+/**
+ * Render the ADM content of a file into a destination directory, as a job of the worker batch renderer
+ * @param input                  BW64/ADM audio file path
+ * @param destination            Destination directory
+ * @param elementGainsCStr       Array of `ELEMENT_ID=GAIN` strings (optional)
+ * @param elementIdToRenderCStr  AudioProgramme or AudioObject to render (optional)
+ * @param outputLayoutsCStr      Array of output layouts (optional)
+ * @param nbThreads              Number of rendering threads
+ * @param blockSize              Number of frames rendered per block (0 for the default)
+ * @param queueDepth             Number of blocks buffered between threads (negative for the default)
+ * @param memoryMapped           Read the input file through a memory mapping if not null
+ * @param renderPlanCacheDirectoryCStr  Directory of render plans (optional)
+ * @param handler                Opaque handler given back to the progress callback
+ * @param progressCallback       Progress callback (optional)
+ * @param output_message         Output error message pointer
+ */
+int renderAdmContent(const char* input,
+                     const char* destination,
+                     const char* elementGainsCStr,
+                     const char* elementIdToRenderCStr,
+                     const char* outputLayoutsCStr,
+                     const unsigned int nbThreads,
+                     const unsigned int blockSize,
+                     const int queueDepth,
+                     const int memoryMapped,
+                     const char* renderPlanCacheDirectoryCStr,
+                     void* handler,
+                     JobProgressCallback progressCallback,
+                     const char** output_message) {
+  try {
+    const std::string inputFilePath(input);
+    const std::string outputDirectoryPath(destination);
+    std::cout << "Input file:            " << inputFilePath << std::endl;
+    std::cout << "Output directory:      " << outputDirectoryPath << std::endl;
+
+    std::string elementIdToRender;
+    if(elementIdToRenderCStr) {
+      elementIdToRender = elementIdToRenderCStr;
+      std::cout << "ADM element to render: " << elementIdToRender << std::endl;
+    }
+
+    std::vector<std::string> outputLayouts;
+    if(outputLayoutsCStr) {
+      outputLayouts = parseStringArray(outputLayoutsCStr);
+    }
+    if(outputLayouts.empty()) {
+      outputLayouts.push_back(DEFAULT_OUTPUT_LAYOUT);
+    }
+    for(const std::string& outputLayout : outputLayouts) {
+      std::cout << "Output layout:         " << outputLayout << std::endl;
+    }
+
+    if(nbThreads > 1) {
+      std::cout << "Rendering threads:     " << nbThreads << std::endl;
+    }
+
+    if(blockSize) {
+      std::cout << "Block size:            " << blockSize << std::endl;
+    }
+
+    if(queueDepth >= 0) {
+      std::cout << "Queue depth:           " << queueDepth << std::endl;
+    }
+
+    if(memoryMapped) {
+      std::cout << "Memory mapping:        enabled" << std::endl;
+    }
+
+    std::string renderPlanCacheDirectory;
+    if(renderPlanCacheDirectoryCStr) {
+      renderPlanCacheDirectory = renderPlanCacheDirectoryCStr;
+      std::cout << "Render plan cache:     " << renderPlanCacheDirectory << std::endl;
+    }
+
+    std::map<std::string, float> elementGains;
+    if(elementGainsCStr) {
+      elementGains = parseElementGains(elementGainsCStr);
+    }
+
+    BatchJob job;
+    job.inputFilePath = inputFilePath;
+    job.outputDirectory = outputDirectoryPath;
+    job.elementIdToRender = elementIdToRender;
+    job.elementGains = elementGains;
+    job.outputLayouts = outputLayouts;
+    job.nbThreads = nbThreads ? nbThreads : 1;
+    job.blockSize = blockSize;
+    job.queueDepth = queueDepth;
+    job.memoryMapped = memoryMapped;
+    job.renderPlanCache = getRenderPlanCache(renderPlanCacheDirectory);
+
+    // jobs can run concurrently, from several caller threads, reporting their own progress
+    int lastPercentage = -1;
+    auto reportProgress = [handler, progressCallback, &lastPercentage](const uint64_t nbRenderedFrames, const uint64_t nbFrames) {
+      const int percentage = nbFrames ? (int)std::min<uint64_t>(nbRenderedFrames * 100 / nbFrames, 100) : 100;
+      if(percentage > lastPercentage) {
+        lastPercentage = percentage;
+        progressCallback(handler, (unsigned char)percentage);
+      }
+    };
+
+    const BatchJobReport report = getBatchRenderer().render(job, progressCallback ? admengine::ProgressCallback(reportProgress) : admengine::ProgressCallback());
+    if(!report.succeeded) {
+      std::cerr << "Error: " << report.message << std::endl;
+      assignStringtoPointer(report.message, output_message);
+      return 1;
+    }
+    if(progressCallback && lastPercentage < 100) {
+      progressCallback(handler, 100);
+    }
+    return 0;
+  } catch(const std::exception& e) {
+    std::string error(e.what());
+    std::cerr << "Error: " << error << std::endl;
+    assignStringtoPointer(error, output_message);
+    return 1;
+  }
+}
+
 // typedef void* Handler;
 // typedef char* (*GetParameterValueCallback)(Handler, const char*);
 // typedef void* (*ProgressCallback)(Handler, unsigned char _progression_percentage);
@@ -250,15 +527,25 @@ void get_parameters(Parameter* parameters) {
 //     char* outputDirectoryPath = parameters_value_getter(handler, "output");
 //     char* elementGainsStr = parameters_value_getter(handler, "gain_mapping");
 //     char* elementIdToRender = parameters_value_getter(handler, "element_id");
+//     char* outputLayouts = parameters_value_getter(handler, "output_layouts");
+//     char* threads = parameters_value_getter(handler, "threads");
+//     const unsigned int nbThreads = threads == NULL ? 1 : atoi(threads);
+//     char* blockSizeStr = parameters_value_getter(handler, "block_size");
+//     const unsigned int blockSize = blockSizeStr == NULL ? 0 : atoi(blockSizeStr);
+//     char* queueDepthStr = parameters_value_getter(handler, "queue_depth");
+//     const int queueDepth = queueDepthStr == NULL ? -1 : atoi(queueDepthStr);
+//     char* memoryMapping = parameters_value_getter(handler, "memory_mapping");
+//     const int memoryMapped = memoryMapping != NULL && strcmp(memoryMapping, "true") == 0;
+//     char* cacheDirectory = parameters_value_getter(handler, "cache_directory");
+//     char* dumpFormat = parameters_value_getter(handler, "dump_format");
 //
 //     if(outputDirectoryPath == NULL) {
-//       const int ret = dumpBw64AdmFile(inputFilePath, output_message);
+//       const int ret = dumpBw64AdmFile(inputFilePath, dumpFormat == NULL ? "xml" : dumpFormat, output_message);
 //       progress_callback(handler, 100);
 //       return ret;
 //     } else {
-//       const int ret = renderAdmContent(inputFilePath, outputDirectoryPath, elementGainsStr, elementIdToRender, output_message);
-//       progress_callback(handler, 100);
-//       return ret;
+//       // the rendering progress is reported as it goes, up to 100%
+//       return renderAdmContent(inputFilePath, outputDirectoryPath, elementGainsStr, elementIdToRender, outputLayouts, nbThreads, blockSize, queueDepth, memoryMapped, cacheDirectory, handler, (JobProgressCallback)progress_callback, output_message);
 //     }
 // }
 
@@ -2,15 +2,23 @@
 extern crate serde_derive;
 
 extern crate libc;
-use libc::{c_char, c_int};
+use libc::{c_char, c_int, c_uint, c_void};
 use std::ffi::{CStr, CString};
 
-#[link(name = adm_engine)]
+#[link(name = "admengineworker")]
 extern "C" {
-    fn renderAdmContent(input: *mut *const c_char,
-                        destination: *mut *const c_char,
-                        element_gains_cstr: *mut *const c_char,
-                        element_id_to_render_cstr: *mut *const c_char,
+    fn renderAdmContent(input: *const c_char,
+                        destination: *const c_char,
+                        element_gains_cstr: *const c_char,
+                        element_id_to_render_cstr: *const c_char,
+                        output_layouts_cstr: *const c_char,
+                        nb_threads: c_uint,
+                        block_size: c_uint,
+                        queue_depth: c_int,
+                        memory_mapped: c_int,
+                        cache_directory_cstr: *const c_char,
+                        handler: *mut c_void,
+                        progress_callback: extern "C" fn(*mut c_void, u8),
                         output_message: *mut *const c_char) -> c_int;
 }
 
@@ -23,6 +31,24 @@ pub mod built_info {
 #[derive(Debug, Default)]
 struct AdmEngineEvent {}
 
+/// Job that the rendering progress is published for
+struct ProgressHandler {
+  channel: Option<McaiChannel>,
+  job_id: u64,
+}
+
+extern "C" fn publish_progress(handler: *mut c_void, progression: u8) {
+  let progress_handler = unsafe { &*(handler as *const ProgressHandler) };
+  if let Err(error) = publish_job_progression(progress_handler.channel.clone(), progress_handler.job_id, progression) {
+    warn!(target: &progress_handler.job_id.to_string(), "Could not publish job progression: {:?}", error);
+  }
+}
+
+/// Format strings as an array string: ["first", "second"]
+fn format_string_array(strings: &[String]) -> CString {
+  CString::new(format!("[{}]", strings.iter().map(|string| format!("\"{}\"", string)).collect::<Vec<String>>().join(", "))).unwrap()
+}
+
 #[derive(Debug, Clone, Deserialize, JsonSchema)]
 pub struct WorkerParameters {
   /// # Element ID
@@ -33,6 +59,30 @@ pub struct WorkerParameters {
   gain_mapping: Vec<String>,
   destination_path: String,
   source_path: String,
+  /// # Output layouts
+  ///
+  /// Output layouts, as ITU-R BS.2051 system names, rendered in one pass (default: ["0+2+0"])
+  output_layouts: Option<Vec<String>>,
+  /// # Threads
+  ///
+  /// Number of rendering threads (default: 1)
+  threads: Option<u32>,
+  /// # Block size
+  ///
+  /// Number of frames rendered per block (default: 4096)
+  block_size: Option<u32>,
+  /// # Queue depth
+  ///
+  /// Number of blocks buffered between read, render and write threads (default: 2, 0 to disable the pipeline)
+  queue_depth: Option<u32>,
+  /// # Memory mapping
+  ///
+  /// Read the input file through a memory mapping (default: false)
+  memory_mapping: Option<bool>,
+  /// # Cache directory
+  ///
+  /// Directory of render plans shared between workers (render plans are always cached in memory)
+  cache_directory: Option<String>,
 }
 
 impl MessageEvent<WorkerParameters> for AdmEngineEvent {
@@ -66,25 +116,59 @@ impl MessageEvent<WorkerParameters> for AdmEngineEvent {
     let destination_path = CString::new(parameters.destination_path).unwrap();
     let destination_path_ptr: *const c_char = destination_path.as_ptr();
 
-    // TODO: get whole array
-    let gain_mapping = CString::new(parameters.gain_mapping[0]).unwrap();
+    // formatted as an array string: ["AO_1001=-4.0", "ACO_1002=5.0"]
+    let gain_mapping = format_string_array(&parameters.gain_mapping);
     let gain_mapping_ptr: *const c_char = gain_mapping.as_ptr();
 
     let element_id = CString::new(parameters.element_id).unwrap();
     let element_id_ptr: *const c_char = element_id.as_ptr();
 
-    let mut output_message = std::ptr::null();
-
-    if renderAdmContent(&mut source_path_ptr,
-                        &mut destination_path_ptr,
-                        &mut gain_mapping_ptr,
-                        &mut element_id_ptr,
-                        &mut output_message) != 0 {
-                      let message = unsafe { CStr::from_ptr(output_message).to_str().unwrap().to_owned() };
-                      error!(target: &job_result.get_str_job_id(), "{}", message);
-                      return Ok(job_result.with_status(JobStatus::Error)
-                                          .with_message(&message))
-                     }
+    // formatted as an array string: ["0+5+0", "4+7+0"]
+    let output_layouts = parameters.output_layouts.unwrap_or_else(|| vec!["0+2+0".to_string()]);
+    let output_layouts = format_string_array(&output_layouts);
+    let output_layouts_ptr: *const c_char = output_layouts.as_ptr();
+
+    let nb_threads = parameters.threads.unwrap_or(1);
+    // unset values keep the renderer defaults
+    let block_size = parameters.block_size.unwrap_or(0);
+    let queue_depth = parameters.queue_depth.map_or(-1, |queue_depth| queue_depth as c_int);
+    let memory_mapped = parameters.memory_mapping.unwrap_or(false) as c_int;
+
+    let cache_directory = parameters.cache_directory.map(|directory| CString::new(directory).unwrap());
+    let cache_directory_ptr: *const c_char = cache_directory.as_ref().map_or(std::ptr::null(), |directory| directory.as_ptr());
+
+    // the rendering progress is published as it goes, not only once the job is completed
+    let mut progress_handler = ProgressHandler {
+      channel: channel.clone(),
+      job_id: job_result.get_job_id(),
+    };
+
+    let mut output_message: *const c_char = std::ptr::null();
+
+    // the C strings and the progress handler outlive the call
+    let result = unsafe {
+      renderAdmContent(source_path_ptr,
+                       destination_path_ptr,
+                       gain_mapping_ptr,
+                       element_id_ptr,
+                       output_layouts_ptr,
+                       nb_threads,
+                       block_size,
+                       queue_depth,
+                       memory_mapped,
+                       cache_directory_ptr,
+                       &mut progress_handler as *mut ProgressHandler as *mut c_void,
+                       publish_progress,
+                       &mut output_message)
+    };
+    if result != 0 {
+      // the message is allocated by the C library
+      let message = unsafe { CStr::from_ptr(output_message).to_string_lossy().into_owned() };
+      unsafe { libc::free(output_message as *mut c_void) };
+      error!(target: &job_result.get_str_job_id(), "{}", message);
+      return Ok(job_result.with_status(JobStatus::Error)
+                          .with_message(&message))
+    }
 
     Ok(job_result.with_status(JobStatus::Completed))
   }
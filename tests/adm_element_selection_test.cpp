@@ -0,0 +1,142 @@
+#include "adm_engine/parser.hpp"
+
+#include "test_utils.hpp"
+
+#include <string>
+
+using namespace admengine;
+
+namespace {
+
+bool contains(const std::string& axml, const std::string& text) {
+  return axml.find(text) != std::string::npos;
+}
+
+std::string getAxml(const std::string& elements) {
+  return "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+         "<ebuCoreMain xmlns=\"urn:ebu:metadata-schema:ebuCore_2014\">\n"
+         "  <coreMetadata><format><audioFormatExtended>\n"
+         + elements +
+         "  </audioFormatExtended></format></coreMetadata>\n"
+         "</ebuCoreMain>\n";
+}
+
+/// Programme of a single object, next to an unreferenced object
+const std::string ELEMENTS =
+  "    <audioProgramme audioProgrammeID=\"APR_1001\" audioProgrammeName=\"Main\">\n"
+  "      <audioContentIDRef>ACO_1001</audioContentIDRef>\n"
+  "    </audioProgramme>\n"
+  "    <audioContent audioContentID=\"ACO_1001\" audioContentName=\"Main\">\n"
+  "      <audioObjectIDRef> AO_1001 </audioObjectIDRef>\n"
+  "    </audioContent>\n"
+  "    <audioObject audioObjectID=\"AO_1001\" audioObjectName=\"Dialogue\">\n"
+  "      <audioPackFormatIDRef>AP_00010002</audioPackFormatIDRef>\n"
+  "      <audioTrackUIDRef>ATU_00000001</audioTrackUIDRef>\n"
+  "    </audioObject>\n"
+  "    <audioObject audioObjectID=\"AO_1002\" audioObjectName=\"Music\">\n"
+  "      <audioTrackUIDRef>ATU_00000002</audioTrackUIDRef>\n"
+  "    </audioObject>\n"
+  "    <audioTrackUID UID=\"ATU_00000001\"/>\n"
+  "    <audioTrackUID UID=\"ATU_00000002\"/>\n";
+
+void testReferencesAreFollowed() {
+  const std::string axml = selectAdmElements(getAxml(ELEMENTS), "APR_1001");
+  CHECK(contains(axml, "audioProgrammeID=\"APR_1001\""));
+  CHECK(contains(axml, "audioContentID=\"ACO_1001\""));
+  // references are trimmed, and those to common definitions (not in the document) are ignored
+  CHECK(contains(axml, "audioObjectID=\"AO_1001\""));
+  CHECK(!contains(axml, "audioObjectID=\"AO_1002\""));
+  // self-closing elements are selected, or removed, as a whole
+  CHECK(contains(axml, "<audioTrackUID UID=\"ATU_00000001\"/>"));
+  CHECK(!contains(axml, "ATU_00000002\"/>"));
+  CHECK(contains(axml, "</audioFormatExtended></format></coreMetadata>"));
+}
+
+void testSelectedElementOnly() {
+  const std::string axml = selectAdmElements(getAxml(ELEMENTS), "AO_1002");
+  CHECK(contains(axml, "audioObjectID=\"AO_1002\""));
+  CHECK(contains(axml, "ATU_00000002\"/>"));
+  CHECK(!contains(axml, "APR_1001"));
+  CHECK(!contains(axml, "audioObjectID=\"AO_1001\""));
+  CHECK(!contains(axml, "ATU_00000001\"/>"));
+}
+
+void testCommentsAndCharacterData() {
+  // tags within comments and character data are not elements
+  const std::string elements =
+    "    <!-- <audioObject audioObjectID=\"AO_1003\"> -->\n"
+    + ELEMENTS +
+    "    <audioObject audioObjectID=\"AO_1004\" audioObjectName=\"Effects\">\n"
+    "      <!-- <audioTrackUIDRef>ATU_00000001</audioTrackUIDRef> -->\n"
+    "      <label><![CDATA[ </audioObject> <audioTrackUIDRef>ATU_00000002</audioTrackUIDRef> ]]></label>\n"
+    "    </audioObject>\n";
+  const std::string axml = selectAdmElements(getAxml(elements), "AO_1004");
+  CHECK(contains(axml, "audioObjectID=\"AO_1004\""));
+  CHECK(contains(axml, "<![CDATA[ </audioObject>"));
+  CHECK(!contains(axml, "ATU_00000001\"/>"));
+  CHECK(!contains(axml, "ATU_00000002\"/>"));
+  CHECK(!contains(axml, "APR_1001"));
+  // commented out elements cannot be selected
+  CHECK_EQUAL(selectAdmElements(getAxml(elements), "AO_1003"), std::string());
+}
+
+void testNamespacedTags() {
+  const std::string axml =
+    "<adm:ebuCoreMain xmlns:adm=\"urn:ebu:metadata-schema:ebuCore_2014\">\n"
+    "  <adm:audioFormatExtended>\n"
+    "    <adm:audioObject audioObjectID=\"AO_1001\" audioObjectName=\"Dialogue\">\n"
+    "      <adm:audioTrackUIDRef>ATU_00000001</adm:audioTrackUIDRef>\n"
+    "    </adm:audioObject>\n"
+    "    <adm:audioObject audioObjectID=\"AO_1002\" audioObjectName=\"Music\"/>\n"
+    "    <adm:audioTrackUID UID='ATU_00000001'/>\n"
+    "  </adm:audioFormatExtended>\n"
+    "</adm:ebuCoreMain>\n";
+  const std::string selectedAxml = selectAdmElements(axml, "AO_1001");
+  CHECK(contains(selectedAxml, "audioObjectID=\"AO_1001\""));
+  CHECK(contains(selectedAxml, "UID='ATU_00000001'"));
+  CHECK(!contains(selectedAxml, "AO_1002"));
+  CHECK(contains(selectedAxml, "</adm:audioFormatExtended>"));
+}
+
+void testMissingIds() {
+  // elements without ID are never referenced, so they are removed
+  const std::string elements = ELEMENTS + "    <audioObject audioObjectName=\"Anonymous\"/>\n";
+  const std::string axml = selectAdmElements(getAxml(elements), "AO_1001");
+  CHECK(contains(axml, "audioObjectID=\"AO_1001\""));
+  CHECK(!contains(axml, "Anonymous"));
+}
+
+void testMissingElements() {
+  // references to elements that are not in the document are ignored
+  const std::string elements = ELEMENTS +
+    "    <audioObject audioObjectID=\"AO_1005\" audioObjectName=\"Broken\">\n"
+    "      <audioObjectIDRef>AO_9999</audioObjectIDRef>\n"
+    "      <audioTrackUIDRef>ATU_00000002</audioTrackUIDRef>\n"
+    "    </audioObject>\n";
+  const std::string axml = selectAdmElements(getAxml(elements), "AO_1005");
+  CHECK(contains(axml, "audioObjectID=\"AO_1005\""));
+  CHECK(contains(axml, "ATU_00000002\"/>"));
+  CHECK(!contains(axml, "ATU_00000001\"/>"));
+
+  // an element that is not in the document selects nothing, so that the whole document gets parsed
+  CHECK_EQUAL(selectAdmElements(getAxml(ELEMENTS), "AO_9999"), std::string());
+}
+
+void testMalformedXml() {
+  CHECK_EQUAL(selectAdmElements(getAxml(ELEMENTS + "    <!-- unterminated comment\n"), "AO_1001"), std::string());
+  CHECK_EQUAL(selectAdmElements(getAxml(ELEMENTS + "    </audioObject>\n"), "AO_1001"), std::string());
+  CHECK_EQUAL(selectAdmElements(getAxml(ELEMENTS).substr(0, 200), "AO_1001"), std::string());
+}
+
+}
+
+int main() {
+  testReferencesAreFollowed();
+  testSelectedElementOnly();
+  testCommentsAndCharacterData();
+  testNamespacedTags();
+  testMissingIds();
+  testMissingElements();
+  testMalformedXml();
+  return test::getResult("adm_element_selection_test");
+}
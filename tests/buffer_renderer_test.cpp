@@ -0,0 +1,265 @@
+#include "adm_engine/buffer_renderer.hpp"
+
+#include "test_utils.hpp"
+
+#include <dirent.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using namespace admengine;
+
+namespace {
+
+const uint16_t NB_INPUT_CHANNELS = 2;
+const uint32_t SAMPLE_RATE = 48000;
+const size_t NB_FRAMES = 1000;
+const std::vector<std::string> OUTPUT_LAYOUTS = { "0+2+0", "0+5+0" };
+
+/// Stereo programme, whose tracks refer to the common definitions
+const std::string AXML =
+  "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+  "<ebuCoreMain xmlns=\"urn:ebu:metadata-schema:ebuCore_2014\">\n"
+  "  <coreMetadata><format><audioFormatExtended>\n"
+  "    <audioProgramme audioProgrammeID=\"APR_1001\" audioProgrammeName=\"Main\">\n"
+  "      <audioContentIDRef>ACO_1001</audioContentIDRef>\n"
+  "    </audioProgramme>\n"
+  "    <audioContent audioContentID=\"ACO_1001\" audioContentName=\"Main\">\n"
+  "      <audioObjectIDRef>AO_1001</audioObjectIDRef>\n"
+  "    </audioContent>\n"
+  "    <audioObject audioObjectID=\"AO_1001\" audioObjectName=\"Stereo\">\n"
+  "      <audioPackFormatIDRef>AP_00010002</audioPackFormatIDRef>\n"
+  "      <audioTrackUIDRef>ATU_00000001</audioTrackUIDRef>\n"
+  "      <audioTrackUIDRef>ATU_00000002</audioTrackUIDRef>\n"
+  "    </audioObject>\n"
+  "    <audioTrackUID UID=\"ATU_00000001\">\n"
+  "      <audioTrackFormatIDRef>AT_00010001_01</audioTrackFormatIDRef>\n"
+  "      <audioPackFormatIDRef>AP_00010002</audioPackFormatIDRef>\n"
+  "    </audioTrackUID>\n"
+  "    <audioTrackUID UID=\"ATU_00000002\">\n"
+  "      <audioTrackFormatIDRef>AT_00010002_01</audioTrackFormatIDRef>\n"
+  "      <audioPackFormatIDRef>AP_00010002</audioPackFormatIDRef>\n"
+  "    </audioTrackUID>\n"
+  "  </audioFormatExtended></format></coreMetadata>\n"
+  "</ebuCoreMain>\n";
+
+/// Object moving from the left to the right, by two blocks within the first processed frames
+const std::string OBJECTS_AXML =
+  "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+  "<ebuCoreMain xmlns=\"urn:ebu:metadata-schema:ebuCore_2014\">\n"
+  "  <coreMetadata><format><audioFormatExtended>\n"
+  "    <audioObject audioObjectID=\"AO_1001\" audioObjectName=\"Moving\">\n"
+  "      <audioPackFormatIDRef>AP_00031001</audioPackFormatIDRef>\n"
+  "      <audioTrackUIDRef>ATU_00000001</audioTrackUIDRef>\n"
+  "    </audioObject>\n"
+  "    <audioPackFormat audioPackFormatID=\"AP_00031001\" audioPackFormatName=\"Moving\" typeLabel=\"0003\" typeDefinition=\"Objects\">\n"
+  "      <audioChannelFormatIDRef>AC_00031001</audioChannelFormatIDRef>\n"
+  "    </audioPackFormat>\n"
+  "    <audioChannelFormat audioChannelFormatID=\"AC_00031001\" audioChannelFormatName=\"Moving\" typeLabel=\"0003\" typeDefinition=\"Objects\">\n"
+  "      <audioBlockFormat audioBlockFormatID=\"AB_00031001_00000001\" rtime=\"00:00:00.00000\" duration=\"00:00:00.00500\">\n"
+  "        <position coordinate=\"azimuth\">30.0</position>\n"
+  "        <position coordinate=\"elevation\">0.0</position>\n"
+  "        <position coordinate=\"distance\">1.0</position>\n"
+  "      </audioBlockFormat>\n"
+  "      <audioBlockFormat audioBlockFormatID=\"AB_00031001_00000002\" rtime=\"00:00:00.00500\" duration=\"00:00:00.00500\">\n"
+  "        <position coordinate=\"azimuth\">-30.0</position>\n"
+  "        <position coordinate=\"elevation\">0.0</position>\n"
+  "        <position coordinate=\"distance\">1.0</position>\n"
+  "      </audioBlockFormat>\n"
+  "    </audioChannelFormat>\n"
+  "    <audioStreamFormat audioStreamFormatID=\"AS_00031001\" audioStreamFormatName=\"Moving\" formatLabel=\"0001\" formatDefinition=\"PCM\">\n"
+  "      <audioChannelFormatIDRef>AC_00031001</audioChannelFormatIDRef>\n"
+  "      <audioTrackFormatIDRef>AT_00031001_01</audioTrackFormatIDRef>\n"
+  "    </audioStreamFormat>\n"
+  "    <audioTrackFormat audioTrackFormatID=\"AT_00031001_01\" audioTrackFormatName=\"Moving\" formatLabel=\"0001\" formatDefinition=\"PCM\">\n"
+  "      <audioStreamFormatIDRef>AS_00031001</audioStreamFormatIDRef>\n"
+  "    </audioTrackFormat>\n"
+  "    <audioTrackUID UID=\"ATU_00000001\">\n"
+  "      <audioTrackFormatIDRef>AT_00031001_01</audioTrackFormatIDRef>\n"
+  "      <audioPackFormatIDRef>AP_00031001</audioPackFormatIDRef>\n"
+  "    </audioTrackUID>\n"
+  "  </audioFormatExtended></format></coreMetadata>\n"
+  "</ebuCoreMain>\n";
+
+std::unique_ptr<BufferRenderer> createBufferRenderer(const std::string& elementId = "",
+                                                     const std::shared_ptr<RenderPlanCache>& renderPlanCache = nullptr) {
+  return std::unique_ptr<BufferRenderer>(new BufferRenderer(AXML.data(), AXML.size(), nullptr, 0, NB_INPUT_CHANNELS, SAMPLE_RATE,
+                                                            OUTPUT_LAYOUTS, {}, elementId, renderPlanCache));
+}
+
+/// Left channel at 0.5, right channel at -0.25
+std::vector<float> createInput() {
+  std::vector<float> input(NB_FRAMES * NB_INPUT_CHANNELS);
+  for (size_t frame = 0; frame < NB_FRAMES; ++frame) {
+    input[frame * NB_INPUT_CHANNELS] = 0.5;
+    input[frame * NB_INPUT_CHANNELS + 1] = -0.25;
+  }
+  return input;
+}
+
+/// Output blocks of every layout, filled with the given value
+std::vector<std::vector<float>> createOutputs(const BufferRenderer& renderer, const float value) {
+  std::vector<std::vector<float>> outputs;
+  for (size_t layoutIndex = 0; layoutIndex < renderer.getNbOutputLayouts(); ++layoutIndex) {
+    outputs.emplace_back(NB_FRAMES * renderer.getNbOutputChannels(layoutIndex), value);
+  }
+  return outputs;
+}
+
+void process(BufferRenderer& renderer, const std::vector<float>& input, std::vector<std::vector<float>>& outputs) {
+  std::vector<float*> outputBuffers;
+  for(std::vector<float>& output : outputs) {
+    outputBuffers.push_back(output.data());
+  }
+  renderer.process(input.data(), NB_FRAMES, outputBuffers.data());
+}
+
+size_t getNbFiles(const std::string& directory) {
+  size_t nbFiles = 0;
+  if(DIR* dir = opendir(directory.c_str())) {
+    while(const dirent* entry = readdir(dir)) {
+      if(entry->d_name[0] != '.') {
+        ++nbFiles;
+      }
+    }
+    closedir(dir);
+  }
+  return nbFiles;
+}
+
+void testFormat() {
+  const std::unique_ptr<BufferRenderer> renderer = createBufferRenderer();
+  CHECK_EQUAL(renderer->getElementId(), std::string("APR_1001"));
+  CHECK_EQUAL(renderer->getSampleRate(), SAMPLE_RATE);
+  CHECK_EQUAL(renderer->getNbInputChannels(), (size_t)NB_INPUT_CHANNELS);
+  CHECK_EQUAL(renderer->getNbOutputLayouts(), OUTPUT_LAYOUTS.size());
+  CHECK_EQUAL(renderer->getNbOutputChannels(0), (size_t)2);
+  CHECK_EQUAL(renderer->getNbOutputChannels(1), (size_t)6);
+  for (size_t layoutIndex = 0; layoutIndex < renderer->getNbOutputLayouts(); ++layoutIndex) {
+    CHECK(!renderer->getOutputAxmlData(layoutIndex).empty());
+    CHECK(!renderer->getOutputChnaData(layoutIndex).empty());
+  }
+  CHECK_EQUAL(renderer->getFramePosition(), (uint64_t)0);
+}
+
+void testElementSelection() {
+  CHECK_EQUAL(createBufferRenderer("AO_1001")->getElementId(), std::string("AO_1001"));
+  CHECK_THROWS(createBufferRenderer("AO_9999"), std::runtime_error);
+}
+
+void testProcess() {
+  const std::unique_ptr<BufferRenderer> renderer = createBufferRenderer();
+  const std::vector<float> input = createInput();
+  std::vector<std::vector<float>> outputs = createOutputs(*renderer, 0.0);
+  process(*renderer, input, outputs);
+  CHECK_EQUAL(renderer->getFramePosition(), (uint64_t)NB_FRAMES);
+  // stereo tracks are rendered as they are to a stereo layout
+  for (size_t frame = 0; frame < NB_FRAMES; ++frame) {
+    CHECK_CLOSE(outputs[0][frame * 2], 0.5, 1e-6);
+    CHECK_CLOSE(outputs[0][frame * 2 + 1], -0.25, 1e-6);
+  }
+}
+
+void testProcessOverwritesOutputs() {
+  const std::vector<float> input = createInput();
+  const std::unique_ptr<BufferRenderer> renderer = createBufferRenderer();
+  std::vector<std::vector<float>> expectedOutputs = createOutputs(*renderer, 0.0);
+  process(*renderer, input, expectedOutputs);
+
+  // caller buffers are not cleared before being rendered into
+  const std::unique_ptr<BufferRenderer> otherRenderer = createBufferRenderer();
+  std::vector<std::vector<float>> outputs = createOutputs(*otherRenderer, 1000.0);
+  process(*otherRenderer, input, outputs);
+  CHECK(outputs == expectedOutputs);
+}
+
+void testObjectsProcessOverwritesOutputs() {
+  // object gains ramp and jump within the block, which is rendered by several segments
+  const std::vector<float> input = createInput();
+  const std::unique_ptr<BufferRenderer> renderer(new BufferRenderer(OBJECTS_AXML.data(), OBJECTS_AXML.size(), nullptr, 0, NB_INPUT_CHANNELS, SAMPLE_RATE,
+                                                                    OUTPUT_LAYOUTS));
+  std::vector<std::vector<float>> expectedOutputs = createOutputs(*renderer, 0.0);
+  process(*renderer, input, expectedOutputs);
+  // the object moves from the left to the right, then ends within the block
+  CHECK(expectedOutputs[0][0] > expectedOutputs[0][1]);
+  CHECK(expectedOutputs[0][2 * 400] < expectedOutputs[0][2 * 400 + 1]);
+  CHECK_EQUAL(expectedOutputs[0][2 * (NB_FRAMES - 1)], 0.0f);
+
+  const std::unique_ptr<BufferRenderer> otherRenderer(new BufferRenderer(OBJECTS_AXML.data(), OBJECTS_AXML.size(), nullptr, 0, NB_INPUT_CHANNELS, SAMPLE_RATE,
+                                                                         OUTPUT_LAYOUTS));
+  std::vector<std::vector<float>> outputs = createOutputs(*otherRenderer, 1000.0);
+  process(*otherRenderer, input, outputs);
+  CHECK(outputs == expectedOutputs);
+}
+
+void testRender() {
+  const std::vector<float> input = createInput();
+  const std::unique_ptr<BufferRenderer> renderer = createBufferRenderer();
+  std::vector<std::vector<float>> expectedOutputs = createOutputs(*renderer, 0.0);
+  process(*renderer, input, expectedOutputs);
+
+  // pulled by blocks smaller than the input
+  const std::unique_ptr<BufferRenderer> pullRenderer = createBufferRenderer();
+  pullRenderer->setBlockSize(300);
+  size_t nbReadFrames = 0;
+  std::vector<std::vector<float>> outputs(pullRenderer->getNbOutputLayouts());
+  pullRenderer->render([&](float* buffer, const size_t nbFrames) {
+      const size_t nbBlockFrames = std::min(nbFrames, NB_FRAMES - nbReadFrames);
+      std::copy(input.begin() + nbReadFrames * NB_INPUT_CHANNELS, input.begin() + (nbReadFrames + nbBlockFrames) * NB_INPUT_CHANNELS, buffer);
+      nbReadFrames += nbBlockFrames;
+      return nbBlockFrames;
+    }, [&](const size_t layoutIndex, const float* buffer, const size_t nbFrames) {
+      outputs[layoutIndex].insert(outputs[layoutIndex].end(), buffer, buffer + nbFrames * pullRenderer->getNbOutputChannels(layoutIndex));
+    });
+  CHECK_EQUAL(pullRenderer->getFramePosition(), (uint64_t)NB_FRAMES);
+  CHECK(outputs == expectedOutputs);
+}
+
+void testRenderPlanCache() {
+  char directory[] = "/tmp/buffer_renderer_test_XXXXXX";
+  if(!mkdtemp(directory)) {
+    CHECK(false);
+    return;
+  }
+  // plans are computed at construction, so they are stored into the given cache
+  const std::shared_ptr<RenderPlanCache> renderPlanCache = std::make_shared<RenderPlanCache>(directory);
+  const std::unique_ptr<BufferRenderer> renderer = createBufferRenderer("", renderPlanCache);
+  const size_t nbCachedPlans = getNbFiles(directory);
+  CHECK_EQUAL(nbCachedPlans, OUTPUT_LAYOUTS.size());
+
+  // and loaded from it by the next renderers, that render the same
+  const std::vector<float> input = createInput();
+  std::vector<std::vector<float>> expectedOutputs = createOutputs(*renderer, 0.0);
+  process(*renderer, input, expectedOutputs);
+  const std::unique_ptr<BufferRenderer> cachedRenderer = createBufferRenderer("", renderPlanCache);
+  std::vector<std::vector<float>> outputs = createOutputs(*cachedRenderer, 0.0);
+  process(*cachedRenderer, input, outputs);
+  CHECK(outputs == expectedOutputs);
+  CHECK_EQUAL(getNbFiles(directory), nbCachedPlans);
+
+  if(DIR* dir = opendir(directory)) {
+    while(const dirent* entry = readdir(dir)) {
+      if(entry->d_name[0] != '.') {
+        unlink((std::string(directory) + "/" + entry->d_name).c_str());
+      }
+    }
+    closedir(dir);
+  }
+  rmdir(directory);
+}
+
+}
+
+int main() {
+  testFormat();
+  testElementSelection();
+  testProcess();
+  testProcessOverwritesOutputs();
+  testObjectsProcessOverwritesOutputs();
+  testRender();
+  testRenderPlanCache();
+  return test::getResult("buffer_renderer_test");
+}
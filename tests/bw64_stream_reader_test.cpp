@@ -0,0 +1,252 @@
+#include "adm_engine/bw64_stream_reader.hpp"
+
+#include "test_utils.hpp"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace admengine;
+
+namespace {
+
+const uint16_t NB_CHANNELS = 2;
+const uint32_t SAMPLE_RATE = 48000;
+const size_t NB_FRAMES = 4;
+const std::string AXML = "<ebuCoreMain/>";
+/// KSDATAFORMAT_SUBTYPE_IEEE_FLOAT, as stored in files
+const char FLOAT_SUB_FORMAT[16] = { 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, (char)0x80, 0x00, 0x00, (char)0xAA, 0x00, 0x38, (char)0x9B, 0x71 };
+
+void appendUint16(std::string& data, const uint16_t value) {
+  data.push_back((char)(value & 0xFF));
+  data.push_back((char)(value >> 8));
+}
+
+void appendUint32(std::string& data, const uint32_t value) {
+  appendUint16(data, value & 0xFFFF);
+  appendUint16(data, value >> 16);
+}
+
+void appendUint64(std::string& data, const uint64_t value) {
+  appendUint32(data, value & 0xFFFFFFFF);
+  appendUint32(data, value >> 32);
+}
+
+void appendChunk(std::string& data, const char* fourCC, const std::string& chunkData) {
+  data.append(fourCC, 4);
+  appendUint32(data, chunkData.size());
+  data += chunkData;
+  if(chunkData.size() % 2) {
+    data.push_back(0);
+  }
+}
+
+/// 'fmt ' chunk of 16-bit integer PCM frames
+std::string getPcmFormat() {
+  std::string format;
+  appendUint16(format, 1);
+  appendUint16(format, NB_CHANNELS);
+  appendUint32(format, SAMPLE_RATE);
+  appendUint32(format, SAMPLE_RATE * NB_CHANNELS * 2);
+  appendUint16(format, NB_CHANNELS * 2);
+  appendUint16(format, 16);
+  return format;
+}
+
+/// Extensible 'fmt ' chunk of 32-bit float frames, of the given sub-format
+std::string getExtensibleFormat(const char* subFormat) {
+  std::string format;
+  appendUint16(format, 0xFFFE);
+  appendUint16(format, NB_CHANNELS);
+  appendUint32(format, SAMPLE_RATE);
+  appendUint32(format, SAMPLE_RATE * NB_CHANNELS * 4);
+  appendUint16(format, NB_CHANNELS * 4);
+  appendUint16(format, 32);
+  appendUint16(format, 22);
+  appendUint16(format, 32);
+  appendUint32(format, 0x3); // front left and right
+  format.append(subFormat, 16);
+  return format;
+}
+
+/// Frames whose left channel is at frame / 8, and right channel is its opposite
+std::string getPcmData(const size_t nbFrames = NB_FRAMES) {
+  std::string data;
+  for (size_t frame = 0; frame < nbFrames; ++frame) {
+    appendUint16(data, (uint16_t)(frame * 4096));
+    appendUint16(data, (uint16_t)-(int16_t)(frame * 4096));
+  }
+  return data;
+}
+
+std::string getRiffFile(const std::string& chunks) {
+  std::string file = "RIFF";
+  appendUint32(file, 4 + chunks.size());
+  return file + "WAVE" + chunks;
+}
+
+/// Temporary file, removed on destruction
+class TemporaryFile {
+public:
+  TemporaryFile(const std::string& data) {
+    char path[] = "/tmp/bw64_stream_reader_test_XXXXXX";
+    const int fileDescriptor = mkstemp(path);
+    if(fileDescriptor < 0 || write(fileDescriptor, data.data(), data.size()) != (ssize_t)data.size()) {
+      throw std::runtime_error("Could not write temporary file.");
+    }
+    close(fileDescriptor);
+    _path = path;
+  }
+  ~TemporaryFile() { unlink(_path.c_str()); }
+  const std::string& getPath() const { return _path; }
+
+private:
+  std::string _path;
+};
+
+/// Read all the frames of both channels, by blocks of 3 frames
+std::vector<float> readFrames(Bw64StreamReader& reader) {
+  std::vector<float> frames;
+  std::vector<float> buffer(3 * NB_CHANNELS);
+  while(const uint64_t nbReadFrames = reader.read(buffer.data(), 3, { 0, 1 })) {
+    frames.insert(frames.end(), buffer.begin(), buffer.begin() + nbReadFrames * NB_CHANNELS);
+  }
+  return frames;
+}
+
+void checkFrames(const std::vector<float>& frames, const size_t nbFrames) {
+  CHECK_EQUAL(frames.size(), nbFrames * NB_CHANNELS);
+  for (size_t frame = 0; frame < nbFrames && frame * NB_CHANNELS < frames.size(); ++frame) {
+    CHECK_EQUAL(frames[frame * NB_CHANNELS], frame / 8.0f);
+    CHECK_EQUAL(frames[frame * NB_CHANNELS + 1], -(frame / 8.0f));
+  }
+}
+
+void testAxmlBeforeData() {
+  std::string chunks;
+  appendChunk(chunks, "fmt ", getPcmFormat());
+  appendChunk(chunks, "axml", AXML);
+  appendChunk(chunks, "data", getPcmData());
+  const TemporaryFile file(getRiffFile(chunks));
+  Bw64StreamReader reader(file.getPath());
+  CHECK_EQUAL(reader.channels(), NB_CHANNELS);
+  CHECK_EQUAL(reader.sampleRate(), SAMPLE_RATE);
+  CHECK_EQUAL(reader.bitDepth(), (uint16_t)16);
+  CHECK_EQUAL(reader.numberOfFrames(), (uint64_t)NB_FRAMES);
+  CHECK(reader.axmlChunk() != nullptr);
+  CHECK_EQUAL(reader.axmlChunk()->data(), AXML);
+  checkFrames(readFrames(reader), NB_FRAMES);
+}
+
+void testAxmlAfterData() {
+  // the audio data is buffered to reach the 'axml' chunk, unless it is too large
+  std::string chunks;
+  appendChunk(chunks, "fmt ", getPcmFormat());
+  appendChunk(chunks, "data", getPcmData());
+  appendChunk(chunks, "axml", AXML);
+  const TemporaryFile file(getRiffFile(chunks));
+  Bw64StreamReader reader(file.getPath());
+  CHECK_EQUAL(reader.numberOfFrames(), (uint64_t)NB_FRAMES);
+  CHECK(reader.axmlChunk() != nullptr);
+  CHECK_EQUAL(reader.axmlChunk()->data(), AXML);
+  checkFrames(readFrames(reader), NB_FRAMES);
+  CHECK_THROWS(Bw64StreamReader(file.getPath(), NB_FRAMES), std::runtime_error);
+
+  std::string chunksWithoutAxml;
+  appendChunk(chunksWithoutAxml, "fmt ", getPcmFormat());
+  appendChunk(chunksWithoutAxml, "data", getPcmData());
+  const TemporaryFile fileWithoutAxml(getRiffFile(chunksWithoutAxml));
+  CHECK_THROWS(Bw64StreamReader(fileWithoutAxml.getPath()), std::runtime_error);
+}
+
+void testUnknownDataSize() {
+  // as written by streaming encoders, to be read up to the end of the stream
+  std::string ds64;
+  appendUint64(ds64, 0xFFFFFFFFFFFFFFFF);
+  appendUint64(ds64, 0xFFFFFFFFFFFFFFFF);
+  appendUint64(ds64, 0xFFFFFFFFFFFFFFFF);
+  appendUint32(ds64, 0);
+  std::string file = "RF64";
+  appendUint32(file, 0xFFFFFFFF);
+  file += "WAVE";
+  appendChunk(file, "ds64", ds64);
+  appendChunk(file, "fmt ", getPcmFormat());
+  appendChunk(file, "axml", AXML);
+  file += "data";
+  appendUint32(file, 0xFFFFFFFF);
+  file += getPcmData();
+  const TemporaryFile rf64File(file);
+  Bw64StreamReader reader(rf64File.getPath());
+  CHECK_EQUAL(reader.numberOfFrames(), (uint64_t)0);
+  checkFrames(readFrames(reader), NB_FRAMES);
+
+  // unless the 'axml' chunk follows the audio data
+  std::string chunks;
+  appendChunk(chunks, "fmt ", getPcmFormat());
+  chunks += "data";
+  appendUint32(chunks, 0);
+  chunks += getPcmData();
+  appendChunk(chunks, "axml", AXML);
+  const TemporaryFile riffFile(getRiffFile(chunks));
+  CHECK_THROWS(Bw64StreamReader(riffFile.getPath()), std::runtime_error);
+}
+
+void testTruncatedStream() {
+  // the data chunk ends on the last whole frame of the stream
+  std::string chunks;
+  appendChunk(chunks, "fmt ", getPcmFormat());
+  appendChunk(chunks, "axml", AXML);
+  chunks += "data";
+  appendUint32(chunks, 10 * NB_CHANNELS * 2);
+  chunks += getPcmData() + std::string(2, 1);
+  const TemporaryFile file(getRiffFile(chunks));
+  Bw64StreamReader reader(file.getPath());
+  CHECK_EQUAL(reader.numberOfFrames(), (uint64_t)10);
+  checkFrames(readFrames(reader), NB_FRAMES);
+
+  // truncated within its header
+  const TemporaryFile headerFile(getRiffFile(chunks).substr(0, 30));
+  CHECK_THROWS(Bw64StreamReader(headerFile.getPath()), std::runtime_error);
+}
+
+void testExtensibleFormat() {
+  // samples are told by the sub-format of an extensible format
+  std::string data;
+  for (size_t frame = 0; frame < NB_FRAMES; ++frame) {
+    const float samples[NB_CHANNELS] = { frame / 8.0f, -(frame / 8.0f) };
+    data.append(reinterpret_cast<const char*>(samples), sizeof(samples));
+  }
+  std::string chunks;
+  appendChunk(chunks, "fmt ", getExtensibleFormat(FLOAT_SUB_FORMAT));
+  appendChunk(chunks, "axml", AXML);
+  appendChunk(chunks, "data", data);
+  const TemporaryFile file(getRiffFile(chunks));
+  Bw64StreamReader reader(file.getPath());
+  CHECK_EQUAL(reader.bitDepth(), (uint16_t)32);
+  checkFrames(readFrames(reader), NB_FRAMES);
+
+  char unknownSubFormat[16];
+  std::copy(FLOAT_SUB_FORMAT, FLOAT_SUB_FORMAT + 16, unknownSubFormat);
+  unknownSubFormat[15] = 0;
+  std::string unknownChunks;
+  appendChunk(unknownChunks, "fmt ", getExtensibleFormat(unknownSubFormat));
+  appendChunk(unknownChunks, "axml", AXML);
+  appendChunk(unknownChunks, "data", data);
+  const TemporaryFile unknownFile(getRiffFile(unknownChunks));
+  CHECK_THROWS(Bw64StreamReader(unknownFile.getPath()), std::runtime_error);
+}
+
+}
+
+int main() {
+  testAxmlBeforeData();
+  testAxmlAfterData();
+  testUnknownDataSize();
+  testTruncatedStream();
+  testExtensibleFormat();
+  return test::getResult("bw64_stream_reader_test");
+}
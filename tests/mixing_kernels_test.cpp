@@ -0,0 +1,116 @@
+#include "adm_engine/mixing_kernels.hpp"
+
+#include "test_utils.hpp"
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace admengine;
+
+namespace {
+
+const size_t NB_INPUT_CHANNELS = 11;
+/// Selected input tracks, out of order and with gaps
+const std::vector<size_t> INPUT_TRACK_IDS = { 0, 3, 4, 7, 10, 2, 9 };
+
+/// Fixed-width kernels (see mixing_kernels_impl.hpp), and widths of the generic kernel
+const size_t OUTPUT_WIDTHS[] = { 2, 6, 8, 10, 12, 24, 1, 3, 5, 16, 17, 32 };
+/// Block lengths, with tails that do not fill a whole vector
+const size_t BLOCK_LENGTHS[] = { 1, 3, 7, 16, 61, 256 };
+
+std::vector<float> getRandomSamples(std::mt19937& generator, const size_t nbSamples) {
+  std::uniform_real_distribution<float> distribution(-1.0, 1.0);
+  std::vector<float> samples(nbSamples);
+  for(float& sample : samples) {
+    sample = distribution(generator);
+  }
+  return samples;
+}
+
+/// Gains of each selected track, padded with zeros up to the gain stride
+std::vector<float> getRandomGains(std::mt19937& generator, const size_t nbOutputChannels, const size_t gainStride) {
+  std::vector<float> gains(INPUT_TRACK_IDS.size() * gainStride, 0.0);
+  const std::vector<float> values = getRandomSamples(generator, gains.size());
+  for (size_t i = 0; i < INPUT_TRACK_IDS.size(); ++i) {
+    std::copy(values.begin() + i * gainStride, values.begin() + i * gainStride + nbOutputChannels, gains.begin() + i * gainStride);
+  }
+  return gains;
+}
+
+bool isBitIdentical(const std::vector<float>& actual, const std::vector<float>& expected) {
+  return actual.size() == expected.size() && std::memcmp(actual.data(), expected.data(), actual.size() * sizeof(float)) == 0;
+}
+
+void testMixingKernel(const SimdLevel simdLevel, const size_t nbOutputChannels, const size_t nbFrames, const bool accumulate) {
+  std::mt19937 generator(nbOutputChannels * 1000 + nbFrames);
+  const size_t gainStride = getMixingGainStride(nbOutputChannels);
+  const std::vector<float> input = getRandomSamples(generator, nbFrames * NB_INPUT_CHANNELS);
+  const std::vector<float> gains = getRandomGains(generator, nbOutputChannels, gainStride);
+  std::vector<float> expected = getRandomSamples(generator, nbFrames * nbOutputChannels);
+  std::vector<float> actual = expected;
+
+  mixScalar(nbFrames, input.data(), NB_INPUT_CHANNELS, INPUT_TRACK_IDS.data(), INPUT_TRACK_IDS.size(),
+            gains.data(), gainStride, expected.data(), nbOutputChannels, accumulate);
+  const MixingKernel kernel = getMixingKernel(nbOutputChannels, simdLevel);
+  kernel(nbFrames, input.data(), NB_INPUT_CHANNELS, INPUT_TRACK_IDS.data(), INPUT_TRACK_IDS.size(),
+         gains.data(), gainStride, actual.data(), nbOutputChannels, accumulate);
+
+  if(!isBitIdentical(actual, expected)) {
+    std::cerr << formatSimdLevel(simdLevel) << " mixing kernel differs from the scalar one: " << nbOutputChannels << " output channels, "
+              << nbFrames << " frames, " << (accumulate ? "accumulated" : "overwritten") << std::endl;
+  }
+  CHECK(isBitIdentical(actual, expected));
+}
+
+void testRampMixingKernel(const SimdLevel simdLevel, const size_t nbOutputChannels, const size_t nbFrames, const bool accumulate) {
+  std::mt19937 generator(nbOutputChannels * 1000 + nbFrames + 1);
+  const size_t gainStride = getMixingGainStride(nbOutputChannels);
+  const std::vector<float> input = getRandomSamples(generator, nbFrames * NB_INPUT_CHANNELS);
+  const std::vector<float> gains = getRandomGains(generator, nbOutputChannels, gainStride);
+  std::vector<float> gainSteps = getRandomGains(generator, nbOutputChannels, gainStride);
+  for(float& gainStep : gainSteps) {
+    gainStep /= 1000;
+  }
+  std::vector<const float*> trackGains;
+  std::vector<const float*> trackGainSteps;
+  std::vector<size_t> rampPositions;
+  for (size_t i = 0; i < INPUT_TRACK_IDS.size(); ++i) {
+    trackGains.push_back(gains.data() + i * gainStride);
+    trackGainSteps.push_back(gainSteps.data() + i * gainStride);
+    rampPositions.push_back(i * 37);
+  }
+  std::vector<float> expected = getRandomSamples(generator, nbFrames * nbOutputChannels);
+  std::vector<float> actual = expected;
+
+  mixRampScalar(nbFrames, input.data(), NB_INPUT_CHANNELS, INPUT_TRACK_IDS.data(), INPUT_TRACK_IDS.size(),
+                trackGains.data(), trackGainSteps.data(), rampPositions.data(), expected.data(), nbOutputChannels, accumulate);
+  const RampMixingKernel kernel = getRampMixingKernel(simdLevel);
+  kernel(nbFrames, input.data(), NB_INPUT_CHANNELS, INPUT_TRACK_IDS.data(), INPUT_TRACK_IDS.size(),
+         trackGains.data(), trackGainSteps.data(), rampPositions.data(), actual.data(), nbOutputChannels, accumulate);
+
+  if(!isBitIdentical(actual, expected)) {
+    std::cerr << formatSimdLevel(simdLevel) << " ramp mixing kernel differs from the scalar one: " << nbOutputChannels << " output channels, "
+              << nbFrames << " frames, " << (accumulate ? "accumulated" : "overwritten") << std::endl;
+  }
+  CHECK(isBitIdentical(actual, expected));
+}
+
+}
+
+int main() {
+  // only the instruction sets of the running CPU can be tested
+  const SimdLevel maxSimdLevel = getSimdLevel();
+  std::cout << "Testing mixing kernels up to " << formatSimdLevel(maxSimdLevel) << std::endl;
+  for (int level = (int)SimdLevel::SCALAR; level <= (int)maxSimdLevel; ++level) {
+    for(const size_t nbOutputChannels : OUTPUT_WIDTHS) {
+      for(const size_t nbFrames : BLOCK_LENGTHS) {
+        for(const bool accumulate : { true, false }) {
+          testMixingKernel((SimdLevel)level, nbOutputChannels, nbFrames, accumulate);
+          testRampMixingKernel((SimdLevel)level, nbOutputChannels, nbFrames, accumulate);
+        }
+      }
+    }
+  }
+  return test::getResult("mixing_kernels_test");
+}
@@ -0,0 +1,117 @@
+#include "adm_engine/audio_object_renderer.hpp"
+
+#include "test_utils.hpp"
+
+#include <vector>
+
+using namespace admengine;
+
+namespace {
+
+const size_t NB_OUTPUT_CHANNELS = 2;
+const size_t INPUT_TRACK_ID = 0;
+
+BlockGains createBlockGains(const uint64_t start, const uint64_t end, const float gain, const uint64_t interpolationLength = 0) {
+  return BlockGains{ BlockSpan{ start, end, 0 }, interpolationLength, std::vector<float>(NB_OUTPUT_CHANNELS, gain) };
+}
+
+RenderPlan createRenderPlan(const std::vector<BlockGains>& blockGains, const uint64_t objectStart, const uint64_t objectEnd) {
+  RenderPlan renderPlan(NB_OUTPUT_CHANNELS);
+  renderPlan.setInputTrackGains(INPUT_TRACK_ID, getObjectGainPoints(blockGains, objectStart, objectEnd, NB_OUTPUT_CHANNELS));
+  return renderPlan;
+}
+
+float getGain(const RenderPlan& renderPlan, const uint64_t framePosition) {
+  return renderPlan.getGain(INPUT_TRACK_ID, 0, framePosition);
+}
+
+void testSilentOutsideObject() {
+  // blocks are relative to the object start, the last one lasting until the object end
+  const std::vector<BlockGains> blockGains = {
+    createBlockGains(0, 1000, 0.5),
+    createBlockGains(1000, 2000, 0.5),
+    createBlockGains(2000, UNBOUNDED_FRAME, 0.5)
+  };
+  const RenderPlan renderPlan = createRenderPlan(blockGains, 1000, 4000);
+  CHECK_EQUAL(getGain(renderPlan, 0), 0.0f);
+  CHECK_EQUAL(getGain(renderPlan, 999), 0.0f);
+  CHECK_EQUAL(getGain(renderPlan, 1000), 0.5f);
+  CHECK_EQUAL(getGain(renderPlan, 3999), 0.5f);
+  CHECK_EQUAL(getGain(renderPlan, 4000), 0.0f);
+  CHECK_EQUAL(getGain(renderPlan, 100000), 0.0f);
+}
+
+void testSilentOutsideBlocks() {
+  const std::vector<BlockGains> blockGains = {
+    createBlockGains(100, 200, 0.5),
+    createBlockGains(300, 400, 0.25)
+  };
+  const RenderPlan renderPlan = createRenderPlan(blockGains, 0, UNBOUNDED_FRAME);
+  CHECK_EQUAL(getGain(renderPlan, 0), 0.0f);
+  CHECK_EQUAL(getGain(renderPlan, 100), 0.5f);
+  CHECK_EQUAL(getGain(renderPlan, 199), 0.5f);
+  CHECK_EQUAL(getGain(renderPlan, 200), 0.0f);
+  CHECK_EQUAL(getGain(renderPlan, 299), 0.0f);
+  CHECK_EQUAL(getGain(renderPlan, 300), 0.25f);
+  CHECK_EQUAL(getGain(renderPlan, 400), 0.0f);
+}
+
+void testBlocksClippedToObject() {
+  // the object ends within the ramp of its second block
+  const std::vector<BlockGains> blockGains = {
+    createBlockGains(0, 100, 0.0),
+    createBlockGains(100, 300, 1.0, 200)
+  };
+  const RenderPlan renderPlan = createRenderPlan(blockGains, 50, 250);
+  CHECK_EQUAL(getGain(renderPlan, 150), 0.0f);
+  CHECK_CLOSE(getGain(renderPlan, 200), 0.25, 1e-6);
+  CHECK(getGain(renderPlan, 249) > 0.0f);
+  CHECK_EQUAL(getGain(renderPlan, 250), 0.0f);
+  CHECK_EQUAL(getGain(renderPlan, 300), 0.0f);
+}
+
+void testBlocksOutsideObject() {
+  const std::vector<BlockGains> blockGains = { createBlockGains(1000, 2000, 0.5) };
+  const RenderPlan renderPlan = createRenderPlan(blockGains, 0, 500);
+  CHECK_EQUAL(getGain(renderPlan, 0), 0.0f);
+  CHECK_EQUAL(getGain(renderPlan, 1500), 0.0f);
+}
+
+void testUnboundedObject() {
+  // a single block over the whole rendering needs a single gain point
+  const std::vector<BlockGains> blockGains = { createBlockGains(0, UNBOUNDED_FRAME, 0.5) };
+  const std::vector<GainPoint> gainPoints = getObjectGainPoints(blockGains, 0, UNBOUNDED_FRAME, NB_OUTPUT_CHANNELS);
+  CHECK_EQUAL(gainPoints.size(), (size_t)1);
+  CHECK_EQUAL(gainPoints.front().frame, (uint64_t)0);
+
+  const RenderPlan renderPlan = createRenderPlan(blockGains, 480, UNBOUNDED_FRAME);
+  CHECK_EQUAL(getGain(renderPlan, 479), 0.0f);
+  CHECK_EQUAL(getGain(renderPlan, 480), 0.5f);
+  CHECK_EQUAL(getGain(renderPlan, 1000000), 0.5f);
+}
+
+void testProcessOverwritesOutput() {
+  // object tracks only, whose gains jump within the block, rendered into buffers holding a previous block
+  RenderPlan renderPlan(NB_OUTPUT_CHANNELS);
+  renderPlan.setInputTrackGains(INPUT_TRACK_ID, { GainPoint{ 0, { 1.0, 0.0 } }, GainPoint{ 4, { 1.0, 0.0 } }, GainPoint{ 4, { 0.0, 1.0 } } });
+  const size_t nbFrames = 8;
+  const std::vector<float> input(nbFrames, 0.5);
+  std::vector<float> output(nbFrames * NB_OUTPUT_CHANNELS, 123.0);
+  renderPlan.process(0, nbFrames, input.data(), 1, output.data(), false);
+  for (size_t frame = 0; frame < nbFrames; ++frame) {
+    CHECK_EQUAL(output[frame * NB_OUTPUT_CHANNELS], frame < 4 ? 0.5f : 0.0f);
+    CHECK_EQUAL(output[frame * NB_OUTPUT_CHANNELS + 1], frame < 4 ? 0.0f : 0.5f);
+  }
+}
+
+}
+
+int main() {
+  testSilentOutsideObject();
+  testSilentOutsideBlocks();
+  testBlocksClippedToObject();
+  testBlocksOutsideObject();
+  testUnboundedObject();
+  testProcessOverwritesOutput();
+  return test::getResult("object_gains_test");
+}
@@ -0,0 +1,129 @@
+#include "adm_engine/realtime_renderer.hpp"
+
+#include "test_utils.hpp"
+
+#include <string>
+#include <vector>
+
+using namespace admengine;
+
+namespace {
+
+const uint16_t NB_INPUT_CHANNELS = 2;
+const uint32_t SAMPLE_RATE = 48000;
+const size_t NB_FRAMES = 2000;
+const size_t RAMP_LENGTH = 100;
+
+/// Stereo programme, whose tracks refer to the common definitions
+const std::string AXML =
+  "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+  "<ebuCoreMain xmlns=\"urn:ebu:metadata-schema:ebuCore_2014\">\n"
+  "  <coreMetadata><format><audioFormatExtended>\n"
+  "    <audioProgramme audioProgrammeID=\"APR_1001\" audioProgrammeName=\"Main\">\n"
+  "      <audioContentIDRef>ACO_1001</audioContentIDRef>\n"
+  "    </audioProgramme>\n"
+  "    <audioContent audioContentID=\"ACO_1001\" audioContentName=\"Main\">\n"
+  "      <audioObjectIDRef>AO_1001</audioObjectIDRef>\n"
+  "    </audioContent>\n"
+  "    <audioObject audioObjectID=\"AO_1001\" audioObjectName=\"Stereo\">\n"
+  "      <audioPackFormatIDRef>AP_00010002</audioPackFormatIDRef>\n"
+  "      <audioTrackUIDRef>ATU_00000001</audioTrackUIDRef>\n"
+  "      <audioTrackUIDRef>ATU_00000002</audioTrackUIDRef>\n"
+  "    </audioObject>\n"
+  "    <audioTrackUID UID=\"ATU_00000001\">\n"
+  "      <audioTrackFormatIDRef>AT_00010001_01</audioTrackFormatIDRef>\n"
+  "      <audioPackFormatIDRef>AP_00010002</audioPackFormatIDRef>\n"
+  "    </audioTrackUID>\n"
+  "    <audioTrackUID UID=\"ATU_00000002\">\n"
+  "      <audioTrackFormatIDRef>AT_00010002_01</audioTrackFormatIDRef>\n"
+  "      <audioPackFormatIDRef>AP_00010002</audioPackFormatIDRef>\n"
+  "    </audioTrackUID>\n"
+  "  </audioFormatExtended></format></coreMetadata>\n"
+  "</ebuCoreMain>\n";
+
+std::unique_ptr<RealtimeRenderer> createRealtimeRenderer(const std::map<std::string, float>& elementGains = {}) {
+  std::unique_ptr<RealtimeRenderer> renderer(new RealtimeRenderer(AXML.data(), AXML.size(), nullptr, 0, NB_INPUT_CHANNELS, SAMPLE_RATE,
+                                                                  { "0+2+0" }, elementGains));
+  renderer->setGainRampLength(RAMP_LENGTH);
+  return renderer;
+}
+
+/// Left output channel of the rendered frames, whose left input channel is at 1.0
+std::vector<float> process(RealtimeRenderer& renderer) {
+  const std::vector<float> input(NB_FRAMES * NB_INPUT_CHANNELS, 1.0);
+  std::vector<float> output(NB_FRAMES * 2);
+  float* outputs[] = { output.data() };
+  renderer.process(input.data(), outputs, NB_FRAMES);
+  std::vector<float> leftOutput(NB_FRAMES);
+  for (size_t frame = 0; frame < NB_FRAMES; ++frame) {
+    leftOutput[frame] = output[frame * 2];
+  }
+  return leftOutput;
+}
+
+void testInitialGains() {
+  // gains of the object, content and programme are multiplied, from the first frame
+  const std::unique_ptr<RealtimeRenderer> renderer = createRealtimeRenderer({ { "AO_1001", 0.5 }, { "APR_1001", 0.5 } });
+  const std::vector<float> output = process(*renderer);
+  CHECK_CLOSE(output[0], 0.25, 1e-6);
+  CHECK_CLOSE(output[NB_FRAMES - 1], 0.25, 1e-6);
+  CHECK_EQUAL(renderer->getFramePosition(), (uint64_t)NB_FRAMES);
+  CHECK_THROWS(renderer->setElementGain("AO_9999", 0.0), std::runtime_error);
+}
+
+void testGainRamp() {
+  const std::unique_ptr<RealtimeRenderer> renderer = createRealtimeRenderer();
+  CHECK(renderer->setElementGain("AO_1001", 0.0, 1000));
+  const std::vector<float> output = process(*renderer);
+  // the ramp starts at its frame position, and reaches its gain after its length
+  CHECK_CLOSE(output[999], 1.0, 1e-6);
+  CHECK_CLOSE(output[1000], 1.0 - 1.0 / RAMP_LENGTH, 1e-6);
+  CHECK_CLOSE(output[1000 + RAMP_LENGTH / 2 - 1], 0.5, 1e-6);
+  CHECK_CLOSE(output[1000 + RAMP_LENGTH - 1], 0.0, 1e-6);
+  CHECK_EQUAL(output[1000 + RAMP_LENGTH], 0.0f);
+  CHECK_EQUAL(output[NB_FRAMES - 1], 0.0f);
+}
+
+void testGainChangeOrder() {
+  // a change set after a later one still applies at its own frame position
+  const std::unique_ptr<RealtimeRenderer> renderer = createRealtimeRenderer();
+  renderer->setGainRampLength(0);
+  CHECK(renderer->setElementGain("AO_1001", 0.25, 1500));
+  CHECK(renderer->setElementGain("ACO_1001", 0.5, 500));
+  const std::vector<float> output = process(*renderer);
+  CHECK_EQUAL(output[499], 1.0f);
+  CHECK_EQUAL(output[500], 0.5f);
+  CHECK_EQUAL(output[1499], 0.5f);
+  CHECK_EQUAL(output[1500], 0.125f);
+
+  // changes at the same position apply in the order they are set
+  CHECK(renderer->setElementGain("AO_1001", 0.0, 2500));
+  CHECK(renderer->setElementGain("AO_1001", 1.0, 2500));
+  // already rendered positions apply to the next frame
+  CHECK(renderer->setElementGain("ACO_1001", 1.0, 0));
+  const std::vector<float> nextOutput = process(*renderer);
+  CHECK_EQUAL(nextOutput[0], 0.25f);
+  CHECK_EQUAL(nextOutput[499], 0.25f);
+  CHECK_EQUAL(nextOutput[500], 1.0f);
+}
+
+void testFullGainQueue() {
+  const std::unique_ptr<RealtimeRenderer> renderer(new RealtimeRenderer(AXML.data(), AXML.size(), nullptr, 0, NB_INPUT_CHANNELS, SAMPLE_RATE,
+                                                                        { "0+2+0" }, {}, "", DEFAULT_REALTIME_BLOCK_SIZE, 2));
+  CHECK(renderer->setElementGain("AO_1001", 0.5));
+  CHECK(renderer->setElementGain("AO_1001", 0.5));
+  CHECK(!renderer->setElementGain("AO_1001", 0.5));
+  // the queue is emptied by the audio thread
+  process(*renderer);
+  CHECK(renderer->setElementGain("AO_1001", 0.5));
+}
+
+}
+
+int main() {
+  testInitialGains();
+  testGainRamp();
+  testGainChangeOrder();
+  testFullGainQueue();
+  return test::getResult("realtime_renderer_test");
+}
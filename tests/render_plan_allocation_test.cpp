@@ -0,0 +1,107 @@
+#include "adm_engine/render_plan.hpp"
+
+#include "test_utils.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+namespace {
+
+std::atomic<size_t> nbAllocations(0);
+
+}
+
+// every heap allocation of the test process is counted
+void* operator new(size_t size) {
+  ++nbAllocations;
+  if(void* pointer = std::malloc(size ? size : 1)) {
+    return pointer;
+  }
+  throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+// inlined into the test, these free the pointers of the operator new above, which GCC reports as mismatched
+#pragma GCC diagnostic push
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void* pointer) noexcept {
+  std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+  std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+  std::free(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept {
+  std::free(pointer);
+}
+#pragma GCC diagnostic pop
+
+using namespace admengine;
+
+namespace {
+
+const size_t NB_INPUT_CHANNELS = 8;
+const size_t BLOCK_SIZE = 256;
+const size_t NB_WARM_UP_BLOCKS = 4;
+const size_t NB_BLOCKS = 1000;
+
+/// Plan mixing constant gains (as DirectSpeakers and HOA) and time-varying gains (as Objects)
+RenderPlan createRenderPlan(const size_t nbOutputChannels) {
+  RenderPlan renderPlan(nbOutputChannels);
+  for (size_t inputTrackId = 0; inputTrackId < 4; ++inputTrackId) {
+    std::vector<float> gains(nbOutputChannels, 0.0);
+    gains[inputTrackId % nbOutputChannels] = 1.0;
+    renderPlan.setInputTrackGains(inputTrackId, gains);
+  }
+  for (size_t inputTrackId = 4; inputTrackId < NB_INPUT_CHANNELS; ++inputTrackId) {
+    std::vector<GainPoint> gainPoints;
+    for (uint64_t frame = 0; frame < NB_BLOCKS * BLOCK_SIZE; frame += 1000) {
+      std::vector<float> gains(nbOutputChannels, 0.0);
+      gains[(frame / 1000 + inputTrackId) % nbOutputChannels] = 0.5;
+      gainPoints.push_back(GainPoint{ frame, gains });
+      gainPoints.push_back(GainPoint{ frame + 100, gains });
+    }
+    renderPlan.setInputTrackGains(inputTrackId, gainPoints);
+  }
+  return renderPlan;
+}
+
+void testProcessDoesNotAllocate(const size_t nbOutputChannels) {
+  const RenderPlan renderPlan = createRenderPlan(nbOutputChannels);
+  std::vector<float> input(BLOCK_SIZE * NB_INPUT_CHANNELS, 0.25);
+  std::vector<float> output(BLOCK_SIZE * nbOutputChannels);
+
+  uint64_t framePosition = 0;
+  for (size_t block = 0; block < NB_WARM_UP_BLOCKS; ++block) {
+    renderPlan.process(framePosition, BLOCK_SIZE, input.data(), NB_INPUT_CHANNELS, output.data(), false);
+    framePosition += BLOCK_SIZE;
+  }
+
+  const size_t nbAllocationsBefore = nbAllocations.load();
+  for (size_t block = NB_WARM_UP_BLOCKS; block < NB_BLOCKS; ++block) {
+    renderPlan.process(framePosition, BLOCK_SIZE, input.data(), NB_INPUT_CHANNELS, output.data(), false);
+    framePosition += BLOCK_SIZE;
+  }
+  CHECK_EQUAL(nbAllocations.load() - nbAllocationsBefore, (size_t)0);
+}
+
+}
+
+int main() {
+  for(const size_t nbOutputChannels : { 2, 6, 8, 10, 12, 24 }) {
+    testProcessDoesNotAllocate(nbOutputChannels);
+  }
+  return test::getResult("render_plan_allocation_test");
+}
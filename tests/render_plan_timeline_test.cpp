@@ -0,0 +1,110 @@
+#include "adm_engine/render_plan.hpp"
+
+#include "test_utils.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace admengine;
+
+namespace {
+
+const size_t NB_INPUT_CHANNELS = 4;
+const size_t NB_OUTPUT_CHANNELS = 6;
+const size_t NB_FRAMES = 8000;
+const float SENTINEL_SAMPLE = 1000.0;
+
+/// Plan of ramps and jumps, with several gain points within some blocks
+RenderPlan createRenderPlan() {
+  RenderPlan renderPlan(NB_OUTPUT_CHANNELS);
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<float> gainDistribution(0.0, 1.0);
+  std::uniform_int_distribution<uint64_t> lengthDistribution(0, 300);
+  for (size_t inputTrackId = 0; inputTrackId < NB_INPUT_CHANNELS; ++inputTrackId) {
+    std::vector<GainPoint> gainPoints;
+    for (uint64_t frame = 100 * inputTrackId; frame < NB_FRAMES; frame += lengthDistribution(generator)) {
+      std::vector<float> gains(NB_OUTPUT_CHANNELS);
+      for(float& gain : gains) {
+        gain = gainDistribution(generator);
+      }
+      gainPoints.push_back(GainPoint{ frame, gains });
+    }
+    renderPlan.setInputTrackGains(inputTrackId, gainPoints);
+  }
+  return renderPlan;
+}
+
+/// Render the blocks starting at each frame position, up to the last one
+std::vector<float> render(const RenderPlan& renderPlan, const std::vector<float>& input, const std::vector<uint64_t>& blockStarts) {
+  std::vector<float> output(NB_FRAMES * NB_OUTPUT_CHANNELS);
+  for (size_t b = 0; b + 1 < blockStarts.size(); ++b) {
+    const uint64_t blockStart = blockStarts[b];
+    const uint64_t blockEnd = blockStarts[b + 1];
+    // each block overwrites its output, whatever it held before
+    std::fill(output.begin() + blockStart * NB_OUTPUT_CHANNELS, output.begin() + blockEnd * NB_OUTPUT_CHANNELS, SENTINEL_SAMPLE);
+    renderPlan.process(blockStart, blockEnd - blockStart, input.data() + blockStart * NB_INPUT_CHANNELS, NB_INPUT_CHANNELS,
+                       output.data() + blockStart * NB_OUTPUT_CHANNELS, false);
+  }
+  return output;
+}
+
+bool isBitIdentical(const std::vector<float>& actual, const std::vector<float>& expected) {
+  return actual.size() == expected.size() && std::memcmp(actual.data(), expected.data(), actual.size() * sizeof(float)) == 0;
+}
+
+}
+
+int main() {
+  const RenderPlan renderPlan = createRenderPlan();
+  std::vector<float> input(NB_FRAMES * NB_INPUT_CHANNELS);
+  std::mt19937 generator(7);
+  std::uniform_real_distribution<float> sampleDistribution(-1.0, 1.0);
+  for(float& sample : input) {
+    sample = sampleDistribution(generator);
+  }
+
+  // a single block, crossing every gain point of the timelines
+  const std::vector<float> expected = render(renderPlan, input, { 0, NB_FRAMES });
+
+  // blocks advancing forward, of every size around the gain point spacing
+  for(const uint64_t blockSize : { 1, 7, 64, 100, 256, 1000 }) {
+    std::vector<uint64_t> blockStarts;
+    for (uint64_t frame = 0; frame < NB_FRAMES; frame += blockSize) {
+      blockStarts.push_back(frame);
+    }
+    blockStarts.push_back(NB_FRAMES);
+    CHECK(isBitIdentical(render(renderPlan, input, blockStarts), expected));
+  }
+
+  // blocks of random sizes, seeking back and forth in the timelines
+  std::vector<uint64_t> blockStarts = { 0, NB_FRAMES };
+  std::uniform_int_distribution<uint64_t> frameDistribution(1, NB_FRAMES - 1);
+  for (size_t b = 0; b < 200; ++b) {
+    blockStarts.push_back(frameDistribution(generator));
+  }
+  std::sort(blockStarts.begin(), blockStarts.end());
+  blockStarts.erase(std::unique(blockStarts.begin(), blockStarts.end()), blockStarts.end());
+  std::vector<uint64_t> shuffledBlockStarts(blockStarts.begin(), blockStarts.end() - 1);
+  std::shuffle(shuffledBlockStarts.begin(), shuffledBlockStarts.end(), generator);
+  std::vector<float> output(NB_FRAMES * NB_OUTPUT_CHANNELS, SENTINEL_SAMPLE);
+  for(const uint64_t blockStart : shuffledBlockStarts) {
+    const uint64_t blockEnd = *std::upper_bound(blockStarts.begin(), blockStarts.end(), blockStart);
+    renderPlan.process(blockStart, blockEnd - blockStart, input.data() + blockStart * NB_INPUT_CHANNELS, NB_INPUT_CHANNELS,
+                       output.data() + blockStart * NB_OUTPUT_CHANNELS, false);
+  }
+  CHECK(isBitIdentical(output, expected));
+
+  // the gains of a frame do not depend on the block it is rendered in
+  for(const uint64_t framePosition : { 0, 99, 100, 4321, 7999 }) {
+    for (size_t inputTrackId = 0; inputTrackId < NB_INPUT_CHANNELS; ++inputTrackId) {
+      std::vector<float> frameInput(NB_INPUT_CHANNELS, 0.0);
+      frameInput[inputTrackId] = 1.0;
+      std::vector<float> frameOutput(NB_OUTPUT_CHANNELS, SENTINEL_SAMPLE);
+      renderPlan.process(framePosition, 1, frameInput.data(), NB_INPUT_CHANNELS, frameOutput.data(), false);
+      CHECK_CLOSE(frameOutput[0], renderPlan.getGain(inputTrackId, 0, framePosition), 1e-6);
+    }
+  }
+  return test::getResult("render_plan_timeline_test");
+}
@@ -0,0 +1,94 @@
+#include "adm_engine/spsc_queue.hpp"
+
+#include "test_utils.hpp"
+
+#include <thread>
+
+using namespace admengine;
+
+namespace {
+
+void testCapacity() {
+  SpscQueue<int> queue(3);
+  CHECK_EQUAL(queue.capacity(), (size_t)3);
+  CHECK_EQUAL(queue.getFreeSpace(), (size_t)3);
+  CHECK(queue.front() == nullptr);
+  CHECK(queue.push(1));
+  CHECK(queue.push(2));
+  CHECK_EQUAL(queue.getFreeSpace(), (size_t)1);
+  CHECK(queue.push(3));
+  CHECK_EQUAL(queue.getFreeSpace(), (size_t)0);
+  // a full queue is left as it is
+  CHECK(!queue.push(4));
+  CHECK_EQUAL(*queue.front(), 1);
+
+  // a queue holds at least one item
+  SpscQueue<int> emptyQueue(0);
+  CHECK_EQUAL(emptyQueue.capacity(), (size_t)1);
+  CHECK(emptyQueue.push(1));
+  CHECK(!emptyQueue.push(2));
+}
+
+void testOrder() {
+  SpscQueue<int> queue(3);
+  // items are popped in push order, as slots wrap around
+  int nextPushed = 0;
+  int nextPopped = 0;
+  for (size_t iteration = 0; iteration < 10; ++iteration) {
+    while(queue.push(nextPushed)) {
+      ++nextPushed;
+    }
+    for (size_t item = 0; item < 2; ++item) {
+      CHECK(queue.front() != nullptr);
+      CHECK_EQUAL(*queue.front(), nextPopped);
+      queue.pop();
+      ++nextPopped;
+    }
+    CHECK_EQUAL(queue.getFreeSpace(), (size_t)2);
+  }
+  while(const int* item = queue.front()) {
+    CHECK_EQUAL(*item, nextPopped);
+    queue.pop();
+    ++nextPopped;
+  }
+  CHECK_EQUAL(nextPopped, nextPushed);
+  CHECK_EQUAL(queue.getFreeSpace(), (size_t)3);
+}
+
+void testThreads() {
+  const int nbItems = 100000;
+  SpscQueue<int> queue(16);
+  std::thread producer([&]() {
+      for (int item = 0; item < nbItems;) {
+        if(queue.push(item)) {
+          ++item;
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    });
+  // every item is received once, in order
+  int nextItem = 0;
+  bool ordered = true;
+  while(nextItem < nbItems) {
+    if(const int* item = queue.front()) {
+      ordered = ordered && *item == nextItem;
+      queue.pop();
+      ++nextItem;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+  producer.join();
+  CHECK(ordered);
+  CHECK(queue.front() == nullptr);
+}
+
+}
+
+int main() {
+  testCapacity();
+  testOrder();
+  testThreads();
+  return test::getResult("spsc_queue_test");
+}
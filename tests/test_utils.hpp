@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cmath>
+#include <iostream>
+
+namespace admengine {
+namespace test {
+
+/// Number of failed checks of the running test
+inline size_t& getNbFailures() {
+  static size_t nbFailures = 0;
+  return nbFailures;
+}
+
+/// Exit status of the running test, to be returned by its main function
+inline int getResult(const char* testName) {
+  if(getNbFailures()) {
+    std::cerr << testName << ": " << getNbFailures() << " check(s) failed" << std::endl;
+    return 1;
+  }
+  std::cout << testName << ": passed" << std::endl;
+  return 0;
+}
+
+}
+}
+
+#define CHECK(condition) \
+  do { \
+    if(!(condition)) { \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " << #condition << std::endl; \
+      ++admengine::test::getNbFailures(); \
+    } \
+  } while(0)
+
+#define CHECK_EQUAL(actual, expected) \
+  do { \
+    const auto actualValue = (actual); \
+    const auto expectedValue = (expected); \
+    if(!(actualValue == expectedValue)) { \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " << #actual << " == " << #expected \
+                << " (" << actualValue << " != " << expectedValue << ")" << std::endl; \
+      ++admengine::test::getNbFailures(); \
+    } \
+  } while(0)
+
+#define CHECK_CLOSE(actual, expected, tolerance) \
+  do { \
+    const double actualValue = (actual); \
+    const double expectedValue = (expected); \
+    if(!(std::fabs(actualValue - expectedValue) <= (tolerance))) { \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " << #actual << " ~= " << #expected \
+                << " (" << actualValue << " != " << expectedValue << ")" << std::endl; \
+      ++admengine::test::getNbFailures(); \
+    } \
+  } while(0)
+
+#define CHECK_THROWS(expression, exceptionType) \
+  do { \
+    bool thrown = false; \
+    try { \
+      expression; \
+    } catch(const exceptionType&) { \
+      thrown = true; \
+    } \
+    if(!thrown) { \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " << #expression << " throws " << #exceptionType << std::endl; \
+      ++admengine::test::getNbFailures(); \
+    } \
+  } while(0)